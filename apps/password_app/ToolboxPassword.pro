@@ -1,4 +1,4 @@
-QT += core gui widgets network sql
+QT += core gui widgets network sql concurrent
 
 qtHaveModule(webenginewidgets): qtHaveModule(webchannel): qtHaveModule(positioning) {
     QT += webenginewidgets webchannel
@@ -30,19 +30,32 @@ SOURCES += \
     ../../src/core/logging.cpp \
     ../../src/core/crypto.cpp \
     ../../src/core/singleinstance.cpp \
+    ../../src/core/progresschannel.cpp \
     ../../src/password/passworddatabase.cpp \
     ../../src/password/passwordvault.cpp \
     ../../src/password/passwordrepository.cpp \
     ../../src/password/passwordentrymodel.cpp \
+    ../../src/password/passwordentrystore.cpp \
+    ../../src/password/passwordvaultsnapshot.cpp \
+    ../../src/password/passwordvaulteventbus.cpp \
+    ../../src/password/passwordfilterengine.cpp \
+    ../../src/password/passwordsearchindex.cpp \
+    ../../src/password/passwordpinyin.cpp \
     ../../src/password/passwordcsv.cpp \
     ../../src/password/passwordcsvimportworker.cpp \
     ../../src/password/passwordgenerator.cpp \
+    ../../src/password/passwordsimilarity.cpp \
     ../../src/password/passwordstrength.cpp \
     ../../src/password/passwordurl.cpp \
     ../../src/password/passwordgraph.cpp \
     ../../src/password/passwordwebloginmatcher.cpp \
     ../../src/password/passwordfaviconservice.cpp \
     ../../src/password/passwordhealthworker.cpp \
+    ../../src/password/passwordpwnedfilter.cpp \
+    ../../src/password/passwordpwnedofflinedb.cpp \
+    ../../src/password/passwordpwnedofflineimporter.cpp \
+    ../../src/password/passwordpwnedrangeblob.cpp \
+    ../../src/password/passwordpwnedrangefetcher.cpp \
     ../../src/password/passwordhealthmodel.cpp \
     ../../src/password/passwordgroupmodel.cpp \
     ../../src/pages/passwordmanagerpage.cpp \
@@ -59,12 +72,14 @@ HEADERS += \
     ../../src/core/logging.h \
     ../../src/core/crypto.h \
     ../../src/core/singleinstance.h \
+    ../../src/core/progresschannel.h \
     ../../src/password/passworddatabase.h \
     ../../src/password/passwordvault.h \
     ../../src/password/passwordentry.h \
     ../../src/password/passwordcsv.h \
     ../../src/password/passwordcsvimportworker.h \
     ../../src/password/passwordgenerator.h \
+    ../../src/password/passwordsimilarity.h \
     ../../src/password/passwordstrength.h \
     ../../src/password/passwordurl.h \
     ../../src/password/passwordgraph.h \
@@ -72,10 +87,23 @@ HEADERS += \
     ../../src/password/passwordfaviconservice.h \
     ../../src/password/passwordhealth.h \
     ../../src/password/passwordhealthworker.h \
+    ../../src/password/passwordpwnedfilter.h \
+    ../../src/password/passwordpwnedofflinedb.h \
+    ../../src/password/passwordpwnedofflineimporter.h \
+    ../../src/password/passwordpwnedrangeblob.h \
+    ../../src/password/passwordpwnedrangefetcher.h \
     ../../src/password/passwordhealthmodel.h \
     ../../src/password/passwordgroup.h \
     ../../src/password/passwordrepository.h \
     ../../src/password/passwordentrymodel.h \
+    ../../src/password/passwordentrystore.h \
+    ../../src/password/passwordvaultsnapshot.h \
+    ../../src/password/passwordvaulteventbus.h \
+    ../../src/password/passwordfilterengine.h \
+    ../../src/password/passwordsearchindex.h \
+    ../../src/password/passwordpinyin.h \
+    ../../src/password/passwordpinyintable.inc \
+    ../../src/password/passwordstrengthtables.inc \
     ../../src/password/passwordgroupmodel.h \
     ../../src/pages/passwordmanagerpage.h \
     ../../src/pages/passwordcommonpasswordsdialog.h \
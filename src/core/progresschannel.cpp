@@ -0,0 +1,89 @@
+#include "progresschannel.h"
+
+#include <QTimer>
+
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr int kSampleIntervalMs = 33;
+// Weight of the newest tick in the throughput average; low enough that one stalled tick does not swing the ETA.
+constexpr double kRateSmoothing = 0.2;
+
+int clampToInt(qint64 value)
+{
+    return static_cast<int>(qBound<qint64>(std::numeric_limits<int>::min(), value, std::numeric_limits<int>::max()));
+}
+
+} // namespace
+
+ProgressSampler::ProgressSampler(QObject *parent) : QObject(parent)
+{
+    timer_ = new QTimer(this);
+    timer_->setInterval(kSampleIntervalMs);
+    connect(timer_, &QTimer::timeout, this, &ProgressSampler::sample);
+}
+
+void ProgressSampler::start(std::shared_ptr<const ProgressChannel> channel)
+{
+    channel_ = std::move(channel);
+    minimum_ = 0;
+    maximum_ = 0;
+    value_ = 0;
+    itemsPerSecond_ = 0.0;
+    clock_.start();
+    lastSampleMs_ = 0;
+    if (channel_)
+        timer_->start();
+}
+
+void ProgressSampler::stop()
+{
+    if (!channel_)
+        return;
+    sample();
+    timer_->stop();
+    channel_.reset();
+}
+
+qint64 ProgressSampler::remainingMs() const
+{
+    if (maximum_ <= minimum_ || itemsPerSecond_ <= 0.0)
+        return -1;
+    const auto left = qMax<qint64>(0, maximum_ - value_);
+    return static_cast<qint64>(left / itemsPerSecond_ * 1000.0);
+}
+
+void ProgressSampler::sample()
+{
+    if (!channel_)
+        return;
+
+    const auto minimum = channel_->minimum();
+    const auto maximum = channel_->maximum();
+    const auto value = channel_->value();
+    const auto nowMs = clock_.elapsed();
+
+    if (minimum != minimum_ || maximum != maximum_) {
+        // A new range is a new phase with its own unit of work; the old rate says nothing about it.
+        minimum_ = minimum;
+        maximum_ = maximum;
+        itemsPerSecond_ = 0.0;
+        emit rangeChanged(clampToInt(minimum), clampToInt(maximum));
+    }
+
+    if (value == value_)
+        return;
+
+    const auto elapsedMs = nowMs - lastSampleMs_;
+    if (elapsedMs > 0 && value > value_) {
+        const auto rate = (value - value_) * 1000.0 / elapsedMs;
+        itemsPerSecond_ = itemsPerSecond_ > 0.0 ? kRateSmoothing * rate + (1.0 - kRateSmoothing) * itemsPerSecond_ : rate;
+    }
+    value_ = value;
+    lastSampleMs_ = nowMs;
+
+    emit valueChanged(clampToInt(value));
+    emit rateChanged(itemsPerSecond_, remainingMs());
+}
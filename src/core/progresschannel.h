@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+
+#include <atomic>
+#include <memory>
+
+class QTimer;
+
+// Progress of one background job. The worker only stores into atomics, from any thread and as often as it
+// likes; nothing is queued per step. Whoever displays it reads the values through a ProgressSampler.
+class ProgressChannel final
+{
+public:
+    void setRange(qint64 minimum, qint64 maximum)
+    {
+        minimum_.store(minimum, std::memory_order_relaxed);
+        maximum_.store(maximum, std::memory_order_relaxed);
+    }
+    void setValue(qint64 value) { value_.store(value, std::memory_order_relaxed); }
+    void advance(qint64 delta = 1) { value_.fetch_add(delta, std::memory_order_relaxed); }
+
+    qint64 minimum() const { return minimum_.load(std::memory_order_relaxed); }
+    qint64 maximum() const { return maximum_.load(std::memory_order_relaxed); }
+    qint64 value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> minimum_{0};
+    std::atomic<qint64> maximum_{0};
+    std::atomic<qint64> value_{0};
+};
+
+// GUI side of a ProgressChannel: samples it on a timer (about 30 Hz) and emits only what moved since the
+// last tick, along with a smoothed throughput and the remaining time it implies.
+class ProgressSampler final : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProgressSampler(QObject *parent = nullptr);
+
+    void start(std::shared_ptr<const ProgressChannel> channel);
+    // Takes one last sample so the final value is not lost between ticks.
+    void stop();
+
+    double itemsPerSecond() const { return itemsPerSecond_; }
+    // -1 while unknown (no range yet, or nothing has moved).
+    qint64 remainingMs() const;
+
+signals:
+    void rangeChanged(int minimum, int maximum);
+    void valueChanged(int value);
+    void rateChanged(double itemsPerSecond, qint64 remainingMs);
+
+private:
+    void sample();
+
+    QTimer *timer_ = nullptr;
+    std::shared_ptr<const ProgressChannel> channel_;
+    QElapsedTimer clock_;
+    qint64 lastSampleMs_ = 0;
+    qint64 minimum_ = 0;
+    qint64 maximum_ = 0;
+    qint64 value_ = 0;
+    double itemsPerSecond_ = 0.0;
+};
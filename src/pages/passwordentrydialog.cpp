@@ -2,11 +2,14 @@
 
 #include "passwordgeneratordialog.h"
 
+#include "password/passwordpwnedofflinedb.h"
 #include "password/passwordstrength.h"
 
 #include <QAbstractItemView>
 #include <QComboBox>
+#include <QCryptographicHash>
 #include <QDialogButtonBox>
+#include <QFile>
 #include <QFormLayout>
 #include <QHBoxLayout>
 #include <QLabel>
@@ -21,11 +24,20 @@
 PasswordEntryDialog::PasswordEntryDialog(const QStringList &categories, const QStringList &availableTags, QWidget *parent)
     : QDialog(parent)
 {
+    const auto corpusPath = PasswordPwnedOfflineDb::defaultPath();
+    if (QFile::exists(corpusPath)) {
+        pwnedCorpus_ = std::make_unique<PasswordPwnedOfflineDb>();
+        if (!pwnedCorpus_->open(corpusPath))
+            pwnedCorpus_.reset();
+    }
+
     setupUi(categories, availableTags);
     updateOkButtonState();
     updateStrengthIndicator();
 }
 
+PasswordEntryDialog::~PasswordEntryDialog() = default;
+
 void PasswordEntryDialog::setupUi(const QStringList &categories, const QStringList &availableTags)
 {
     setWindowTitle("密码条目");
@@ -217,7 +229,18 @@ void PasswordEntryDialog::updateStrengthIndicator()
     const auto pwd = passwordEdit_ ? passwordEdit_->text() : QString();
     const auto strength = evaluatePasswordStrength(pwd);
     strengthBar_->setValue(strength.score);
-    strengthLabel_->setText(QString("%1(%2)").arg(strength.label).arg(strength.score));
+
+    qint64 breachCount = 0;
+    if (pwnedCorpus_ && !pwd.isEmpty()) {
+        const auto sha1 = QCryptographicHash::hash(pwd.toUtf8(), QCryptographicHash::Sha1);
+        breachCount = pwnedCorpus_->lookup(sha1).value_or(0);
+    }
+    if (breachCount > 0) {
+        strengthLabel_->setText(
+            QString("%1(%2)，已在泄露库中出现 %3 次").arg(strength.label).arg(strength.score).arg(breachCount));
+    } else {
+        strengthLabel_->setText(QString("%1(%2)").arg(strength.label).arg(strength.score));
+    }
 }
 
 void PasswordEntryDialog::togglePasswordVisibility()
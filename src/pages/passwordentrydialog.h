@@ -5,6 +5,8 @@
 #include <QDialog>
 #include <QStringList>
 
+#include <memory>
+
 class QComboBox;
 class QDialogButtonBox;
 class QLabel;
@@ -14,12 +16,15 @@ class QPlainTextEdit;
 class QProgressBar;
 class QToolButton;
 
+class PasswordPwnedOfflineDb;
+
 class PasswordEntryDialog final : public QDialog
 {
     Q_OBJECT
 
 public:
     explicit PasswordEntryDialog(const QStringList &categories, const QStringList &availableTags, QWidget *parent = nullptr);
+    ~PasswordEntryDialog() override;
 
     void setEntry(const PasswordEntrySecrets &secrets);
     PasswordEntrySecrets entry() const;
@@ -49,6 +54,9 @@ private:
     QPlainTextEdit *notesEdit_ = nullptr;
     QDialogButtonBox *buttonBox_ = nullptr;
 
+    // Offline breach corpus, if one was imported; checked on every keystroke through its filter.
+    std::unique_ptr<PasswordPwnedOfflineDb> pwnedCorpus_;
+
     PasswordEntrySecrets data_;
     bool passwordVisible_ = false;
 };
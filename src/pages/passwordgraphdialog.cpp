@@ -165,7 +165,7 @@ void PasswordGraphDialog::rebuildGraph()
         return;
     }
 
-    const auto graph = PasswordGraph::build(repo_->listEntries());
+    const auto graph = PasswordGraph::build(repo_->snapshot()->entries());
     if (graph.nodes.isEmpty()) {
         scene_->addText("暂无条目");
         return;
@@ -1,16 +1,24 @@
 #include "passwordhealthdialog.h"
 
+#include "core/progresschannel.h"
 #include "password/passwordhealthmodel.h"
 #include "password/passwordhealthworker.h"
+#include "password/passwordpwnedofflinedb.h"
+#include "password/passwordpwnedofflineimporter.h"
+#include "password/passwordvaulteventbus.h"
 
 #include <QCheckBox>
 #include <QDialogButtonBox>
+#include <QDir>
+#include <QFile>
+#include <QFileDialog>
 #include <QHeaderView>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QProgressBar>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QSortFilterProxyModel>
 #include <QTableView>
@@ -110,10 +118,13 @@ void PasswordHealthDialog::setupUi()
     onlyIssuesCheck_->setChecked(true);
     toolsRow->addWidget(onlyIssuesCheck_);
 
-    pwnedCheck_ = new QCheckBox("在线泄露检查（需要联网）", this);
-    pwnedCheck_->setToolTip("使用匿名哈希前缀查询（不上传明文密码），需要联网。");
+    pwnedCheck_ = new QCheckBox(this);
     pwnedCheck_->setChecked(false);
     toolsRow->addWidget(pwnedCheck_);
+    importOfflineBtn_ = new QPushButton("导入离线泄露库…", this);
+    importOfflineBtn_->setToolTip("导入 Pwned Passwords “SHA-1 ordered by hash” 文本库，之后无需联网即可检查。");
+    toolsRow->addWidget(importOfflineBtn_);
+    updatePwnedCheckText();
 
     scanBtn_ = new QPushButton("重新扫描", this);
     toolsRow->addWidget(scanBtn_);
@@ -125,6 +136,7 @@ void PasswordHealthDialog::setupUi()
     progressBar_->setRange(0, 0);
     progressBar_->setTextVisible(false);
     root->addWidget(progressBar_);
+    progressSampler_ = new ProgressSampler(this);
 
     model_ = new PasswordHealthModel(this);
     proxy_ = new HealthFilterProxyModel(this);
@@ -155,7 +167,19 @@ void PasswordHealthDialog::wireSignals()
         static_cast<HealthFilterProxyModel *>(proxy_)->setSearchText(text);
     });
     connect(scanBtn_, &QPushButton::clicked, this, &PasswordHealthDialog::startScan);
+    connect(PasswordVaultEventBus::instance(), &PasswordVaultEventBus::changed, this, [this](const PasswordVaultChangeSet &changes) {
+        model_->removeEntries(changes.removedEntries);
+        if (!running_ && (changes.entriesReset || !changes.upsertedEntries.isEmpty()))
+            statusLabel_->setText("条目已变更，重新扫描可更新结果。");
+    });
     connect(cancelBtn_, &QPushButton::clicked, this, &PasswordHealthDialog::cancelScan);
+    connect(importOfflineBtn_, &QPushButton::clicked, this, &PasswordHealthDialog::importOfflineDb);
+    connect(progressSampler_, &ProgressSampler::rangeChanged, progressBar_, &QProgressBar::setRange);
+    connect(progressSampler_, &ProgressSampler::valueChanged, this, [this](int value) {
+        if (progressBar_->maximum() > 0)
+            progressBar_->setValue(value);
+    });
+    connect(progressSampler_, &ProgressSampler::rateChanged, this, &PasswordHealthDialog::updateScanStatus);
 
     connect(tableView_, &QTableView::doubleClicked, this, [this](const QModelIndex &index) {
         if (!index.isValid())
@@ -186,9 +210,12 @@ void PasswordHealthDialog::startScan()
     statusLabel_->setText("扫描中…");
     progressBar_->setRange(0, 0);
     progressBar_->setValue(0);
+    model_->setItems({});
 
     bool enablePwned = pwnedCheck_ && pwnedCheck_->isChecked();
-    if (enablePwned) {
+    const auto offlineDbPath = PasswordPwnedOfflineDb::defaultPath();
+    const auto useOfflineDb = QFile::exists(offlineDbPath);
+    if (enablePwned && !useOfflineDb) {
         const auto info =
             "将进行在线泄露检查（Pwned Passwords）。\n\n"
             "说明：不会上传明文密码，只会发送 SHA-1 哈希的前 5 位前缀进行查询（k-anonymity 思路）。\n"
@@ -205,19 +232,16 @@ void PasswordHealthDialog::startScan()
     pwnedRequested_ = enablePwned;
 
     thread_ = new QThread(this);
-    worker_ = new PasswordHealthWorker(dbPath_, masterKey_, enablePwned, enablePwned, nullptr);
+    worker_ = new PasswordHealthWorker(dbPath_, masterKey_, enablePwned, enablePwned && !useOfflineDb, nullptr);
+    if (useOfflineDb)
+        worker_->setPwnedOfflineDbPath(offlineDbPath);
     worker_->moveToThread(thread_);
 
     connect(thread_, &QThread::started, worker_, &PasswordHealthWorker::run);
-    connect(worker_, &PasswordHealthWorker::progressRangeChanged, this, [this](int min, int max) {
-        progressBar_->setRange(min, max);
-    });
-    connect(worker_, &PasswordHealthWorker::progressValueChanged, this, [this](int value) {
-        if (progressBar_->maximum() > 0)
-            progressBar_->setValue(value);
-    });
+    progressSampler_->start(worker_->progress());
 
     connect(worker_, &PasswordHealthWorker::failed, this, [this](const QString &error) {
+        progressSampler_->stop();
         running_ = false;
         updateUiState();
         progressBar_->setRange(0, 1);
@@ -226,11 +250,20 @@ void PasswordHealthDialog::startScan()
         QMessageBox::warning(this, "扫描失败", error);
     });
 
-    connect(worker_, &PasswordHealthWorker::finished, this, [this](const QVector<PasswordHealthItem> &items) {
-        model_->setItems(items);
+    // Rows show up as soon as their batch is analysed, so triage can start while reuse and pwned results follow.
+    connect(worker_, &PasswordHealthWorker::itemsReady, this, [this](const QVector<PasswordHealthItem> &items) {
+        model_->appendItems(items);
+        updateScanStatus();
+    });
+    connect(worker_, &PasswordHealthWorker::itemsUpdated, model_, &PasswordHealthModel::updateItems);
+
+    connect(worker_, &PasswordHealthWorker::finished, this, [this]() {
+        progressSampler_->stop();
+        const auto &items = model_->items();
 
         int weak = 0;
         int reused = 0;
+        int similar = 0;
         int stale = 0;
         int corrupted = 0;
         int pwned = 0;
@@ -241,6 +274,8 @@ void PasswordHealthDialog::startScan()
                 weak++;
             if (it.reused)
                 reused++;
+            if (it.similar)
+                similar++;
             if (it.stale)
                 stale++;
             if (it.corrupted)
@@ -256,6 +291,7 @@ void PasswordHealthDialog::startScan()
         QStringList parts;
         parts << QString("弱密码 %1").arg(weak);
         parts << QString("重复 %1").arg(reused);
+        parts << QString("相似 %1").arg(similar);
         parts << QString("久未更新 %1").arg(stale);
         parts << QString("损坏 %1").arg(corrupted);
         if (pwnedRequested_) {
@@ -296,9 +332,22 @@ void PasswordHealthDialog::cancelScan()
 
     if (worker_)
         worker_->requestCancel();
+    progressSampler_->stop();
     statusLabel_->setText("正在取消…");
 }
 
+void PasswordHealthDialog::updateScanStatus()
+{
+    if (!running_ || !worker_ || worker_->progress()->maximum() <= 0)
+        return;
+
+    auto text = QString("扫描中…已载入 %1 条").arg(model_->rowCount());
+    const auto remainingMs = progressSampler_->remainingMs();
+    if (remainingMs >= 0)
+        text.append(QString("，预计剩余 %1 秒").arg((remainingMs + 999) / 1000));
+    statusLabel_->setText(text);
+}
+
 void PasswordHealthDialog::updateUiState()
 {
     scanBtn_->setEnabled(!running_);
@@ -306,4 +355,83 @@ void PasswordHealthDialog::updateUiState()
     searchEdit_->setEnabled(!running_);
     onlyIssuesCheck_->setEnabled(!running_);
     pwnedCheck_->setEnabled(!running_);
+    importOfflineBtn_->setEnabled(!running_ && !importingOffline_);
+}
+
+void PasswordHealthDialog::updatePwnedCheckText()
+{
+    if (QFile::exists(PasswordPwnedOfflineDb::defaultPath())) {
+        pwnedCheck_->setText("泄露检查（离线库）");
+        pwnedCheck_->setToolTip("在本机离线泄露库中查询，不联网。");
+    } else {
+        pwnedCheck_->setText("在线泄露检查（需要联网）");
+        pwnedCheck_->setToolTip("使用匿名哈希前缀查询（不上传明文密码），需要联网。");
+    }
+}
+
+void PasswordHealthDialog::importOfflineDb()
+{
+    if (running_ || importingOffline_)
+        return;
+
+    const auto dumpPath = QFileDialog::getOpenFileName(this,
+                                                       "选择 Pwned Passwords 文本库",
+                                                       QDir::homePath(),
+                                                       "Pwned Passwords (*.txt);;所有文件 (*)");
+    if (dumpPath.isEmpty())
+        return;
+
+    importingOffline_ = true;
+    updateUiState();
+
+    auto *thread = new QThread(this);
+    auto *importer = new PasswordPwnedOfflineImporter(dumpPath, PasswordPwnedOfflineDb::defaultPath(), nullptr);
+    importer->moveToThread(thread);
+
+    auto *progress = new QProgressDialog("正在导入离线泄露库…", "取消", 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+    progress->show();
+
+    connect(progress, &QProgressDialog::canceled, this, [importer]() { importer->requestCancel(); });
+    connect(thread, &QThread::started, importer, &PasswordPwnedOfflineImporter::run);
+    auto *sampler = new ProgressSampler(progress);
+    connect(sampler, &ProgressSampler::rangeChanged, progress, &QProgressDialog::setRange);
+    connect(sampler, &ProgressSampler::valueChanged, progress, &QProgressDialog::setValue);
+    connect(sampler, &ProgressSampler::rateChanged, progress, [progress](double kibPerSecond, qint64 remainingMs) {
+        if (remainingMs < 0)
+            return;
+        progress->setLabelText(QString("正在导入离线泄露库…（%1 MB/秒，预计剩余 %2 秒）")
+                                   .arg(kibPerSecond / 1024.0, 0, 'f', 1)
+                                   .arg((remainingMs + 999) / 1000));
+    });
+    sampler->start(importer->progress());
+
+    connect(importer, &PasswordPwnedOfflineImporter::failed, this, [this, progress, sampler](const QString &error) {
+        sampler->stop();
+        progress->close();
+        importingOffline_ = false;
+        updateUiState();
+        if (error.contains("取消"))
+            QMessageBox::information(this, "已取消", error);
+        else
+            QMessageBox::warning(this, "导入失败", error);
+    });
+    connect(importer, &PasswordPwnedOfflineImporter::finished, this, [this, progress, sampler](qint64 records) {
+        sampler->stop();
+        progress->close();
+        importingOffline_ = false;
+        updatePwnedCheckText();
+        updateUiState();
+        QMessageBox::information(this, "完成", QString("离线泄露库导入完成：共 %1 条记录。").arg(records));
+    });
+
+    connect(importer, &PasswordPwnedOfflineImporter::finished, thread, &QThread::quit);
+    connect(importer, &PasswordPwnedOfflineImporter::failed, thread, &QThread::quit);
+    connect(thread, &QThread::finished, importer, &QObject::deleteLater);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    connect(thread, &QThread::finished, progress, &QObject::deleteLater);
+
+    thread->start();
 }
@@ -15,6 +15,7 @@ class QThread;
 
 class PasswordHealthModel;
 class PasswordHealthWorker;
+class ProgressSampler;
 
 class PasswordHealthDialog final : public QDialog
 {
@@ -32,7 +33,10 @@ private:
     void wireSignals();
     void startScan();
     void cancelScan();
+    void importOfflineDb();
+    void updatePwnedCheckText();
     void updateUiState();
+    void updateScanStatus();
 
     QString dbPath_;
     QByteArray masterKey_;
@@ -43,6 +47,7 @@ private:
     QCheckBox *pwnedCheck_ = nullptr;
     QPushButton *scanBtn_ = nullptr;
     QPushButton *cancelBtn_ = nullptr;
+    QPushButton *importOfflineBtn_ = nullptr;
     QProgressBar *progressBar_ = nullptr;
     QTableView *tableView_ = nullptr;
 
@@ -51,6 +56,8 @@ private:
 
     QThread *thread_ = nullptr;
     PasswordHealthWorker *worker_ = nullptr;
+    ProgressSampler *progressSampler_ = nullptr;
     bool running_ = false;
     bool pwnedRequested_ = false;
+    bool importingOffline_ = false;
 };
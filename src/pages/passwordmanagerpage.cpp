@@ -2,6 +2,7 @@
 
 #include "core/apppaths.h"
 #include "core/crypto.h"
+#include "core/progresschannel.h"
 #include "pages/passwordcommonpasswordsdialog.h"
 #include "pages/passwordcsvimportdialog.h"
 #include "pages/passwordentrydialog.h"
@@ -11,12 +12,15 @@
 #include "password/passwordcsvimportworker.h"
 #include "password/passwordentrymodel.h"
 #include "password/passwordfaviconservice.h"
+#include "password/passwordfilterengine.h"
 #include "password/passwordgroupmodel.h"
 #include "password/passwordrepository.h"
 #include "password/passwordvault.h"
+#include "password/passwordvaulteventbus.h"
 
 #include <QAbstractItemView>
 #include <QApplication>
+#include <QBitArray>
 #include <QClipboard>
 #include <QComboBox>
 #include <QDateTime>
@@ -39,11 +43,13 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QMessageBox>
+#include <QPainter>
 #include <QProgressDialog>
 #include <QPushButton>
 #include <QSaveFile>
 #include <QSortFilterProxyModel>
 #include <QStyle>
+#include <QStyledItemDelegate>
 #include <QSplitter>
 #include <QSet>
 #include <QTableView>
@@ -54,6 +60,8 @@
 #include <QVBoxLayout>
 
 #include <algorithm>
+#include <limits>
+#include <utility>
 
 #ifdef TBX_HAS_WEBENGINE
 #include "pages/passwordwebassistantdialog.h"
@@ -61,94 +69,119 @@
 
 namespace {
 
+// Applies the accepted-row mask published by PasswordFilterEngine; no per-row predicate work happens here.
 class PasswordFilterProxyModel final : public QSortFilterProxyModel
 {
 public:
     explicit PasswordFilterProxyModel(QObject *parent = nullptr) : QSortFilterProxyModel(parent) {}
 
-    void setSearchText(const QString &text)
+    void setAcceptedRows(const QBitArray &acceptedRows, const QVector<int> &relevance)
     {
-        searchText_ = text.trimmed();
-        invalidateFilter();
+        acceptedRows_ = acceptedRows;
+        relevance_ = relevance;
+        // One pass re-filters and re-sorts; the relevance order may have changed with the mask.
+        invalidate();
     }
 
-    void setCategory(const QString &category)
+    // Called as the source is about to reset: the old snapshot's mask must not be applied to the new rows,
+    // even when the row count happens to match. Nothing is accepted until the engine publishes a new one.
+    void clearAcceptedRows()
     {
-        category_ = category.trimmed();
-        invalidateFilter();
+        acceptedRows_.clear();
+        relevance_.clear();
     }
 
-    void setRequiredTags(const QStringList &tags)
+    // Keep the mask aligned with the source while it inserts or removes rows, until the engine publishes the
+    // next one. New rows stay hidden until then.
+    void insertSourceRows(int first, int count)
     {
-        requiredTags_ = tags;
-        invalidateFilter();
+        const auto rows = sourceModel() ? sourceModel()->rowCount() : 0;
+        if (acceptedRows_.size() != rows)
+            return;
+        QBitArray accepted(rows + count);
+        for (int row = 0; row < rows; ++row)
+            accepted.setBit(row < first ? row : row + count, acceptedRows_.testBit(row));
+        acceptedRows_ = accepted;
+        if (relevance_.size() == rows)
+            relevance_.insert(first, count, std::numeric_limits<int>::max());
     }
 
-    void setGroupIds(const QVector<qint64> &groupIds)
+    void removeSourceRows(int first, int count)
     {
-        groupIds_ = groupIds;
-        invalidateFilter();
+        const auto rows = sourceModel() ? sourceModel()->rowCount() : 0;
+        if (acceptedRows_.size() != rows + count)
+            return;
+        QBitArray accepted(rows);
+        for (int row = 0; row < rows; ++row)
+            accepted.setBit(row, acceptedRows_.testBit(row < first ? row : row + count));
+        acceptedRows_ = accepted;
+        if (relevance_.size() == rows + count)
+            relevance_.remove(first, count);
     }
 
-    void setEntryType(int entryType)
+    // While on, rows are ordered by search relevance instead of the clicked column.
+    void setRelevanceOrder(bool enabled)
     {
-        entryType_ = entryType;
-        invalidateFilter();
+        if (relevanceOrder_ == enabled)
+            return;
+        relevanceOrder_ = enabled;
+        if (enabled && sortColumn() < 0)
+            sort(0, Qt::AscendingOrder);
+        else
+            invalidate();
     }
 
+    bool relevanceOrder() const { return relevanceOrder_; }
+
 protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override
     {
         const auto model = sourceModel();
-        if (!model)
+        if (!model || sourceParent.isValid())
             return true;
 
-        const auto groupId = model->index(sourceRow, 0, sourceParent).data(PasswordEntryModel::GroupIdRole).toLongLong();
-        if (!groupIds_.isEmpty() && !groupIds_.contains(groupId))
+        // No mask for this snapshot yet; the reset pass stays trivial and the engine's mask does the filtering.
+        if (acceptedRows_.size() != model->rowCount())
             return false;
 
-        const auto entryType = model->index(sourceRow, 0, sourceParent).data(PasswordEntryModel::EntryTypeRole).toInt();
-        if (entryType_ >= 0 && entryType != entryType_)
-            return false;
+        return acceptedRows_.testBit(sourceRow);
+    }
 
-        const auto title = model->index(sourceRow, 0, sourceParent).data().toString();
-        const auto username = model->index(sourceRow, 1, sourceParent).data().toString();
-        const auto url = model->index(sourceRow, 2, sourceParent).data().toString();
-        const auto category = model->index(sourceRow, 3, sourceParent).data().toString();
-        const auto tagsText = model->index(sourceRow, 4, sourceParent).data().toString();
+    void setSourceModel(QAbstractItemModel *model) override
+    {
+        entryModel_ = qobject_cast<PasswordEntryModel *>(model);
+        QSortFilterProxyModel::setSourceModel(model);
+    }
 
-        if (!category_.isEmpty() && category_ != "全部" && category_ != category)
+    bool lessThan(const QModelIndex &left, const QModelIndex &right) const override
+    {
+        const auto model = sourceModel();
+        if (!model)
             return false;
 
-        if (!requiredTags_.isEmpty()) {
-            const auto rowTags = model->index(sourceRow, 0, sourceParent).data(PasswordEntryModel::TagsRole).toStringList();
-            for (const auto &required : requiredTags_) {
-                bool found = false;
-                for (const auto &tag : rowTags) {
-                    if (tag.compare(required, Qt::CaseInsensitive) == 0) {
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found)
-                    return false;
-            }
+        const auto rows = model->rowCount();
+        if (relevanceOrder_ && relevance_.size() == rows) {
+            // Best match first regardless of the header's sort direction; ties keep source order.
+            const auto l = std::make_pair(relevance_.at(left.row()), left.row());
+            const auto r = std::make_pair(relevance_.at(right.row()), right.row());
+            return sortOrder() == Qt::AscendingOrder ? l < r : r < l;
         }
 
-        if (searchText_.isEmpty())
-            return true;
+        if (entryModel_) {
+            // Precomputed collation ranks: an int compare per call instead of comparing display strings.
+            const auto &ranks = entryModel_->sortRanks(left.column());
+            if (ranks.size() == rows)
+                return ranks.at(left.row()) < ranks.at(right.row());
+        }
 
-        const auto typeLabel = passwordEntryTypeLabel(passwordEntryTypeFromInt(entryType));
-        const auto haystack = QString("%1 %2 %3 %4 %5 %6").arg(title, username, url, typeLabel, category, tagsText);
-        return haystack.contains(searchText_, Qt::CaseInsensitive);
+        return QSortFilterProxyModel::lessThan(left, right);
     }
 
 private:
-    QString searchText_;
-    QString category_ = "全部";
-    QStringList requiredTags_;
-    QVector<qint64> groupIds_;
-    int entryType_ = -1;
+    PasswordEntryModel *entryModel_ = nullptr;
+    QBitArray acceptedRows_;
+    QVector<int> relevance_;
+    bool relevanceOrder_ = false;
 };
 
 QString promptPassword(QWidget *parent, const QString &title, const QString &label)
@@ -210,8 +243,29 @@ PasswordManagerPage::PasswordManagerPage(QWidget *parent) : QWidget(parent)
     model_ = new PasswordEntryModel(this);
     model_->setFaviconService(faviconService_);
     groupModel_ = new PasswordGroupModel(this);
+    repo_->setEntryCountListener([this](qint64 groupId, int delta) { groupModel_->adjustEntryCount(groupId, delta); });
     proxy_ = new PasswordFilterProxyModel(this);
     proxy_->setSourceModel(model_);
+    filterEngine_ = new PasswordFilterEngine(this);
+    connect(filterEngine_, &PasswordFilterEngine::maskReady, this,
+            [this](const QBitArray &acceptedRows, const QVector<int> &relevance) {
+                static_cast<PasswordFilterProxyModel *>(proxy_)->setAcceptedRows(acceptedRows, relevance);
+            });
+    connect(model_, &QAbstractItemModel::modelAboutToBeReset, this, [this]() {
+        static_cast<PasswordFilterProxyModel *>(proxy_)->clearAcceptedRows();
+    });
+    // The mask grows before the proxy filters inserted rows and shrinks once it has dropped removed ones.
+    connect(model_, &QAbstractItemModel::rowsAboutToBeInserted, this, [this](const QModelIndex &, int first, int last) {
+        static_cast<PasswordFilterProxyModel *>(proxy_)->insertSourceRows(first, last - first + 1);
+    });
+    connect(model_, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &, int first, int last) {
+        static_cast<PasswordFilterProxyModel *>(proxy_)->removeSourceRows(first, last - first + 1);
+    });
+    connect(model_, &QAbstractItemModel::modelReset, this, [this]() {
+        filterEngine_->setRows(model_->filterRows(), model_->searchIndex());
+    });
+    filterEngine_->setRows(model_->filterRows(), model_->searchIndex());
+    connect(PasswordVaultEventBus::instance(), &PasswordVaultEventBus::changed, this, &PasswordManagerPage::applyVaultChanges);
 
     autoLockTimer_ = new QTimer(this);
     autoLockTimer_->setSingleShot(true);
@@ -465,6 +519,7 @@ void PasswordManagerPage::setupUi()
     groupView_->setIconSize(QSize(16, 16));
     groupView_->setFrameShape(QFrame::NoFrame);
     groupView_->setIndentation(14);
+    groupView_->setItemDelegate(new GroupCountDelegate(groupView_));
     groupLayout->addWidget(groupView_, 1);
 
     groupPanel->setMinimumWidth(240);
@@ -598,12 +653,27 @@ void PasswordManagerPage::wireSignals()
     connect(tableView_->selectionModel(), &QItemSelectionModel::selectionChanged, this, [this]() { updateUiState(); });
 
     connect(groupView_->selectionModel(), &QItemSelectionModel::currentChanged, this, [this]() {
-        static_cast<PasswordFilterProxyModel *>(proxy_)->setGroupIds(groupModel_->descendantGroupIds(selectedGroupId()));
+        filterEngine_->setGroupSubtree(groupModel_->subtree(selectedGroupId()));
         updateUiState();
     });
 
     connect(searchEdit_, &QLineEdit::textChanged, this, [this](const QString &text) {
-        static_cast<PasswordFilterProxyModel *>(proxy_)->setSearchText(text);
+        // A fresh search starts in relevance order; clicking a column header switches back to column sorting.
+        const bool searching = !text.trimmed().isEmpty();
+        const bool wasSearching = !filterEngine_->criteria().searchText.isEmpty();
+        if (searching != wasSearching) {
+            static_cast<PasswordFilterProxyModel *>(proxy_)->setRelevanceOrder(searching);
+            tableView_->horizontalHeader()->setSortIndicatorShown(!searching);
+        }
+        filterEngine_->setSearchText(text);
+    });
+
+    connect(tableView_->horizontalHeader(), &QHeaderView::sectionClicked, this, [this]() {
+        auto *proxy = static_cast<PasswordFilterProxyModel *>(proxy_);
+        if (!proxy->relevanceOrder())
+            return;
+        proxy->setRelevanceOrder(false);
+        tableView_->horizontalHeader()->setSortIndicatorShown(true);
     });
 
     connect(tagFilterEdit_, &QLineEdit::textChanged, this, [this](const QString &text) {
@@ -617,16 +687,16 @@ void PasswordManagerPage::wireSignals()
                 tags.push_back(t);
         }
 
-        static_cast<PasswordFilterProxyModel *>(proxy_)->setRequiredTags(tags);
+        filterEngine_->setRequiredTags(tags);
     });
 
     connect(typeCombo_, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int) {
         const auto typeValue = typeCombo_ ? typeCombo_->currentData().toInt() : -1;
-        static_cast<PasswordFilterProxyModel *>(proxy_)->setEntryType(typeValue);
+        filterEngine_->setEntryType(typeValue);
     });
 
     connect(categoryCombo_, &QComboBox::currentTextChanged, this, [this](const QString &category) {
-        static_cast<PasswordFilterProxyModel *>(proxy_)->setCategory(category);
+        filterEngine_->setCategory(category);
     });
 
     connect(autoLockTimer_, &QTimer::timeout, this, [this]() {
@@ -650,7 +720,6 @@ void PasswordManagerPage::showWebAssistant()
 #ifdef TBX_HAS_WEBENGINE
     PasswordWebAssistantDialog dlg(repo_, vault_, this);
     dlg.exec();
-    refreshAll();
 #else
     QMessageBox::information(
         this,
@@ -717,6 +786,7 @@ void PasswordManagerPage::refreshGroups()
     const auto currentGroupId = selectedGroupId();
 
     groupModel_->setGroups(repo_->listGroups());
+    groupModel_->setEntryCounts(repo_->entryCountsByGroup());
     groupView_->expandAll();
 
     auto idx = groupModel_->indexForGroupId(currentGroupId > 0 ? currentGroupId : 1);
@@ -726,7 +796,100 @@ void PasswordManagerPage::refreshGroups()
     if (idx.isValid())
         groupView_->setCurrentIndex(idx);
 
-    static_cast<PasswordFilterProxyModel *>(proxy_)->setGroupIds(groupModel_->descendantGroupIds(selectedGroupId()));
+    filterEngine_->setGroupSubtree(groupModel_->subtree(selectedGroupId()));
+}
+
+void PasswordManagerPage::applyVaultChanges(const PasswordVaultChangeSet &changes)
+{
+    if (changes.entriesReset) {
+        // Bulk writes (CSV import) may also have created groups from category paths.
+        refreshGroups();
+    } else if (!changes.changedGroups.isEmpty()) {
+        applyGroupChanges(changes.changedGroups);
+    }
+
+    if (changes.entriesReset) {
+        model_->reload();
+        refreshCategories();
+    } else if (changes.touchesEntries()) {
+        applyEntryChanges(changes.upsertedEntries, changes.removedEntries);
+    }
+    updateUiState();
+}
+
+void PasswordManagerPage::applyEntryChanges(const QSet<qint64> &upsertedIds, const QSet<qint64> &removedIds)
+{
+    // Only the announced entries are read back; one missing from the result was deleted meanwhile.
+    const auto loaded = repo_->loadEntries(upsertedIds);
+    if (!loaded.has_value()) {
+        model_->reload();
+        refreshCategories();
+        return;
+    }
+    const auto &upserted = loaded.value();
+
+    auto removed = removedIds;
+    for (const auto id : upsertedIds) {
+        if (!upserted.contains(id))
+            removed.insert(id);
+    }
+
+    // The category combo is only re-read when an edit can add or drop one of its items.
+    const auto &store = model_->store();
+    bool categoriesChanged = false;
+    for (const auto id : removed) {
+        const auto row = model_->rowForId(id);
+        categoriesChanged = categoriesChanged || (row >= 0 && !store.row(row).category().isEmpty());
+    }
+    for (const auto &entry : upserted) {
+        const auto row = model_->rowForId(entry.id);
+        if (row >= 0)
+            categoriesChanged = categoriesChanged || store.row(row).category() != entry.category;
+        else
+            categoriesChanged = categoriesChanged || (!entry.category.isEmpty() && categoryCombo_->findText(entry.category) < 0);
+    }
+
+    model_->applyChanges(upserted, removed);
+    filterEngine_->setRows(model_->filterRows(), model_->searchIndex());
+    if (categoriesChanged)
+        refreshCategories();
+}
+
+void PasswordManagerPage::applyGroupChanges(const QSet<qint64> &groupIds)
+{
+    // Only the announced groups are read back; one missing from the result was deleted.
+    const auto loaded = repo_->loadGroups(groupIds);
+    if (!loaded.has_value()) {
+        refreshGroups();
+        return;
+    }
+    const auto &current = loaded.value();
+
+    // Ascending ids: a parent created in the same batch was created before its children.
+    auto ids = groupIds.values();
+    std::sort(ids.begin(), ids.end());
+    for (const auto id : ids) {
+        const auto it = current.constFind(id);
+        if (it == current.constEnd()) {
+            groupModel_->removeGroup(id);
+            continue;
+        }
+
+        const auto idx = groupModel_->indexForGroupId(id);
+        if (!idx.isValid()) {
+            groupModel_->insertGroup(it.value());
+            const auto inserted = groupModel_->indexForGroupId(id);
+            if (inserted.parent().isValid())
+                groupView_->expand(inserted.parent());
+            continue;
+        }
+
+        // The row may move to keep siblings sorted; the current index follows it.
+        if (idx.data(Qt::DisplayRole).toString() != it->name)
+            groupModel_->renameGroup(id, it->name);
+    }
+
+    filterEngine_->setGroupSubtree(groupModel_->subtree(selectedGroupId()));
 }
 
 void PasswordManagerPage::updateUiState()
@@ -861,16 +1024,21 @@ void PasswordManagerPage::addGroup()
     if (!ok)
         return;
 
-    const auto createdId = repo_->createGroup(selectedGroupId(), name);
+    const auto parentId = selectedGroupId();
+    const auto createdId = repo_->createGroup(parentId, name);
     if (!createdId.has_value()) {
         QMessageBox::warning(this, "失败", repo_->lastError());
         return;
     }
 
-    refreshGroups();
+    // Apply the change now rather than next tick, so the new group can be selected.
+    PasswordVaultEventBus::instance()->flush();
     const auto idx = groupModel_->indexForGroupId(createdId.value());
-    if (idx.isValid())
+    if (idx.isValid()) {
+        groupView_->expand(idx.parent());
         groupView_->setCurrentIndex(idx);
+    }
+    filterEngine_->setGroupSubtree(groupModel_->subtree(selectedGroupId()));
 }
 
 void PasswordManagerPage::renameSelectedGroup()
@@ -894,8 +1062,6 @@ void PasswordManagerPage::renameSelectedGroup()
         QMessageBox::warning(this, "失败", repo_->lastError());
         return;
     }
-
-    refreshGroups();
 }
 
 void PasswordManagerPage::deleteSelectedGroup()
@@ -921,10 +1087,11 @@ void PasswordManagerPage::deleteSelectedGroup()
         return;
     }
 
-    refreshGroups();
+    PasswordVaultEventBus::instance()->flush();
     const auto idx = groupModel_->indexForGroupId(parentGroupId);
     if (idx.isValid())
         groupView_->setCurrentIndex(idx);
+    filterEngine_->setGroupSubtree(groupModel_->subtree(selectedGroupId()));
 }
 
 void PasswordManagerPage::addEntry()
@@ -948,8 +1115,6 @@ void PasswordManagerPage::addEntry()
         QMessageBox::warning(this, "失败", repo_->lastError());
         return;
     }
-
-    refreshAll();
 }
 
 qint64 PasswordManagerPage::selectedEntryId() const
@@ -1006,8 +1171,6 @@ void PasswordManagerPage::editEntryById(qint64 id)
         QMessageBox::warning(this, "失败", repo_->lastError());
         return;
     }
-
-    refreshAll();
 }
 
 void PasswordManagerPage::deleteSelectedEntry()
@@ -1028,8 +1191,6 @@ void PasswordManagerPage::deleteSelectedEntry()
         QMessageBox::warning(this, "失败", repo_->lastError());
         return;
     }
-
-    refreshAll();
 }
 
 void PasswordManagerPage::moveSelectedEntryToGroup()
@@ -1123,8 +1284,6 @@ void PasswordManagerPage::moveSelectedEntryToGroup()
         QMessageBox::warning(this, "失败", repo_->lastError());
         return;
     }
-
-    refreshAll();
 }
 
 void PasswordManagerPage::copySelectedUsername()
@@ -1198,8 +1357,10 @@ void PasswordManagerPage::exportBackup()
     }
 
     QJsonArray entries;
-    for (const auto &summary : repo_->listEntries()) {
-        const auto full = repo_->loadEntry(summary.id);
+    const auto snapshot = repo_->snapshot();
+    const auto &summaries = snapshot->entries();
+    for (int row = 0; row < summaries.size(); ++row) {
+        const auto full = repo_->loadEntry(summaries.row(row).id());
         if (!full.has_value()) {
             QMessageBox::warning(this, "失败", repo_->lastError());
             return;
@@ -1455,7 +1616,6 @@ void PasswordManagerPage::importBackup()
         imported++;
     }
 
-    refreshAll();
     QMessageBox::information(this, "完成", QString("导入完成：%1 条。").arg(imported));
 }
 
@@ -1479,10 +1639,11 @@ void PasswordManagerPage::exportCsv()
         return;
 
     QVector<PasswordEntrySecrets> entries;
-    const auto summaries = repo_->listEntries();
+    const auto snapshot = repo_->snapshot();
+    const auto &summaries = snapshot->entries();
     entries.reserve(summaries.size());
-    for (const auto &summary : summaries) {
-        const auto full = repo_->loadEntry(summary.id);
+    for (int row = 0; row < summaries.size(); ++row) {
+        const auto full = repo_->loadEntry(summaries.row(row).id());
         if (!full.has_value()) {
             QMessageBox::warning(this, "失败", repo_->lastError());
             return;
@@ -1541,10 +1702,20 @@ void PasswordManagerPage::importCsv()
 
     connect(progress, &QProgressDialog::canceled, this, [worker]() { worker->requestCancel(); });
     connect(thread, &QThread::started, worker, &PasswordCsvImportWorker::run);
-    connect(worker, &PasswordCsvImportWorker::progressRangeChanged, progress, &QProgressDialog::setRange);
-    connect(worker, &PasswordCsvImportWorker::progressValueChanged, progress, &QProgressDialog::setValue);
+    auto *sampler = new ProgressSampler(progress);
+    connect(sampler, &ProgressSampler::rangeChanged, progress, &QProgressDialog::setRange);
+    connect(sampler, &ProgressSampler::valueChanged, progress, &QProgressDialog::setValue);
+    connect(sampler, &ProgressSampler::rateChanged, progress, [progress](double itemsPerSecond, qint64 remainingMs) {
+        if (remainingMs < 0)
+            return;
+        progress->setLabelText(QString("正在导入 CSV…（%1 条/秒，预计剩余 %2 秒）")
+                                   .arg(qRound(itemsPerSecond))
+                                   .arg((remainingMs + 999) / 1000));
+    });
+    sampler->start(worker->progress());
 
-    connect(worker, &PasswordCsvImportWorker::failed, this, [this, progress](const QString &error) {
+    connect(worker, &PasswordCsvImportWorker::failed, this, [this, progress, sampler](const QString &error) {
+        sampler->stop();
         progress->close();
         if (error.contains("取消")) {
             QMessageBox::information(this, "已取消", error);
@@ -1556,9 +1727,11 @@ void PasswordManagerPage::importCsv()
     connect(worker,
             &PasswordCsvImportWorker::finished,
             this,
-            [this, progress](int inserted, int updated, int skippedDuplicates, int skippedInvalid, const QStringList &warnings) {
+            [this, progress, sampler](int inserted, int updated, int skippedDuplicates, int skippedInvalid, const QStringList &warnings) {
+                sampler->stop();
                 progress->close();
-                refreshAll();
+                // The worker writes through its own connection, so the repository never saw these rows.
+                PasswordVaultEventBus::instance()->publishEntriesReset();
 
                 QString msg = QString("导入完成：\n新增：%1 条。\n更新：%2 条。\n跳过重复：%3 条。\n跳过无效：%4 条。")
                                   .arg(inserted)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QSet>
 #include <QWidget>
 
 class QComboBox;
@@ -14,9 +15,11 @@ class QTreeView;
 
 class PasswordEntryModel;
 class PasswordFaviconService;
+class PasswordFilterEngine;
 class PasswordGroupModel;
 class PasswordRepository;
 class PasswordVault;
+struct PasswordVaultChangeSet;
 
 class PasswordManagerPage final : public QWidget
 {
@@ -35,6 +38,9 @@ private:
     void refreshAll();
     void refreshCategories();
     void refreshGroups();
+    void applyVaultChanges(const PasswordVaultChangeSet &changes);
+    void applyGroupChanges(const QSet<qint64> &groupIds);
+    void applyEntryChanges(const QSet<qint64> &upsertedIds, const QSet<qint64> &removedIds);
     void updateUiState();
 
     void createVault();
@@ -105,6 +111,7 @@ private:
     PasswordFaviconService *faviconService_ = nullptr;
     PasswordGroupModel *groupModel_ = nullptr;
     QSortFilterProxyModel *proxy_ = nullptr;
+    PasswordFilterEngine *filterEngine_ = nullptr;
 
     QTimer *autoLockTimer_ = nullptr;
     QTimer *clipboardClearTimer_ = nullptr;
@@ -53,12 +53,12 @@ public:
 
         QVector<PasswordEntry> candidates;
         if (!host.isEmpty()) {
-            for (const auto &e : repo_->listEntries()) {
-                if (e.type != PasswordEntryType::WebLogin)
-                    continue;
-                if (!PasswordUrl::urlMatchesHost(e.url, host))
-                    continue;
-                candidates.push_back(e);
+            // Host lookup on the shared snapshot: no query and no scan per autofill click.
+            const auto snapshot = repo_->snapshot();
+            for (const auto row : snapshot->rowsForHost(host)) {
+                const auto e = snapshot->entries().row(row);
+                if (e.type() == PasswordEntryType::WebLogin)
+                    candidates.push_back(e.toEntry());
             }
         }
 
@@ -149,7 +149,7 @@ public:
         if (password.isEmpty())
             return;
 
-        const auto match = PasswordWebLoginMatcher::match(repo_->listEntries(), pageUrl, username);
+        const auto match = PasswordWebLoginMatcher::match(repo_->snapshot()->entries(), pageUrl, username);
         const auto host = match.host;
         if (host.isEmpty())
             return;
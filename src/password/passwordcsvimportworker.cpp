@@ -232,7 +232,8 @@ void PasswordCsvImportWorker::run()
         return;
     }
 
-    emit progressRangeChanged(0, parse.entries.size());
+    progress_->setValue(0);
+    progress_->setRange(0, parse.entries.size());
 
     const auto connectionName = QString("toolbox_password_csv_%1").arg(QUuid::createUuid().toString(QUuid::WithoutBraces));
     int inserted = 0;
@@ -298,7 +299,7 @@ void PasswordCsvImportWorker::run()
             auto secrets = parse.entries.at(i);
             if (secrets.entry.title.trimmed().isEmpty() || secrets.password.isEmpty()) {
                 skippedInvalid++;
-                emit progressValueChanged(i + 1);
+                progress_->setValue(i + 1);
                 continue;
             }
 
@@ -319,7 +320,7 @@ void PasswordCsvImportWorker::run()
 
             if (exists && options_.duplicatePolicy == PasswordCsvDuplicatePolicy::Skip) {
                 skippedDup++;
-                emit progressValueChanged(i + 1);
+                progress_->setValue(i + 1);
                 continue;
             }
 
@@ -418,7 +419,7 @@ void PasswordCsvImportWorker::run()
 
                 inserted++;
             }
-            emit progressValueChanged(i + 1);
+            progress_->setValue(i + 1);
         }
 
         if (transactionStarted) {
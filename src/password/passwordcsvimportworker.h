@@ -1,5 +1,6 @@
 #pragma once
 
+#include "core/progresschannel.h"
 #include "passwordentry.h"
 
 #include <QByteArray>
@@ -8,6 +9,7 @@
 #include <QStringList>
 
 #include <atomic>
+#include <memory>
 
 enum class PasswordCsvDuplicatePolicy : int
 {
@@ -37,10 +39,10 @@ public:
 
     void setOptions(PasswordCsvImportOptions options);
     void requestCancel();
+    // Parsed entries written so far.
+    std::shared_ptr<const ProgressChannel> progress() const { return progress_; }
 
 signals:
-    void progressRangeChanged(int min, int max);
-    void progressValueChanged(int value);
     void finished(int inserted, int updated, int skippedDuplicates, int skippedInvalid, const QStringList &warnings);
     void failed(const QString &error);
 
@@ -54,4 +56,5 @@ private:
     qint64 defaultGroupId_ = 1;
     PasswordCsvImportOptions options_;
     std::atomic_bool cancelRequested_{false};
+    const std::shared_ptr<ProgressChannel> progress_ = std::make_shared<ProgressChannel>();
 };
@@ -205,6 +205,15 @@ bool PasswordDatabase::ensureSchema(QSqlDatabase &database)
     )sql"))
         return false;
 
+    if (!query.exec(R"sql(
+        CREATE TABLE IF NOT EXISTS favicon_failures (
+            host TEXT PRIMARY KEY,
+            failures INTEGER NOT NULL,
+            retry_at INTEGER NOT NULL
+        )
+    )sql"))
+        return false;
+
     if (!query.exec(R"sql(
         CREATE TABLE IF NOT EXISTS pwned_prefix_cache (
             prefix TEXT PRIMARY KEY,
@@ -220,5 +229,47 @@ bool PasswordDatabase::ensureSchema(QSqlDatabase &database)
     )sql"))
         return false;
 
+    // Validators for conditional refreshes (If-None-Match / If-Modified-Since).
+    for (const auto *table : {"favicon_cache", "pwned_prefix_cache"}) {
+        if (!hasColumn(database, table, "etag")) {
+            if (!query.exec(QString("ALTER TABLE %1 ADD COLUMN etag TEXT").arg(table)))
+                return false;
+        }
+        if (!hasColumn(database, table, "last_modified")) {
+            if (!query.exec(QString("ALTER TABLE %1 ADD COLUMN last_modified TEXT").arg(table)))
+                return false;
+        }
+    }
+
+    // Per-entry health scan results (sealed with the vault key), valid for one (entry, updated_at, scanner) key.
+    if (!query.exec(R"sql(
+        CREATE TABLE IF NOT EXISTS health_analysis_cache (
+            entry_id INTEGER PRIMARY KEY,
+            updated_at INTEGER NOT NULL,
+            scanner_version INTEGER NOT NULL,
+            analysis_enc BLOB NOT NULL
+        )
+    )sql"))
+        return false;
+
+    // Dropped with the password it describes, whichever connection writes it (CSV import, re-key, raw SQL).
+    if (!query.exec(R"sql(
+        CREATE TRIGGER IF NOT EXISTS trg_health_analysis_cache_password
+        AFTER UPDATE OF password_enc ON password_entries
+        BEGIN
+            DELETE FROM health_analysis_cache WHERE entry_id = NEW.id;
+        END
+    )sql"))
+        return false;
+
+    if (!query.exec(R"sql(
+        CREATE TRIGGER IF NOT EXISTS trg_health_analysis_cache_delete
+        AFTER DELETE ON password_entries
+        BEGIN
+            DELETE FROM health_analysis_cache WHERE entry_id = OLD.id;
+        END
+    )sql"))
+        return false;
+
     return true;
 }
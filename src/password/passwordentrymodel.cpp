@@ -1,10 +1,82 @@
 #include "passwordentrymodel.h"
 
-#include "passworddatabase.h"
 #include "passwordfaviconservice.h"
+#include "passwordpinyin.h"
+#include "passwordvaultsnapshot.h"
 
-#include <QSqlQuery>
-#include <QUrl>
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QLocale>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+constexpr int kColumnCount = 6;
+constexpr int kUpdatedColumn = 5;
+// Rows per sort-key / sort chunk; smaller vaults are handled on the calling thread.
+constexpr int kSortChunkRows = 8192;
+
+struct SortChunk final
+{
+    int begin = 0;
+    int end = 0;
+    std::vector<QCollatorSortKey> keys;
+};
+
+QCollator makeCollator()
+{
+    // The system locale decides the order; for zh_CN that is pinyin order for Han characters.
+    QCollator collator{QLocale()};
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    collator.setNumericMode(true);
+    return collator;
+}
+
+QVector<SortChunk> makeSortChunks(int rows)
+{
+    QVector<SortChunk> chunks;
+    chunks.reserve(rows / kSortChunkRows + 1);
+    for (int begin = 0; begin < rows; begin += kSortChunkRows)
+        chunks.push_back(SortChunk{begin, qMin(begin + kSortChunkRows, rows), {}});
+    return chunks;
+}
+
+// Stable sort of `order`: chunks are sorted on the thread pool, then merged pairwise.
+template<typename Less>
+void stableSortRows(std::vector<int> &order, Less less)
+{
+    const auto n = static_cast<int>(order.size());
+    if (n <= kSortChunkRows) {
+        std::stable_sort(order.begin(), order.end(), less);
+        return;
+    }
+
+    auto chunks = makeSortChunks(n);
+    QtConcurrent::blockingMap(chunks, [&](const SortChunk &chunk) {
+        std::stable_sort(order.begin() + chunk.begin, order.begin() + chunk.end, less);
+    });
+    for (int width = kSortChunkRows; width < n; width *= 2) {
+        for (int begin = 0; begin + width < n; begin += 2 * width)
+            std::inplace_merge(order.begin() + begin, order.begin() + begin + width, order.begin() + qMin(begin + 2 * width, n), less);
+    }
+}
+
+// Adds the "full initials" pinyin of a Chinese title and returns its id; -1 when the title has no Han.
+int appendTitlePinyin(PasswordEntryModel::FilterRows &rows, const QString &title)
+{
+    if (!PasswordPinyin::containsHan(title))
+        return -1;
+    const auto pinyin = PasswordPinyin::keysFor(title);
+    rows.titlePinyin.push_back(pinyin.full + QLatin1Char(' ') + pinyin.initials);
+    return rows.titlePinyin.size() - 1;
+}
+
+} // namespace
 
 PasswordEntryModel::PasswordEntryModel(QObject *parent) : QAbstractTableModel(parent)
 {
@@ -24,39 +96,19 @@ void PasswordEntryModel::setFaviconService(PasswordFaviconService *service)
         return;
 
     connect(faviconService_, &PasswordFaviconService::iconUpdated, this, [this](const QString &host) {
-        if (items_.isEmpty())
+        const auto it = rowsByHost_.constFind(host);
+        if (it == rowsByHost_.constEnd())
             return;
 
-        auto hostMatchesRow = [&](int row) {
-            if (row < 0 || row >= items_.size())
-                return false;
-
-            const auto urlText = items_.at(row).url.trimmed();
-            if (urlText.isEmpty())
-                return false;
-
-            QUrl u(urlText);
-            if (u.scheme().isEmpty() && urlText.contains('.') && !urlText.contains("://"))
-                u = QUrl(QString("https://%1").arg(urlText));
-            if (u.scheme() != "http" && u.scheme() != "https")
-                return false;
-            return u.host().trimmed().compare(host, Qt::CaseInsensitive) == 0;
-        };
-
-        int first = -1;
-        int last = -1;
-        for (int i = 0; i < items_.size(); ++i) {
-            if (!hostMatchesRow(i))
-                continue;
-            if (first < 0)
-                first = i;
-            last = i;
+        // One dataChanged per run of adjacent rows, so unrelated rows in between are not repainted.
+        const auto &rows = it.value();
+        for (int i = 0; i < rows.size();) {
+            int j = i;
+            while (j + 1 < rows.size() && rows.at(j + 1) == rows.at(j) + 1)
+                ++j;
+            emit dataChanged(index(rows.at(i), 0), index(rows.at(j), 0), {Qt::DecorationRole});
+            i = j + 1;
         }
-
-        if (first < 0)
-            return;
-
-        emit dataChanged(index(first, 0), index(last, 0), {Qt::DecorationRole});
     });
 }
 
@@ -64,64 +116,69 @@ int PasswordEntryModel::rowCount(const QModelIndex &parent) const
 {
     if (parent.isValid())
         return 0;
-    return items_.size();
+    return store_.size();
 }
 
 int PasswordEntryModel::columnCount(const QModelIndex &parent) const
 {
     if (parent.isValid())
         return 0;
-    return 6;
+    return kColumnCount;
 }
 
 QVariant PasswordEntryModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || index.row() < 0 || index.row() >= items_.size())
+    if (!index.isValid() || index.row() < 0 || index.row() >= store_.size())
         return {};
 
-    const auto &item = items_[index.row()];
+    const auto item = store_.row(index.row());
     if (role == GroupIdRole)
-        return item.groupId;
+        return item.groupId();
 
     if (role == TagsRole)
-        return item.tags;
+        return item.tags();
 
     if (role == EntryTypeRole)
-        return static_cast<int>(item.type);
+        return static_cast<int>(item.type());
 
     if (role == Qt::DecorationRole && index.column() == 0 && faviconService_) {
-        const auto icon = faviconService_->iconForUrl(item.url);
-        if (!icon.isNull())
-            return icon;
+        const auto hostId = iconHostIds_.at(index.row());
+        if (hostId >= 0) {
+            const auto &key = iconHosts_.at(hostId);
+            const auto icon = faviconService_->iconForHost(key.host, key.scheme);
+            if (!icon.isNull())
+                return icon;
+        }
     }
 
     if (role == Qt::DisplayRole) {
         switch (index.column()) {
         case 0:
-            return item.title;
+            return item.title().toString();
         case 1:
-            return item.username;
+            return item.username().toString();
         case 2:
-            return item.url;
+            return item.url().toString();
         case 3:
-            return item.category.isEmpty() ? "未分类" : item.category;
+            return item.category().isEmpty() ? "未分类" : item.category();
         case 4:
-            return item.tags.join(", ");
+            return item.tags().join(", ");
         case 5:
-            return item.updatedAt.toString("MM-dd HH:mm");
+            return QDateTime::fromSecsSinceEpoch(item.updatedAtSecs()).toString("MM-dd HH:mm");
         default:
             return {};
         }
     }
 
     if (role == Qt::ToolTipRole) {
+        const auto tags = item.tags();
         return QString("标题：%1\n类型：%2\n账号：%3\n网址：%4\n分类：%5\n标签：%6")
-            .arg(item.title,
-                 passwordEntryTypeLabel(item.type),
-                 item.username,
-                 item.url,
-                 item.category.isEmpty() ? "未分类" : item.category,
-                 item.tags.isEmpty() ? "-" : item.tags.join(", "));
+            .arg(item.title().toString(),
+                 passwordEntryTypeLabel(item.type()),
+                 item.username().toString(),
+                 item.url().toString(),
+                 item.category().isEmpty() ? "未分类" : item.category(),
+                 tags.isEmpty() ? "-" : tags.join(", "));
     }
 
     return {};
@@ -153,61 +210,278 @@ QVariant PasswordEntryModel::headerData(int section, Qt::Orientation orientation
 void PasswordEntryModel::reload()
 {
     beginResetModel();
-    items_.clear();
+    store_.clear();
+    filterRows_ = {};
+    iconHostIds_.clear();
+    iconHosts_.clear();
+    iconHostIdsByHost_.clear();
+    rowsByHost_.clear();
+    rowById_.clear();
+    sortRanks_.clear();
 
-    auto database = PasswordDatabase::db();
-    if (!database.isOpen()) {
-        endResetModel();
-        return;
+    // Shared with every other reader of the current vault revision; copying the store only bumps refcounts.
+    store_ = PasswordVaultSnapshot::current()->entries();
+
+    iconHostIds_.reserve(store_.size());
+    rowById_.reserve(store_.size());
+    for (int row = 0; row < store_.size(); ++row) {
+        iconHostIds_.push_back(iconHostIdFor(store_.row(row).url()));
+        rowById_.insert(store_.row(row).id(), row);
     }
+    rebuildRowsByHost();
+
+    filterRows_ = FilterRows::fromStore(store_);
+
+    searchIndex_.sync(store_);
+    endResetModel();
+}
 
-    QSqlQuery query(database);
-    query.prepare(R"sql(
-        SELECT
-            e.id,
-            e.group_id,
-            e.entry_type,
-            e.title,
-            e.username,
-            e.url,
-            e.category,
-            e.created_at,
-            e.updated_at,
-            GROUP_CONCAT(t.name, ',') AS tags_csv
-        FROM password_entries e
-        LEFT JOIN entry_tags et ON et.entry_id = e.id
-        LEFT JOIN tags t ON t.id = et.tag_id
-        GROUP BY e.id
-        ORDER BY e.updated_at DESC
-    )sql");
-
-    if (query.exec()) {
-        while (query.next()) {
-            PasswordEntry entry;
-            entry.id = query.value(0).toLongLong();
-            entry.groupId = query.value(1).toLongLong();
-            entry.type = passwordEntryTypeFromInt(query.value(2).toInt());
-            entry.title = query.value(3).toString();
-            entry.username = query.value(4).toString();
-            entry.url = query.value(5).toString();
-            entry.category = query.value(6).toString();
-            entry.createdAt = QDateTime::fromSecsSinceEpoch(query.value(7).toLongLong());
-            entry.updatedAt = QDateTime::fromSecsSinceEpoch(query.value(8).toLongLong());
-            const auto tagsCsv = query.value(9).toString();
-            if (!tagsCsv.trimmed().isEmpty()) {
-                for (const auto &tag : tagsCsv.split(',', Qt::SkipEmptyParts))
-                    entry.tags.push_back(tag.trimmed());
+void PasswordEntryModel::applyChanges(const QHash<qint64, PasswordEntry> &upserted, const QSet<qint64> &removed)
+{
+    QVector<int> removedRows;
+    for (const auto id : removed) {
+        const auto row = rowForId(id);
+        if (row >= 0)
+            removedRows.push_back(row);
+    }
+    if (removedRows.isEmpty() && upserted.isEmpty())
+        return;
+
+    // filterRows_ would otherwise keep sharing the store and turn the first edit into a full copy.
+    filterRows_.store = PasswordEntryStore();
+
+    // Removals first, bottom up, one signal per run of adjacent rows. Dropping a row keeps the order of the
+    // cached sort ranks, so they stay usable.
+    std::sort(removedRows.begin(), removedRows.end(), std::greater<int>());
+    for (int i = 0; i < removedRows.size();) {
+        int j = i;
+        while (j + 1 < removedRows.size() && removedRows.at(j + 1) == removedRows.at(j) - 1)
+            ++j;
+        beginRemoveRows(QModelIndex(), removedRows.at(j), removedRows.at(i));
+        for (int k = i; k <= j; ++k) {
+            const auto row = removedRows.at(k);
+            const auto id = store_.row(row).id();
+            for (auto &ranks : sortRanks_) {
+                if (ranks.size() == store_.size())
+                    ranks.remove(row);
+                else
+                    ranks.clear();
             }
-            items_.push_back(entry);
+            rowById_.remove(id);
+            searchIndex_.remove(id);
+            store_.remove(row);
+            filterRows_.titlePinyinIds.remove(row);
+            iconHostIds_.remove(row);
         }
+        endRemoveRows();
+        i = j + 1;
+    }
+    if (!removedRows.isEmpty()) {
+        for (int row = removedRows.last(); row < store_.size(); ++row)
+            rowById_.insert(store_.row(row).id(), row);
     }
 
-    endResetModel();
+    QVector<int> updatedRows;
+    QVector<qint64> addedIds;
+    for (auto it = upserted.constBegin(); it != upserted.constEnd(); ++it) {
+        if (removed.contains(it.key()))
+            continue;
+        const auto row = rowForId(it.key());
+        if (row < 0) {
+            addedIds.push_back(it.key());
+            continue;
+        }
+
+        const auto &entry = it.value();
+        if (store_.row(row).title() != QStringView(entry.title))
+            filterRows_.titlePinyinIds[row] = appendTitlePinyin(filterRows_, entry.title);
+        store_.update(row, entry);
+        iconHostIds_[row] = iconHostIdFor(entry.url);
+        searchIndex_.upsert(entry);
+        updatedRows.push_back(row);
+    }
+    if (!updatedRows.isEmpty()) {
+        sortRanks_.clear();
+        std::sort(updatedRows.begin(), updatedRows.end());
+        for (int i = 0; i < updatedRows.size();) {
+            int j = i;
+            while (j + 1 < updatedRows.size() && updatedRows.at(j + 1) == updatedRows.at(j) + 1)
+                ++j;
+            emit dataChanged(index(updatedRows.at(i), 0), index(updatedRows.at(j), kColumnCount - 1));
+            i = j + 1;
+        }
+    }
+
+    if (!addedIds.isEmpty()) {
+        // New entries go to the bottom in id order; the view's sort places them.
+        std::sort(addedIds.begin(), addedIds.end());
+        const auto first = store_.size();
+        beginInsertRows(QModelIndex(), first, first + addedIds.size() - 1);
+        for (const auto id : addedIds) {
+            const auto entry = upserted.value(id);
+            const auto row = store_.append(entry);
+            rowById_.insert(id, row);
+            filterRows_.titlePinyinIds.push_back(appendTitlePinyin(filterRows_, entry.title));
+            iconHostIds_.push_back(iconHostIdFor(entry.url));
+            searchIndex_.upsert(entry);
+        }
+        endInsertRows();
+    }
+
+    rebuildRowsByHost();
+    filterRows_.store = store_;
+    filterRows_.foldNewVocabulary();
 }
 
 PasswordEntry PasswordEntryModel::itemAt(int row) const
 {
-    if (row < 0 || row >= items_.size())
+    if (row < 0 || row >= store_.size())
+        return {};
+    return store_.entryAt(row);
+}
+
+std::shared_ptr<const PasswordSearchIndex> PasswordEntryModel::searchIndex() const
+{
+    // Copying only bumps the reference counts of the index containers; later syncs detach from the snapshot.
+    return std::make_shared<const PasswordSearchIndex>(searchIndex_);
+}
+
+const QVector<int> &PasswordEntryModel::sortRanks(int column) const
+{
+    static const QVector<int> kEmpty;
+    if (column < 0 || column >= kColumnCount)
+        return kEmpty;
+
+    if (sortRanks_.size() != kColumnCount)
+        sortRanks_.resize(kColumnCount);
+    auto &ranks = sortRanks_[column];
+    if (ranks.size() == store_.size())
+        return ranks;
+
+    const auto n = store_.size();
+    std::vector<int> order(static_cast<size_t>(n));
+    std::iota(order.begin(), order.end(), 0);
+
+    if (column == kUpdatedColumn) {
+        // The column shows "MM-dd HH:mm"; sort on the full timestamp so different years order correctly.
+        std::vector<qint64> stamps(static_cast<size_t>(n));
+        for (int row = 0; row < n; ++row)
+            stamps[static_cast<size_t>(row)] = store_.row(row).updatedAtSecs();
+        stableSortRows(order, [&](int a, int b) { return stamps[static_cast<size_t>(a)] < stamps[static_cast<size_t>(b)]; });
+    } else {
+        // Sort keys are built once per row, so each comparison is a byte compare instead of a collation.
+        auto chunks = makeSortChunks(n);
+        const auto buildKeys = [&](SortChunk &chunk) {
+            const auto collator = makeCollator(); // one per thread; QCollator is reentrant, not thread-safe
+            chunk.keys.reserve(static_cast<size_t>(chunk.end - chunk.begin));
+            for (int row = chunk.begin; row < chunk.end; ++row)
+                chunk.keys.push_back(collator.sortKey(sortText(store_.row(row), column)));
+        };
+        if (chunks.size() > 1)
+            QtConcurrent::blockingMap(chunks, buildKeys);
+        else if (!chunks.isEmpty())
+            buildKeys(chunks.first());
+
+        const auto keyAt = [&](int row) -> const QCollatorSortKey & {
+            return chunks.at(row / kSortChunkRows).keys[static_cast<size_t>(row % kSortChunkRows)];
+        };
+        stableSortRows(order, [&](int a, int b) { return keyAt(a).compare(keyAt(b)) < 0; });
+    }
+
+    ranks.resize(n);
+    for (int pos = 0; pos < n; ++pos)
+        ranks[order[static_cast<size_t>(pos)]] = pos;
+    return ranks;
+}
+
+int PasswordEntryModel::iconHostIdFor(QStringView url)
+{
+    IconKey iconKey;
+    iconKey.host = PasswordFaviconService::hostForUrl(url.toString(), &iconKey.scheme);
+    if (iconKey.host.isEmpty())
+        return -1;
+
+    const auto it = iconHostIdsByHost_.constFind(iconKey.host);
+    if (it != iconHostIdsByHost_.constEnd())
+        return it.value();
+
+    const auto id = iconHosts_.size();
+    iconHostIdsByHost_.insert(iconKey.host, id);
+    iconHosts_.push_back(iconKey);
+    return id;
+}
+
+void PasswordEntryModel::rebuildRowsByHost()
+{
+    rowsByHost_.clear();
+    for (int row = 0; row < iconHostIds_.size(); ++row) {
+        const auto hostId = iconHostIds_.at(row);
+        if (hostId >= 0)
+            rowsByHost_[iconHosts_.at(hostId).host].push_back(row);
+    }
+}
+
+QString PasswordEntryModel::sortText(const PasswordEntryStore::Row &row, int column)
+{
+    switch (column) {
+    case 0:
+        return row.title().toString();
+    case 1:
+        return row.username().toString();
+    case 2:
+        return row.url().toString();
+    case 3:
+        return row.category().isEmpty() ? QStringLiteral("未分类") : row.category();
+    case 4:
+        return row.tags().join(", ");
+    default:
         return {};
-    return items_[row];
+    }
+}
+
+PasswordEntryModel::FilterRows PasswordEntryModel::FilterRows::fromStore(const PasswordEntryStore &store)
+{
+    FilterRows rows;
+    rows.store = store;
+    rows.foldNewVocabulary();
+
+    QHash<QString, int> pinyinIdByTitle;
+    rows.titlePinyinIds.reserve(store.size());
+    for (int row = 0; row < store.size(); ++row) {
+        const auto title = store.row(row).title().toString();
+        int pinyinId = -1;
+        if (PasswordPinyin::containsHan(title)) {
+            const auto it = pinyinIdByTitle.constFind(title);
+            if (it != pinyinIdByTitle.constEnd()) {
+                pinyinId = it.value();
+            } else {
+                pinyinId = appendTitlePinyin(rows, title);
+                pinyinIdByTitle.insert(title, pinyinId);
+            }
+        }
+        rows.titlePinyinIds.push_back(pinyinId);
+    }
+    return rows;
+}
+
+void PasswordEntryModel::FilterRows::foldNewVocabulary()
+{
+    // Categories and tags come from small vocabularies: fold each once and let every row refer to it by id.
+    categoryLabels.reserve(store.categoryCount());
+    foldedCategories.reserve(store.categoryCount());
+    for (int id = foldedCategories.size(); id < store.categoryCount(); ++id) {
+        const auto label = store.category(id).isEmpty() ? QStringLiteral("未分类") : store.category(id);
+        auto folded = label.toCaseFolded();
+        // Latin initials / full pinyin for Chinese titles and categories, so "zfb" finds 支付宝 without an IME.
+        if (PasswordPinyin::containsHan(label)) {
+            const auto pinyin = PasswordPinyin::keysFor(label);
+            folded += QLatin1Char(' ') + pinyin.full + QLatin1Char(' ') + pinyin.initials;
+        }
+        categoryLabels.push_back(label);
+        foldedCategories.push_back(folded);
+    }
+
+    foldedTags.reserve(store.tagCount());
+    for (int id = foldedTags.size(); id < store.tagCount(); ++id)
+        foldedTags.push_back(store.tag(id).toCaseFolded());
 }
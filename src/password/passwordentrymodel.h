@@ -1,10 +1,16 @@
 #pragma once
 
 #include "passwordentry.h"
+#include "passwordentrystore.h"
+#include "passwordsearchindex.h"
 
 #include <QAbstractTableModel>
+#include <QHash>
+#include <QSet>
 #include <QVector>
 
+#include <memory>
+
 class PasswordEntryModel final : public QAbstractTableModel
 {
     Q_OBJECT
@@ -17,6 +23,24 @@ public:
         EntryTypeRole,
     };
 
+    // What the filter reads. Rows are the store's own views; the only folded strings are one per category, tag
+    // and distinct Chinese title, so the filter adds a single int per row on top of the store. Copies share
+    // everything and can be handed to a worker thread.
+    struct FilterRows final
+    {
+        PasswordEntryStore store;
+        QVector<QString> categoryLabels;   // by store category id; "未分类" for the empty category
+        QVector<QString> foldedCategories; // by category id: folded label, plus pinyin for Chinese categories
+        QVector<QString> foldedTags;       // by store tag id
+        QVector<int> titlePinyinIds;       // per row: index into titlePinyin, or -1 when the title has no Han
+        QVector<QString> titlePinyin;      // "full initials", one per distinct Chinese title
+
+        int size() const { return store.size(); }
+        static FilterRows fromStore(const PasswordEntryStore &store);
+        // Folds the categories and tags the store interned since the last call.
+        void foldNewVocabulary();
+    };
+
     explicit PasswordEntryModel(QObject *parent = nullptr);
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
@@ -27,9 +51,39 @@ public:
     void setFaviconService(class PasswordFaviconService *service);
 
     void reload();
+    // Applies committed edits without a reset: known ids are updated in place, new ones appended and removed
+    // ids dropped, each with its own row signals. reload() stays the path for bulk changes.
+    void applyChanges(const QHash<qint64, PasswordEntry> &upserted, const QSet<qint64> &removed);
+    int rowForId(qint64 entryId) const { return rowById_.value(entryId, -1); }
+    // Materializes one row; prefer store() views for scans.
     PasswordEntry itemAt(int row) const;
+    const PasswordEntryStore &store() const { return store_; }
+    const FilterRows &filterRows() const { return filterRows_; }
+    std::shared_ptr<const PasswordSearchIndex> searchIndex() const;
+
+    // Position of every row when the table is sorted ascending by `column` (locale-aware collation, stable).
+    // Built from cached QCollator sort keys on first use and kept until the data changes.
+    const QVector<int> &sortRanks(int column) const;
 
 private:
-    QVector<PasswordEntry> items_;
+    struct IconKey final
+    {
+        QString host;
+        QString scheme;
+    };
+
+    static QString sortText(const PasswordEntryStore::Row &row, int column);
+    int iconHostIdFor(QStringView url);
+    void rebuildRowsByHost();
+
+    PasswordEntryStore store_;
+    FilterRows filterRows_;
+    QVector<int> iconHostIds_;      // per row, index into iconHosts_ or -1 without an http(s) URL
+    QVector<IconKey> iconHosts_;
+    QHash<QString, int> iconHostIdsByHost_;
+    QHash<QString, QVector<int>> rowsByHost_; // ascending rows per favicon host
+    QHash<qint64, int> rowById_;
+    PasswordSearchIndex searchIndex_;
+    mutable QVector<QVector<int>> sortRanks_;
     class PasswordFaviconService *faviconService_ = nullptr;
 };
@@ -0,0 +1,214 @@
+#include "passwordentrystore.h"
+
+#include "passwordurl.h"
+
+PasswordEntryStore::StringPool::StringPool()
+{
+    clear();
+}
+
+void PasswordEntryStore::StringPool::clear()
+{
+    strings_.clear();
+    ids_.clear();
+    strings_.push_back(QString());
+    ids_.insert(QString(), 0);
+}
+
+int PasswordEntryStore::StringPool::intern(const QString &text)
+{
+    if (text.isEmpty())
+        return 0;
+
+    const auto it = ids_.constFind(text);
+    if (it != ids_.constEnd())
+        return it.value();
+
+    const auto id = strings_.size();
+    strings_.push_back(text);
+    ids_.insert(text, id);
+    return id;
+}
+
+PasswordEntryStore::StringArena::StringArena()
+{
+    clear();
+}
+
+void PasswordEntryStore::StringArena::clear()
+{
+    chars_.clear();
+    offsets_.clear();
+    offsets_.push_back(0);
+}
+
+void PasswordEntryStore::StringArena::reserve(int rows)
+{
+    offsets_.reserve(rows + 1);
+}
+
+void PasswordEntryStore::StringArena::append(const QString &text)
+{
+    chars_.append(text);
+    offsets_.push_back(chars_.size());
+}
+
+void PasswordEntryStore::StringArena::replace(int row, const QString &text)
+{
+    const auto begin = offsets_.at(row);
+    const auto length = offsets_.at(row + 1) - begin;
+    chars_.replace(begin, length, text);
+    const auto delta = static_cast<int>(text.size()) - length;
+    if (delta == 0)
+        return;
+    for (int i = row + 1; i < offsets_.size(); ++i)
+        offsets_[i] += delta;
+}
+
+void PasswordEntryStore::StringArena::remove(int row)
+{
+    const auto begin = offsets_.at(row);
+    const auto length = offsets_.at(row + 1) - begin;
+    chars_.remove(begin, length);
+    offsets_.remove(row + 1);
+    for (int i = row + 1; i < offsets_.size(); ++i)
+        offsets_[i] -= length;
+}
+
+QStringList PasswordEntryStore::Row::tags() const
+{
+    QStringList out;
+    const auto n = tagCount();
+    out.reserve(n);
+    for (int i = 0; i < n; ++i)
+        out.push_back(tag(i));
+    return out;
+}
+
+PasswordEntry PasswordEntryStore::Row::toEntry() const
+{
+    PasswordEntry entry;
+    entry.id = id();
+    entry.groupId = groupId();
+    entry.type = type();
+    entry.title = title().toString();
+    entry.username = username().toString();
+    entry.url = url().toString();
+    entry.category = category();
+    entry.tags = tags();
+    entry.createdAt = QDateTime::fromSecsSinceEpoch(createdAtSecs());
+    entry.updatedAt = QDateTime::fromSecsSinceEpoch(updatedAtSecs());
+    return entry;
+}
+
+PasswordEntryStore PasswordEntryStore::fromEntries(const QVector<PasswordEntry> &entries)
+{
+    PasswordEntryStore store;
+    store.reserve(entries.size());
+    for (const auto &entry : entries)
+        store.append(entry);
+    return store;
+}
+
+void PasswordEntryStore::clear()
+{
+    ids_.clear();
+    groupIds_.clear();
+    createdAt_.clear();
+    updatedAt_.clear();
+    types_.clear();
+    titles_.clear();
+    usernames_.clear();
+    urls_.clear();
+    categoryIds_.clear();
+    hostIds_.clear();
+    tagIds_.clear();
+    tagOffsets_.clear();
+    tagOffsets_.push_back(0);
+    categories_.clear();
+    hosts_.clear();
+    tags_.clear();
+}
+
+void PasswordEntryStore::reserve(int rows)
+{
+    ids_.reserve(rows);
+    groupIds_.reserve(rows);
+    createdAt_.reserve(rows);
+    updatedAt_.reserve(rows);
+    types_.reserve(rows);
+    titles_.reserve(rows);
+    usernames_.reserve(rows);
+    urls_.reserve(rows);
+    categoryIds_.reserve(rows);
+    hostIds_.reserve(rows);
+    tagOffsets_.reserve(rows + 1);
+}
+
+int PasswordEntryStore::append(const PasswordEntry &entry)
+{
+    const auto row = ids_.size();
+    ids_.push_back(entry.id);
+    groupIds_.push_back(entry.groupId);
+    createdAt_.push_back(entry.createdAt.isValid() ? entry.createdAt.toSecsSinceEpoch() : 0);
+    updatedAt_.push_back(entry.updatedAt.isValid() ? entry.updatedAt.toSecsSinceEpoch() : 0);
+    types_.push_back(static_cast<quint8>(entry.type));
+    titles_.append(entry.title);
+    usernames_.append(entry.username);
+    urls_.append(entry.url);
+    categoryIds_.push_back(categories_.intern(entry.category));
+    hostIds_.push_back(hosts_.intern(PasswordUrl::hostFromUrl(entry.url)));
+    for (const auto &tag : entry.tags)
+        tagIds_.push_back(tags_.intern(tag));
+    tagOffsets_.push_back(tagIds_.size());
+    return row;
+}
+
+void PasswordEntryStore::update(int row, const PasswordEntry &entry)
+{
+    ids_[row] = entry.id;
+    groupIds_[row] = entry.groupId;
+    createdAt_[row] = entry.createdAt.isValid() ? entry.createdAt.toSecsSinceEpoch() : 0;
+    updatedAt_[row] = entry.updatedAt.isValid() ? entry.updatedAt.toSecsSinceEpoch() : 0;
+    types_[row] = static_cast<quint8>(entry.type);
+    titles_.replace(row, entry.title);
+    usernames_.replace(row, entry.username);
+    urls_.replace(row, entry.url);
+    categoryIds_[row] = categories_.intern(entry.category);
+    hostIds_[row] = hosts_.intern(PasswordUrl::hostFromUrl(entry.url));
+
+    // Resize the row's tag range in place, then overwrite it.
+    const auto begin = tagOffsets_.at(row);
+    const auto delta = static_cast<int>(entry.tags.size()) - (tagOffsets_.at(row + 1) - begin);
+    if (delta > 0)
+        tagIds_.insert(begin, delta, 0);
+    else if (delta < 0)
+        tagIds_.remove(begin, -delta);
+    for (int i = 0; i < entry.tags.size(); ++i)
+        tagIds_[begin + i] = tags_.intern(entry.tags.at(i));
+    if (delta != 0) {
+        for (int i = row + 1; i < tagOffsets_.size(); ++i)
+            tagOffsets_[i] += delta;
+    }
+}
+
+void PasswordEntryStore::remove(int row)
+{
+    ids_.remove(row);
+    groupIds_.remove(row);
+    createdAt_.remove(row);
+    updatedAt_.remove(row);
+    types_.remove(row);
+    titles_.remove(row);
+    usernames_.remove(row);
+    urls_.remove(row);
+    categoryIds_.remove(row);
+    hostIds_.remove(row);
+
+    const auto begin = tagOffsets_.at(row);
+    const auto count = tagOffsets_.at(row + 1) - begin;
+    tagIds_.remove(begin, count);
+    tagOffsets_.remove(row + 1);
+    for (int i = row + 1; i < tagOffsets_.size(); ++i)
+        tagOffsets_[i] -= count;
+}
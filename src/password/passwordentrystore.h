@@ -0,0 +1,127 @@
+#pragma once
+
+#include "passwordentry.h"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+// Column-oriented entry list. Timestamps are plain seconds, categories/hosts/tags are interned into small
+// vocabularies, and titles, usernames and URLs live back to back in one UTF-16 buffer per column, so a
+// vault costs a few arrays instead of a dozen heap objects per entry. Readers go through Row views;
+// entryAt() materializes a PasswordEntry when an API still wants one.
+// Copies are cheap (implicitly shared containers), so a snapshot can be handed to a worker thread.
+class PasswordEntryStore final
+{
+public:
+    class Row final
+    {
+    public:
+        qint64 id() const { return store_->ids_.at(row_); }
+        qint64 groupId() const { return store_->groupIds_.at(row_); }
+        PasswordEntryType type() const { return passwordEntryTypeFromInt(store_->types_.at(row_)); }
+        QStringView title() const { return store_->titles_.at(row_); }
+        QStringView username() const { return store_->usernames_.at(row_); }
+        QStringView url() const { return store_->urls_.at(row_); }
+        const QString &category() const { return store_->categories_.at(store_->categoryIds_.at(row_)); }
+        int categoryId() const { return store_->categoryIds_.at(row_); }
+        // PasswordUrl::hostFromUrl(url()), computed once on append; empty when the URL has no host.
+        const QString &host() const { return store_->hosts_.at(store_->hostIds_.at(row_)); }
+        int hostId() const { return store_->hostIds_.at(row_); }
+        int tagCount() const { return store_->tagOffsets_.at(row_ + 1) - store_->tagOffsets_.at(row_); }
+        int tagId(int i) const { return store_->tagIds_.at(store_->tagOffsets_.at(row_) + i); }
+        const QString &tag(int i) const { return store_->tags_.at(tagId(i)); }
+        QStringList tags() const;
+        qint64 createdAtSecs() const { return store_->createdAt_.at(row_); }
+        qint64 updatedAtSecs() const { return store_->updatedAt_.at(row_); }
+
+        PasswordEntry toEntry() const;
+
+    private:
+        friend class PasswordEntryStore;
+        Row(const PasswordEntryStore *store, int row) : store_(store), row_(row) {}
+
+        const PasswordEntryStore *store_ = nullptr;
+        int row_ = 0;
+    };
+
+    PasswordEntryStore() { clear(); }
+    static PasswordEntryStore fromEntries(const QVector<PasswordEntry> &entries);
+
+    void clear();
+    void reserve(int rows);
+    int size() const { return ids_.size(); }
+    bool isEmpty() const { return ids_.isEmpty(); }
+
+    // Returns the new row.
+    int append(const PasswordEntry &entry);
+    // In-place edits keep the columns packed, so later rows shift; vocabularies only grow until clear().
+    void update(int row, const PasswordEntry &entry);
+    void remove(int row);
+    Row row(int index) const { return Row(this, index); }
+    PasswordEntry entryAt(int index) const { return Row(this, index).toEntry(); }
+
+    // Interned vocabularies; id 0 is always the empty string.
+    int categoryCount() const { return categories_.size(); }
+    const QString &category(int id) const { return categories_.at(id); }
+    int hostCount() const { return hosts_.size(); }
+    const QString &host(int id) const { return hosts_.at(id); }
+    int tagCount() const { return tags_.size(); }
+    const QString &tag(int id) const { return tags_.at(id); }
+    int findTag(const QString &tag) const { return tags_.find(tag); }
+    int findHost(const QString &host) const { return hosts_.find(host); }
+
+private:
+    class StringPool final
+    {
+    public:
+        StringPool();
+        void clear();
+        int intern(const QString &text);
+        int find(const QString &text) const { return ids_.value(text, -1); }
+        const QString &at(int id) const { return strings_.at(id); }
+        int size() const { return strings_.size(); }
+
+    private:
+        QVector<QString> strings_;
+        QHash<QString, int> ids_;
+    };
+
+    class StringArena final
+    {
+    public:
+        StringArena();
+        void clear();
+        void reserve(int rows);
+        void append(const QString &text);
+        void replace(int row, const QString &text);
+        void remove(int row);
+        QStringView at(int row) const
+        {
+            const auto begin = offsets_.at(row);
+            return QStringView(chars_).mid(begin, offsets_.at(row + 1) - begin);
+        }
+
+    private:
+        QString chars_;
+        QVector<int> offsets_; // row i is chars_[offsets_[i], offsets_[i + 1])
+    };
+
+    QVector<qint64> ids_;
+    QVector<qint64> groupIds_;
+    QVector<qint64> createdAt_;
+    QVector<qint64> updatedAt_;
+    QVector<quint8> types_;
+    StringArena titles_;
+    StringArena usernames_;
+    StringArena urls_;
+    QVector<int> categoryIds_;
+    QVector<int> hostIds_;
+    QVector<int> tagIds_;
+    QVector<int> tagOffsets_; // row i owns tagIds_[tagOffsets_[i], tagOffsets_[i + 1])
+    StringPool categories_;
+    StringPool hosts_;
+    StringPool tags_;
+};
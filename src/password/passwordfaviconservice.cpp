@@ -3,69 +3,177 @@
 #include "passworddatabase.h"
 
 #include <QDateTime>
-#include <QImage>
+#include <QFutureWatcher>
 #include <QNetworkReply>
 #include <QPixmap>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QTimer>
 #include <QUrl>
+#include <QUuid>
+#include <QtConcurrent>
 
-#include <optional>
+#include <iterator>
 
 namespace {
 
 constexpr qint64 kCacheTtlSecs = 14 * 86400;
 constexpr qsizetype kMaxIconBytes = 256 * 1024;
+// Decoded icons kept in memory; evicted hosts are simply decoded again from favicon_cache.
+constexpr int kIconCacheKiB = 32 * 1024;
+// Hosts loaded per pool job (one SQLite connection per job).
+constexpr int kDecodeBatchHosts = 32;
+// 16 px for 1x, 32/48 px for 2x/3x displays.
+constexpr int kIconSizes[] = {16, 32, 48};
+constexpr int kMaxConcurrentFetches = 6;
+// Failed hosts are retried after 1 h, 2 h, 4 h, ... up to a week.
+constexpr qint64 kFailureBackoffSecs = 3600;
+constexpr qint64 kMaxFailureBackoffSecs = 7 * 86400;
+
+qint64 failureBackoffSecs(int failures)
+{
+    const auto doublings = qBound(0, failures - 1, 12);
+    return qMin(kMaxFailureBackoffSecs, kFailureBackoffSecs << doublings);
+}
 
-std::optional<QIcon> decodeIcon(const QByteArray &bytes)
+struct DecodedIcon final
+{
+    QString host;
+    qint64 fetchedAtSecs = 0;
+    QVector<QImage> images; // empty when the host has no usable cached icon
+    int failures = 0;
+    qint64 retryAtSecs = 0;
+    QByteArray etag;
+    QByteArray lastModified;
+};
+
+QVector<QImage> decodeImages(const QByteArray &bytes)
 {
     QImage image;
-    if (!image.loadFromData(bytes))
-        return std::nullopt;
+    if (bytes.isEmpty() || !image.loadFromData(bytes))
+        return {};
 
-    const auto scaled = image.scaled(16, 16, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    return QIcon(QPixmap::fromImage(scaled));
+    QVector<QImage> images;
+    for (const auto size : kIconSizes)
+        images.push_back(image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    return images;
+}
+
+// Runs on the thread pool with its own connection.
+QVector<DecodedIcon> loadAndDecode(const QString &dbPath, const QStringList &hosts)
+{
+    QVector<DecodedIcon> out;
+    out.reserve(hosts.size());
+
+    const auto connectionName = QString("toolbox_password_favicon_%1").arg(QUuid::createUuid().toString(QUuid::WithoutBraces));
+    {
+        auto db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(dbPath);
+        const auto opened = db.open();
+
+        QSqlQuery query(db);
+        QSqlQuery failureQuery(db);
+        if (opened) {
+            query.prepare(R"sql(
+                SELECT icon, fetched_at, etag, last_modified
+                FROM favicon_cache
+                WHERE host = ?
+                LIMIT 1
+            )sql");
+            failureQuery.prepare(R"sql(
+                SELECT failures, retry_at
+                FROM favicon_failures
+                WHERE host = ?
+                LIMIT 1
+            )sql");
+        }
+
+        for (const auto &host : hosts) {
+            DecodedIcon decoded;
+            decoded.host = host;
+            if (opened) {
+                query.addBindValue(host);
+                if (query.exec() && query.next()) {
+                    decoded.images = decodeImages(query.value(0).toByteArray());
+                    decoded.fetchedAtSecs = query.value(1).toLongLong();
+                    decoded.etag = query.value(2).toByteArray();
+                    decoded.lastModified = query.value(3).toByteArray();
+                }
+                query.finish();
+
+                failureQuery.addBindValue(host);
+                if (failureQuery.exec() && failureQuery.next()) {
+                    decoded.failures = failureQuery.value(0).toInt();
+                    decoded.retryAtSecs = failureQuery.value(1).toLongLong();
+                }
+                failureQuery.finish();
+            }
+            out.push_back(decoded);
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return out;
 }
 
 } // namespace
 
-PasswordFaviconService::PasswordFaviconService(QObject *parent) : QObject(parent) {}
+PasswordFaviconService::PasswordFaviconService(QObject *parent) : QObject(parent)
+{
+    icons_.setMaxCost(kIconCacheKiB);
+
+    // Transparent, so rows keep their text alignment while the real icon is on its way.
+    QPixmap blank(16, 16);
+    blank.fill(Qt::transparent);
+    placeholder_ = QIcon(blank);
+}
 
 void PasswordFaviconService::setNetworkEnabled(bool enabled)
 {
     networkEnabled_ = enabled;
+    if (!enabled) {
+        fetchQueue_.clear();
+        queuedSeq_.clear();
+    }
 }
 
 QIcon PasswordFaviconService::iconForUrl(const QString &url)
 {
     QString scheme;
     const auto host = hostForUrl(url, &scheme);
+    if (host.isEmpty())
+        return {};
+    return iconForHost(host, scheme);
+}
+
+QIcon PasswordFaviconService::iconForHost(const QString &host, const QString &scheme)
+{
     if (host.isEmpty())
         return {};
 
-    if (memory_.contains(host) && memory_.value(host).hasIcon) {
-        const auto fetchedAt = memory_.value(host).fetchedAtSecs;
-        const auto age = QDateTime::currentDateTime().toSecsSinceEpoch() - fetchedAt;
-        if (age >= kCacheTtlSecs && networkEnabled_)
-            ensureFetch(host, scheme);
-        return memory_.value(host).icon;
+    auto &state = hosts_[host];
+    if (state.scheme.isEmpty())
+        state.scheme = scheme;
+
+    if (const auto *icon = icons_.object(host)) {
+        const auto age = QDateTime::currentSecsSinceEpoch() - state.fetchedAtSecs;
+        if (age >= kCacheTtlSecs)
+            ensureFetch(host);
+        return *icon;
     }
 
-    CacheEntry entry;
-    if (loadFromDatabase(host, entry) && entry.hasIcon) {
-        memory_.insert(host, entry);
-        const auto age = QDateTime::currentDateTime().toSecsSinceEpoch() - entry.fetchedAtSecs;
-        if (age >= kCacheTtlSecs && networkEnabled_)
-            ensureFetch(host, scheme);
-        return entry.icon;
+    if (state.missing) {
+        ensureFetch(host);
+        return placeholder_;
     }
 
-    if (networkEnabled_)
-        ensureFetch(host, scheme);
-    return {};
+    if (!state.decoding) {
+        state.decoding = true;
+        scheduleDecode(host);
+    }
+    return placeholder_;
 }
 
-QString PasswordFaviconService::hostForUrl(const QString &url, QString *schemeOut) const
+QString PasswordFaviconService::hostForUrl(const QString &url, QString *schemeOut)
 {
     const auto trimmed = url.trimmed();
     if (trimmed.isEmpty())
@@ -82,61 +190,166 @@ QString PasswordFaviconService::hostForUrl(const QString &url, QString *schemeOu
     if (scheme != "http" && scheme != "https")
         return {};
 
-    const auto host = parsed.host().trimmed().toLower();
+    auto host = parsed.host().trimmed().toLower();
+    if (host.isEmpty())
+        return {};
+
+    const auto port = parsed.port();
+    const auto defaultPort = scheme == "http" ? 80 : 443;
+    if (port > 0 && port != defaultPort)
+        host += QString(":%1").arg(port);
     return host;
 }
 
-bool PasswordFaviconService::loadFromDatabase(const QString &host, CacheEntry &out)
+void PasswordFaviconService::scheduleDecode(const QString &host)
+{
+    // Hosts requested during one paint pass are batched into a few pool jobs on the next event loop turn.
+    decodeQueue_.push_back(host);
+    if (decodeQueue_.size() == 1)
+        QTimer::singleShot(0, this, &PasswordFaviconService::startDecodes);
+}
+
+void PasswordFaviconService::startDecodes()
+{
+    const auto hosts = decodeQueue_;
+    decodeQueue_.clear();
+    if (hosts.isEmpty())
+        return;
+
+    const auto dbPath = PasswordDatabase::db().databaseName();
+    if (dbPath.isEmpty()) {
+        for (const auto &host : hosts)
+            markMissing(host);
+        return;
+    }
+
+    for (int begin = 0; begin < hosts.size(); begin += kDecodeBatchHosts) {
+        const auto batch = hosts.mid(begin, kDecodeBatchHosts);
+
+        auto *watcher = new QFutureWatcher<QVector<DecodedIcon>>(this);
+        connect(watcher, &QFutureWatcher<QVector<DecodedIcon>>::finished, this, [this, watcher]() {
+            watcher->deleteLater();
+            for (const auto &decoded : watcher->result()) {
+                auto &state = hosts_[decoded.host];
+                state.failures = decoded.failures;
+                state.retryAtSecs = decoded.retryAtSecs;
+                state.etag = decoded.etag;
+                state.lastModified = decoded.lastModified;
+                if (decoded.images.isEmpty())
+                    markMissing(decoded.host);
+                else
+                    storeIcon(decoded.host, decoded.images, decoded.fetchedAtSecs);
+            }
+        });
+        watcher->setFuture(QtConcurrent::run([dbPath, batch]() { return loadAndDecode(dbPath, batch); }));
+    }
+}
+
+void PasswordFaviconService::storeIcon(const QString &host, const QVector<QImage> &images, qint64 fetchedAtSecs)
+{
+    // QPixmap may only be created on the GUI thread; the expensive decode and scaling already happened.
+    QIcon icon;
+    qint64 bytes = 0;
+    for (const auto &image : images) {
+        icon.addPixmap(QPixmap::fromImage(image));
+        bytes += image.sizeInBytes();
+    }
+
+    icons_.insert(host, new QIcon(icon), static_cast<int>(bytes / 1024) + 1);
+
+    auto &state = hosts_[host];
+    state.fetchedAtSecs = fetchedAtSecs;
+    state.decoding = false;
+    state.missing = false;
+    emit iconUpdated(host);
+}
+
+void PasswordFaviconService::markMissing(const QString &host)
+{
+    auto &state = hosts_[host];
+    state.decoding = false;
+    state.missing = true;
+    ensureFetch(host);
+}
+
+void PasswordFaviconService::saveToDatabase(const QString &host,
+                                            const QByteArray &bytes,
+                                            const QString &contentType,
+                                            const QByteArray &etag,
+                                            const QByteArray &lastModified,
+                                            qint64 fetchedAtSecs)
 {
     auto db = PasswordDatabase::db();
     if (!db.isOpen())
-        return false;
+        return;
 
     QSqlQuery query(db);
     query.prepare(R"sql(
-        SELECT icon, fetched_at
-        FROM favicon_cache
-        WHERE host = ?
-        LIMIT 1
+        INSERT OR REPLACE INTO favicon_cache(host, icon, content_type, fetched_at, etag, last_modified)
+        VALUES(?, ?, ?, ?, ?, ?)
     )sql");
     query.addBindValue(host);
-    if (!query.exec() || !query.next())
-        return false;
-
-    const auto bytes = query.value(0).toByteArray();
-    const auto fetchedAt = query.value(1).toLongLong();
-    if (bytes.isEmpty())
-        return false;
+    query.addBindValue(bytes);
+    query.addBindValue(contentType);
+    query.addBindValue(fetchedAtSecs);
+    query.addBindValue(etag.isEmpty() ? QVariant() : QString::fromLatin1(etag));
+    query.addBindValue(lastModified.isEmpty() ? QVariant() : QString::fromLatin1(lastModified));
+    query.exec();
+}
 
-    const auto icon = decodeIcon(bytes);
-    if (!icon.has_value())
-        return false;
+void PasswordFaviconService::touchDatabase(const QString &host, qint64 fetchedAtSecs)
+{
+    auto db = PasswordDatabase::db();
+    if (!db.isOpen())
+        return;
 
-    out.icon = icon.value();
-    out.fetchedAtSecs = fetchedAt;
-    out.hasIcon = true;
-    return true;
+    QSqlQuery query(db);
+    query.prepare("UPDATE favicon_cache SET fetched_at = ? WHERE host = ?");
+    query.addBindValue(fetchedAtSecs);
+    query.addBindValue(host);
+    query.exec();
 }
 
-void PasswordFaviconService::saveToDatabase(const QString &host, const QByteArray &bytes, const QString &contentType, qint64 fetchedAtSecs)
+void PasswordFaviconService::recordFailure(const QString &host)
 {
+    auto &state = hosts_[host];
+    state.failures += 1;
+    state.retryAtSecs = QDateTime::currentSecsSinceEpoch() + failureBackoffSecs(state.failures);
+
     auto db = PasswordDatabase::db();
     if (!db.isOpen())
         return;
 
     QSqlQuery query(db);
     query.prepare(R"sql(
-        INSERT OR REPLACE INTO favicon_cache(host, icon, content_type, fetched_at)
-        VALUES(?, ?, ?, ?)
+        INSERT OR REPLACE INTO favicon_failures(host, failures, retry_at)
+        VALUES(?, ?, ?)
     )sql");
     query.addBindValue(host);
-    query.addBindValue(bytes);
-    query.addBindValue(contentType);
-    query.addBindValue(fetchedAtSecs);
+    query.addBindValue(state.failures);
+    query.addBindValue(state.retryAtSecs);
     query.exec();
 }
 
-void PasswordFaviconService::ensureFetch(const QString &host, const QString &scheme)
+void PasswordFaviconService::clearFailure(const QString &host)
+{
+    auto &state = hosts_[host];
+    if (state.failures == 0)
+        return;
+    state.failures = 0;
+    state.retryAtSecs = 0;
+
+    auto db = PasswordDatabase::db();
+    if (!db.isOpen())
+        return;
+
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM favicon_failures WHERE host = ?");
+    query.addBindValue(host);
+    query.exec();
+}
+
+void PasswordFaviconService::ensureFetch(const QString &host)
 {
     if (host.isEmpty())
         return;
@@ -144,41 +357,99 @@ void PasswordFaviconService::ensureFetch(const QString &host, const QString &sch
         return;
     if (pending_.contains(host))
         return;
+    if (QDateTime::currentSecsSinceEpoch() < hosts_.value(host).retryAtSecs)
+        return;
 
+    // Re-queue under a fresh sequence number: the rows being painted right now are the visible ones.
+    const auto queued = queuedSeq_.constFind(host);
+    if (queued != queuedSeq_.constEnd())
+        fetchQueue_.remove(queued.value());
+    const auto seq = ++requestSeq_;
+    fetchQueue_.insert(seq, host);
+    queuedSeq_.insert(host, seq);
+
+    pumpFetches();
+}
+
+void PasswordFaviconService::pumpFetches()
+{
+    while (pending_.size() < kMaxConcurrentFetches && !fetchQueue_.isEmpty()) {
+        const auto newest = std::prev(fetchQueue_.end());
+        const auto host = newest.value();
+        fetchQueue_.erase(newest);
+        queuedSeq_.remove(host);
+        startFetch(host);
+    }
+}
+
+void PasswordFaviconService::startFetch(const QString &host)
+{
     pending_.insert(host);
 
-    const auto s = (scheme == "http" || scheme == "https") ? scheme : QStringLiteral("https");
+    const auto &state = hosts_[host];
+    const auto s = (state.scheme == "http" || state.scheme == "https") ? state.scheme : QStringLiteral("https");
     const QUrl url(QString("%1://%2/favicon.ico").arg(s, host));
 
     QNetworkRequest req(url);
     req.setHeader(QNetworkRequest::UserAgentHeader, "ToolboxPassword/1.0");
     req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    // Refreshing an icon we still have: let the server answer 304 instead of resending it.
+    if (!state.missing) {
+        if (!state.etag.isEmpty())
+            req.setRawHeader("If-None-Match", state.etag);
+        if (!state.lastModified.isEmpty())
+            req.setRawHeader("If-Modified-Since", state.lastModified);
+    }
 
     auto *reply = net_.get(req);
     connect(reply, &QNetworkReply::finished, this, [this, reply, host]() {
-        pending_.remove(host);
-
         const auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
         const auto bytes = reply->readAll();
         const auto contentType = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+        const auto etag = reply->rawHeader("ETag");
+        const auto lastModified = reply->rawHeader("Last-Modified");
         const auto ok = (reply->error() == QNetworkReply::NoError) && status >= 200 && status < 300;
+        const auto notModified = (reply->error() == QNetworkReply::NoError) && status == 304;
         reply->deleteLater();
 
-        if (!ok)
-            return;
-        if (bytes.isEmpty() || bytes.size() > kMaxIconBytes)
+        if (notModified) {
+            // Nothing transferred and nothing to decode; only the freshness moves forward.
+            pending_.remove(host);
+            auto &state = hosts_[host];
+            state.fetchedAtSecs = QDateTime::currentSecsSinceEpoch();
+            touchDatabase(host, state.fetchedAtSecs);
+            clearFailure(host);
+            pumpFetches();
             return;
+        }
 
-        const auto icon = decodeIcon(bytes);
-        if (!icon.has_value())
+        if (!ok || bytes.isEmpty() || bytes.size() > kMaxIconBytes) {
+            pending_.remove(host);
+            recordFailure(host);
+            pumpFetches();
             return;
-
-        CacheEntry entry;
-        entry.icon = icon.value();
-        entry.fetchedAtSecs = QDateTime::currentDateTime().toSecsSinceEpoch();
-        entry.hasIcon = true;
-        memory_.insert(host, entry);
-        saveToDatabase(host, bytes, contentType, entry.fetchedAtSecs);
-        emit iconUpdated(host);
+        }
+
+        // Decode off the GUI thread too; the host stays in flight until the result is stored.
+        auto *watcher = new QFutureWatcher<QVector<QImage>>(this);
+        connect(watcher, &QFutureWatcher<QVector<QImage>>::finished, this, [this, watcher, host, bytes, contentType, etag, lastModified]() {
+            watcher->deleteLater();
+            pending_.remove(host);
+
+            const auto images = watcher->result();
+            if (images.isEmpty()) {
+                recordFailure(host);
+            } else {
+                const auto fetchedAt = QDateTime::currentSecsSinceEpoch();
+                saveToDatabase(host, bytes, contentType, etag, lastModified, fetchedAt);
+                auto &state = hosts_[host];
+                state.etag = etag;
+                state.lastModified = lastModified;
+                clearFailure(host);
+                storeIcon(host, images, fetchedAt);
+            }
+            pumpFetches();
+        });
+        watcher->setFuture(QtConcurrent::run([bytes]() { return decodeImages(bytes); }));
     });
 }
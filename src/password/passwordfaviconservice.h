@@ -1,11 +1,16 @@
 #pragma once
 
+#include <QCache>
 #include <QHash>
 #include <QIcon>
+#include <QImage>
+#include <QMap>
 #include <QNetworkAccessManager>
 #include <QObject>
 #include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QVector>
 
 class PasswordFaviconService final : public QObject
 {
@@ -18,27 +23,57 @@ public:
     bool isNetworkEnabled() const { return networkEnabled_; }
 
     QIcon iconForUrl(const QString &url);
+    // Paint path for callers that cached hostForUrl(): one hash lookup, no URL parsing. Until the icon has been
+    // loaded and decoded on the thread pool this returns a transparent placeholder; iconUpdated(host) follows.
+    QIcon iconForHost(const QString &host, const QString &scheme = QStringLiteral("https"));
+
+    // Lower-cased host (plus ":port" when not the default) of an http(s) URL; scheme-less "example.com" counts
+    // as https. Empty for other URLs. This is the key iconUpdated() reports.
+    static QString hostForUrl(const QString &url, QString *schemeOut = nullptr);
 
 signals:
     void iconUpdated(const QString &host);
 
 private:
-    struct CacheEntry final
+    struct HostState final
     {
-        QIcon icon;
+        QString scheme;
         qint64 fetchedAtSecs = 0;
-        bool hasIcon = false;
+        bool decoding = false;
+        bool missing = false; // nothing usable in favicon_cache
+        int failures = 0;     // consecutive failed fetches, mirrored in favicon_failures
+        qint64 retryAtSecs = 0;
+        QByteArray etag;         // validators of the cached icon, sent when it is refreshed
+        QByteArray lastModified;
     };
 
-    QString hostForUrl(const QString &url, QString *schemeOut = nullptr) const;
-    bool loadFromDatabase(const QString &host, CacheEntry &out);
-    void saveToDatabase(const QString &host, const QByteArray &bytes, const QString &contentType, qint64 fetchedAtSecs);
+    void scheduleDecode(const QString &host);
+    void startDecodes();
+    void storeIcon(const QString &host, const QVector<QImage> &images, qint64 fetchedAtSecs);
+    void markMissing(const QString &host);
+    void saveToDatabase(const QString &host,
+                        const QByteArray &bytes,
+                        const QString &contentType,
+                        const QByteArray &etag,
+                        const QByteArray &lastModified,
+                        qint64 fetchedAtSecs);
+    void touchDatabase(const QString &host, qint64 fetchedAtSecs);
+    void recordFailure(const QString &host);
+    void clearFailure(const QString &host);
 
-    void ensureFetch(const QString &host, const QString &scheme);
+    // Queues a download; hosts asked for most recently (i.e. painted last) are fetched first.
+    void ensureFetch(const QString &host);
+    void pumpFetches();
+    void startFetch(const QString &host);
 
     QNetworkAccessManager net_;
     bool networkEnabled_ = true;
-    QHash<QString, CacheEntry> memory_;
-    QSet<QString> pending_;
+    QHash<QString, HostState> hosts_;
+    QCache<QString, QIcon> icons_; // cost in KiB of decoded pixmaps
+    QStringList decodeQueue_;
+    QMap<quint64, QString> fetchQueue_; // request sequence -> host, newest last
+    QHash<QString, quint64> queuedSeq_;
+    quint64 requestSeq_ = 0;
+    QSet<QString> pending_; // in flight
+    QIcon placeholder_;
 };
-
@@ -0,0 +1,292 @@
+#include "passwordfilterengine.h"
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QtConcurrent>
+
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Typing in the search/tag boxes is debounced; combo and group changes are coalesced into the next tick.
+constexpr int kTypingDebounceMs = 150;
+constexpr int kChunkRows = 4096;
+// Below this the round trip through the thread pool costs more than the scan itself.
+constexpr int kInlineRowLimit = 4096;
+// Fuzzy hits beyond this rank are not worth surfacing; substring-only matches sort after every ranked hit.
+constexpr int kRankedHitLimit = 500;
+constexpr int kEntryTypeCount = static_cast<int>(PasswordEntryType::DeviceWifi) + 1;
+
+struct Chunk final
+{
+    int begin = 0;
+    int end = 0;
+};
+
+QBitArray substringMask(const PasswordEntryModel::FilterRows &rows,
+                          const PasswordFilterCriteria &criteria,
+                          const std::atomic<quint64> &generation,
+                          quint64 expectedGeneration)
+{
+    QVector<Chunk> chunks;
+    chunks.reserve(rows.size() / kChunkRows + 1);
+    for (int begin = 0; begin < rows.size(); begin += kChunkRows)
+        chunks.push_back(Chunk{begin, qMin(begin + kChunkRows, rows.size())});
+
+    const PasswordFilterMatcher matcher(rows, criteria);
+    // One byte per row so chunks never share a written word.
+    std::vector<char> accepted(static_cast<size_t>(rows.size()), 0);
+    QtConcurrent::blockingMap(chunks, [&](const Chunk &chunk) {
+        for (int row = chunk.begin; row < chunk.end; ++row) {
+            if ((row & 0xFF) == 0 && generation.load(std::memory_order_relaxed) != expectedGeneration)
+                return;
+            accepted[static_cast<size_t>(row)] = matcher.accepts(row) ? 1 : 0;
+        }
+    });
+
+    if (generation.load() != expectedGeneration)
+        return {};
+
+    QBitArray mask(rows.size());
+    for (int row = 0; row < rows.size(); ++row) {
+        if (accepted[static_cast<size_t>(row)])
+            mask.setBit(row);
+    }
+    return mask;
+}
+
+QBitArray substringMask(const PasswordEntryModel::FilterRows &rows, const PasswordFilterCriteria &criteria)
+{
+    const PasswordFilterMatcher matcher(rows, criteria);
+    QBitArray mask(rows.size());
+    for (int row = 0; row < rows.size(); ++row) {
+        if (matcher.accepts(row))
+            mask.setBit(row);
+    }
+    return mask;
+}
+
+// Adds the fuzzy hits to the substring mask and ranks them; rows the index missed keep source order after them.
+PasswordFilterResult rankWithIndex(const PasswordEntryModel::FilterRows &rows,
+                                   const PasswordFilterCriteria &criteria,
+                                   const PasswordSearchIndex *searchIndex,
+                                   QBitArray mask)
+{
+    PasswordFilterResult result;
+    result.acceptedRows = std::move(mask);
+    if (criteria.searchText.isEmpty() || result.acceptedRows.size() != rows.size())
+        return result;
+
+    result.relevance = QVector<int>(rows.size(), kRankedHitLimit);
+    if (!searchIndex)
+        return result;
+
+    QHash<qint64, int> rowById;
+    rowById.reserve(rows.size());
+    for (int row = 0; row < rows.size(); ++row)
+        rowById.insert(rows.store.row(row).id(), row);
+
+    // The type, category, tag and group filters run inside the query, so the top hits are the best ones the
+    // table can actually show rather than a global top that the filters then thin out.
+    const PasswordFilterMatcher matcher(rows, criteria);
+    const auto hits = searchIndex->query(criteria.searchText, kRankedHitLimit, [&](qint64 entryId) {
+        const auto row = rowById.value(entryId, -1);
+        return row >= 0 && matcher.matchesFilters(row);
+    });
+
+    for (int rank = 0; rank < hits.size(); ++rank) {
+        const auto row = rowById.value(hits.at(rank).entryId);
+        result.acceptedRows.setBit(row);
+        result.relevance[row] = rank;
+    }
+    return result;
+}
+
+} // namespace
+
+PasswordFilterMatcher::PasswordFilterMatcher(const PasswordEntryModel::FilterRows &rows,
+                                             const PasswordFilterCriteria &criteria)
+    : rows_(rows), criteria_(criteria)
+{
+    anyCategory_ = criteria.category.isEmpty() || criteria.category == "全部";
+    if (!anyCategory_)
+        categoryId_ = static_cast<int>(rows.categoryLabels.indexOf(criteria.category));
+
+    for (const auto &required : criteria.requiredTags) {
+        QBitArray ids(rows.foldedTags.size());
+        for (int id = 0; id < rows.foldedTags.size(); ++id)
+            ids.setBit(id, rows.foldedTags.at(id) == required);
+        requiredTagIds_.push_back(ids);
+    }
+
+    const auto &text = criteria.searchText;
+    if (text.isEmpty())
+        return;
+    categoryHits_.resize(rows.foldedCategories.size());
+    for (int id = 0; id < rows.foldedCategories.size(); ++id)
+        categoryHits_.setBit(id, rows.foldedCategories.at(id).contains(text));
+    tagHits_.resize(rows.foldedTags.size());
+    for (int id = 0; id < rows.foldedTags.size(); ++id)
+        tagHits_.setBit(id, rows.foldedTags.at(id).contains(text));
+    titlePinyinHits_.resize(rows.titlePinyin.size());
+    for (int id = 0; id < rows.titlePinyin.size(); ++id)
+        titlePinyinHits_.setBit(id, rows.titlePinyin.at(id).contains(text));
+    typeHits_.resize(kEntryTypeCount);
+    for (int type = 0; type < kEntryTypeCount; ++type)
+        typeHits_.setBit(type, passwordEntryTypeLabel(passwordEntryTypeFromInt(type)).toCaseFolded().contains(text));
+}
+
+bool PasswordFilterMatcher::matchesFilters(int row) const
+{
+    const auto item = rows_.store.row(row);
+    if (!criteria_.groupSubtree.contains(item.groupId()))
+        return false;
+
+    if (criteria_.entryType >= 0 && static_cast<int>(item.type()) != criteria_.entryType)
+        return false;
+
+    if (!anyCategory_ && item.categoryId() != categoryId_)
+        return false;
+
+    for (const auto &ids : requiredTagIds_) {
+        bool found = false;
+        for (int i = 0; i < item.tagCount() && !found; ++i)
+            found = ids.testBit(item.tagId(i));
+        if (!found)
+            return false;
+    }
+
+    return true;
+}
+
+bool PasswordFilterMatcher::accepts(int row) const
+{
+    if (!matchesFilters(row))
+        return false;
+
+    const auto &text = criteria_.searchText;
+    if (text.isEmpty())
+        return true;
+
+    const auto item = rows_.store.row(row);
+    if (item.title().contains(text, Qt::CaseInsensitive) || item.username().contains(text, Qt::CaseInsensitive)
+        || item.url().contains(text, Qt::CaseInsensitive))
+        return true;
+    if (categoryHits_.testBit(item.categoryId()) || typeHits_.testBit(static_cast<int>(item.type())))
+        return true;
+    for (int i = 0; i < item.tagCount(); ++i) {
+        if (tagHits_.testBit(item.tagId(i)))
+            return true;
+    }
+    const auto pinyinId = rows_.titlePinyinIds.at(row);
+    return pinyinId >= 0 && titlePinyinHits_.testBit(pinyinId);
+}
+
+PasswordFilterEngine::PasswordFilterEngine(QObject *parent)
+    : QObject(parent), generation_(std::make_shared<std::atomic<quint64>>(0))
+{
+    scheduleTimer_.setSingleShot(true);
+    connect(&scheduleTimer_, &QTimer::timeout, this, &PasswordFilterEngine::start);
+}
+
+PasswordFilterEngine::~PasswordFilterEngine()
+{
+    // Running chunks notice the bump and stop; they only hold shared copies of their inputs.
+    generation_->fetch_add(1);
+}
+
+void PasswordFilterEngine::setRows(const PasswordEntryModel::FilterRows &rows,
+                                   std::shared_ptr<const PasswordSearchIndex> searchIndex)
+{
+    rows_ = rows;
+    searchIndex_ = std::move(searchIndex);
+    scheduleTimer_.stop();
+    start();
+}
+
+void PasswordFilterEngine::setSearchText(const QString &text)
+{
+    const auto folded = text.trimmed().toCaseFolded();
+    if (folded == criteria_.searchText)
+        return;
+    criteria_.searchText = folded;
+    schedule(kTypingDebounceMs);
+}
+
+void PasswordFilterEngine::setCategory(const QString &category)
+{
+    criteria_.category = category.trimmed();
+    schedule(0);
+}
+
+void PasswordFilterEngine::setRequiredTags(const QStringList &tags)
+{
+    QStringList folded;
+    folded.reserve(tags.size());
+    for (const auto &tag : tags)
+        folded.push_back(tag.toCaseFolded());
+    if (folded == criteria_.requiredTags)
+        return;
+    criteria_.requiredTags = folded;
+    schedule(kTypingDebounceMs);
+}
+
+void PasswordFilterEngine::setGroupSubtree(const PasswordGroupSubtree &subtree)
+{
+    criteria_.groupSubtree = subtree;
+    schedule(0);
+}
+
+void PasswordFilterEngine::setEntryType(int entryType)
+{
+    criteria_.entryType = entryType;
+    schedule(0);
+}
+
+PasswordFilterResult PasswordFilterEngine::evaluate(const PasswordEntryModel::FilterRows &rows,
+                                                    const PasswordFilterCriteria &criteria,
+                                                    const PasswordSearchIndex *searchIndex)
+{
+    return rankWithIndex(rows, criteria, searchIndex, substringMask(rows, criteria));
+}
+
+void PasswordFilterEngine::schedule(int delayMs)
+{
+    // Typing restarts the debounce, so the filter runs once the user pauses. A combo or group change only
+    // coalesces: it never postpones a run that is already due.
+    if (delayMs == 0 && scheduleTimer_.isActive() && scheduleTimer_.remainingTime() <= 0)
+        return;
+    scheduleTimer_.start(delayMs);
+}
+
+void PasswordFilterEngine::start()
+{
+    const auto generation = generation_->fetch_add(1) + 1;
+
+    if (rows_.size() <= kInlineRowLimit) {
+        const auto result = evaluate(rows_, criteria_, searchIndex_.get());
+        emit maskReady(result.acceptedRows, result.relevance);
+        return;
+    }
+
+    auto *watcher = new QFutureWatcher<PasswordFilterResult>(this);
+    connect(watcher, &QFutureWatcher<PasswordFilterResult>::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        if (generation_->load() != generation)
+            return;
+        const auto result = watcher->result();
+        emit maskReady(result.acceptedRows, result.relevance);
+    });
+
+    const auto rows = rows_;
+    const auto criteria = criteria_;
+    const auto searchIndex = searchIndex_;
+    const auto counter = generation_;
+    watcher->setFuture(QtConcurrent::run([rows, criteria, searchIndex, counter, generation]() {
+        auto mask = substringMask(rows, criteria, *counter, generation);
+        if (mask.size() != rows.size())
+            return PasswordFilterResult{};
+        return rankWithIndex(rows, criteria, searchIndex.get(), std::move(mask));
+    }));
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "passwordentrymodel.h"
+#include "passwordgroupmodel.h"
+#include "passwordsearchindex.h"
+
+#include <QBitArray>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+struct PasswordFilterCriteria final
+{
+    QString searchText;       // case-folded
+    QString category = "全部"; // "全部" or empty matches every category
+    QStringList requiredTags; // case-folded
+    PasswordGroupSubtree groupSubtree; // default matches every group
+    int entryType = -1;
+};
+
+struct PasswordFilterResult final
+{
+    QBitArray acceptedRows;
+    QVector<int> relevance; // per source row, lower ranks first; empty when no search text is set
+};
+
+// Criteria resolved against one snapshot's vocabularies: the category and required tags become id sets, and
+// the search text is tested once per category, tag, entry type and Chinese title. Per row only ids are compared
+// and the title, username and URL views are scanned.
+class PasswordFilterMatcher final
+{
+public:
+    PasswordFilterMatcher(const PasswordEntryModel::FilterRows &rows, const PasswordFilterCriteria &criteria);
+
+    // Every predicate except the search text.
+    bool matchesFilters(int row) const;
+    bool accepts(int row) const;
+
+private:
+    const PasswordEntryModel::FilterRows &rows_;
+    const PasswordFilterCriteria &criteria_;
+    bool anyCategory_ = true;
+    int categoryId_ = -1;               // -1 when the selected category is not in this snapshot
+    QVector<QBitArray> requiredTagIds_; // per required tag, the store tag ids that fold to it
+    QBitArray categoryHits_;            // by category id: the search text occurs in its folded label
+    QBitArray tagHits_;                 // by tag id
+    QBitArray titlePinyinHits_;         // by titlePinyin index
+    QBitArray typeHits_;                // by entry type
+};
+
+// Evaluates the entry table filter off the GUI thread. Rows are snapshotted with setRows(); every criteria
+// change starts a new generation, and results of older generations are dropped (their chunks stop early).
+class PasswordFilterEngine final : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PasswordFilterEngine(QObject *parent = nullptr);
+    ~PasswordFilterEngine() override;
+
+    void setRows(const PasswordEntryModel::FilterRows &rows, std::shared_ptr<const PasswordSearchIndex> searchIndex = {});
+
+    void setSearchText(const QString &text);
+    void setCategory(const QString &category);
+    void setRequiredTags(const QStringList &tags);
+    void setGroupSubtree(const PasswordGroupSubtree &subtree);
+    void setEntryType(int entryType);
+
+    PasswordFilterCriteria criteria() const { return criteria_; }
+
+    // Substring matches are accepted as before; fuzzy hits from `searchIndex` are accepted too and ranked first.
+    static PasswordFilterResult evaluate(const PasswordEntryModel::FilterRows &rows,
+                                         const PasswordFilterCriteria &criteria,
+                                         const PasswordSearchIndex *searchIndex = nullptr);
+
+signals:
+    void maskReady(const QBitArray &acceptedRows, const QVector<int> &relevance);
+
+private:
+    void schedule(int delayMs);
+    void start();
+
+    PasswordEntryModel::FilterRows rows_;
+    std::shared_ptr<const PasswordSearchIndex> searchIndex_;
+    PasswordFilterCriteria criteria_;
+    QTimer scheduleTimer_;
+    std::shared_ptr<std::atomic<quint64>> generation_;
+};
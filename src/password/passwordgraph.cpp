@@ -1,7 +1,5 @@
 #include "passwordgraph.h"
 
-#include "passwordurl.h"
-
 #include <QHash>
 
 namespace PasswordGraph {
@@ -13,30 +11,30 @@ QString normalizeKey(const QString &text)
     return text.trimmed().toLower();
 }
 
-QString serviceLabelForEntry(const PasswordEntry &entry)
+QString serviceLabelForEntry(const PasswordEntryStore::Row &entry)
 {
-    if (entry.type == PasswordEntryType::WebLogin) {
-        const auto host = PasswordUrl::hostFromUrl(entry.url);
+    if (entry.type() == PasswordEntryType::WebLogin) {
+        const auto &host = entry.host();
         if (!host.isEmpty())
             return host;
     }
 
-    const auto title = entry.title.trimmed();
+    const auto title = entry.title().trimmed();
     if (!title.isEmpty())
-        return title;
+        return title.toString();
 
-    const auto url = entry.url.trimmed();
+    const auto url = entry.url().trimmed();
     if (!url.isEmpty())
-        return url;
+        return url.toString();
 
     return "未命名";
 }
 
-QString usernameLabelForEntry(const PasswordEntry &entry)
+QString usernameLabelForEntry(const PasswordEntryStore::Row &entry)
 {
-    const auto user = entry.username.trimmed();
+    const auto user = entry.username().trimmed();
     if (!user.isEmpty())
-        return user;
+        return user.toString();
     return "<无账号>";
 }
 
@@ -48,6 +46,11 @@ QString makeKey(const QStringList &parts)
 } // namespace
 
 Graph build(const QVector<PasswordEntry> &entries)
+{
+    return build(PasswordEntryStore::fromEntries(entries));
+}
+
+Graph build(const PasswordEntryStore &entries)
 {
     Graph graph;
 
@@ -82,14 +85,15 @@ Graph build(const QVector<PasswordEntry> &entries)
         edgeIndexByKey.insert(key, idx);
     };
 
-    for (const auto &entry : entries) {
-        const auto typeInt = static_cast<int>(entry.type);
+    for (int row = 0; row < entries.size(); ++row) {
+        const auto entry = entries.row(row);
+        const auto typeInt = static_cast<int>(entry.type());
 
         const auto typeNodeKey = QString::number(typeInt);
         Node typeNode;
         typeNode.kind = NodeKind::Type;
-        typeNode.entryType = entry.type;
-        typeNode.label = passwordEntryTypeLabel(entry.type);
+        typeNode.entryType = entry.type();
+        typeNode.label = passwordEntryTypeLabel(entry.type());
         const auto typeNodeId = ensureNode(typeNodeIdByType, typeNodeKey, typeNode);
 
         const auto serviceLabel = serviceLabelForEntry(entry);
@@ -97,7 +101,7 @@ Graph build(const QVector<PasswordEntry> &entries)
         const auto serviceNodeKey = makeKey({typeNodeKey, serviceKey});
         Node serviceNode;
         serviceNode.kind = NodeKind::Service;
-        serviceNode.entryType = entry.type;
+        serviceNode.entryType = entry.type();
         serviceNode.label = serviceLabel;
         serviceNode.serviceKey = serviceKey;
         const auto serviceNodeId = ensureNode(serviceNodeIdByKey, serviceNodeKey, serviceNode);
@@ -107,7 +111,7 @@ Graph build(const QVector<PasswordEntry> &entries)
         const auto accountNodeKey = makeKey({typeNodeKey, serviceKey, userKey});
         Node accountNode;
         accountNode.kind = NodeKind::Account;
-        accountNode.entryType = entry.type;
+        accountNode.entryType = entry.type();
         accountNode.label = usernameLabel;
         accountNode.serviceKey = serviceKey;
         accountNode.username = usernameLabel;
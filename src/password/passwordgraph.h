@@ -1,6 +1,7 @@
 #pragma once
 
 #include "passwordentry.h"
+#include "passwordentrystore.h"
 
 #include <QString>
 #include <QVector>
@@ -38,6 +39,7 @@ struct Graph final
     QVector<Edge> edges;
 };
 
+Graph build(const PasswordEntryStore &entries);
 Graph build(const QVector<PasswordEntry> &entries);
 
 } // namespace PasswordGraph
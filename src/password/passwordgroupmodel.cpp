@@ -4,12 +4,41 @@
 #include <QStyle>
 
 #include <algorithm>
+#include <utility>
+
+namespace {
+
+// The root owns [0, kPreorderLimit]. Intervals are spread sparsely inside it, so most edits find a free number
+// without renumbering anything else.
+constexpr int kPreorderLimit = 1 << 30;
+
+bool nameLess(const QString &a, const QString &b)
+{
+    return a.toLower() < b.toLower();
+}
+
+const QVector<int> &countRoles()
+{
+    static const QVector<int> roles{PasswordGroupModel::EntryCountRole,
+                                    PasswordGroupModel::SubtreeEntryCountRole,
+                                    PasswordGroupModel::EntryCountBadgeRole,
+                                    Qt::ToolTipRole};
+    return roles;
+}
+
+} // namespace
 
 struct PasswordGroupModel::Node final
 {
     PasswordGroup group;
     Node *parent = nullptr;
     QVector<Node *> children;
+    int row = 0;   // index in parent->children
+    int enter = 0; // pre-order number of this node
+    int exit = 0;  // end of the interval reserved for this subtree, free numbers included
+    int nodes = 1; // nodes in this subtree, itself included
+    int entries = 0;        // entries with this group_id
+    int subtreeEntries = 0; // entries + the children's subtreeEntries
 
     ~Node()
     {
@@ -23,6 +52,7 @@ PasswordGroupModel::PasswordGroupModel(QObject *parent) : QAbstractItemModel(par
     root_ = new Node();
     root_->group.id = 0;
     nodesById_.insert(0, root_);
+    relabel(root_, 0, kPreorderLimit);
 }
 
 PasswordGroupModel::~PasswordGroupModel()
@@ -56,15 +86,11 @@ QModelIndex PasswordGroupModel::parent(const QModelIndex &child) const
     if (!node || !node->parent || node->parent == root_)
         return {};
 
-    const auto *parentNode = node->parent;
+    auto *parentNode = node->parent;
     if (!parentNode->parent)
         return {};
 
-    const auto row = parentNode->parent->children.indexOf(const_cast<Node *>(parentNode));
-    if (row < 0)
-        return {};
-
-    return createIndex(row, 0, const_cast<Node *>(parentNode));
+    return createIndex(parentNode->row, 0, parentNode);
 }
 
 int PasswordGroupModel::rowCount(const QModelIndex &parent) const
@@ -99,6 +125,21 @@ QVariant PasswordGroupModel::data(const QModelIndex &index, int role) const
     if (role == GroupIdRole)
         return node->group.id;
 
+    if (role == EntryCountRole)
+        return node->entries;
+
+    if (role == SubtreeEntryCountRole)
+        return node->subtreeEntries;
+
+    if (role == EntryCountBadgeRole) {
+        if (node->entries == node->subtreeEntries)
+            return QString::number(node->entries);
+        return QString("%1/%2").arg(node->entries).arg(node->subtreeEntries);
+    }
+
+    if (role == Qt::ToolTipRole)
+        return QString("%1\n本组 %2 条，含子分组共 %3 条").arg(node->group.name).arg(node->entries).arg(node->subtreeEntries);
+
     return {};
 }
 
@@ -153,7 +194,7 @@ void PasswordGroupModel::setGroups(const QVector<PasswordGroup> &groups)
             return;
 
         std::sort(node->children.begin(), node->children.end(), [](const auto *a, const auto *b) {
-            return a->group.name.toLower() < b->group.name.toLower();
+            return nameLess(a->group.name, b->group.name);
         });
 
         for (auto *child : node->children)
@@ -161,9 +202,160 @@ void PasswordGroupModel::setGroups(const QVector<PasswordGroup> &groups)
     };
 
     sortTree(sortTree, root_);
+
+    // Breadth-first order lists every child after its parent; walking it backwards sums subtree sizes.
+    QVector<Node *> order{root_};
+    order.reserve(nodesById_.size());
+    for (int i = 0; i < order.size(); ++i) {
+        auto *node = order.at(i);
+        for (int row = 0; row < node->children.size(); ++row) {
+            node->children.at(row)->row = row;
+            order.push_back(node->children.at(row));
+        }
+    }
+    for (int i = order.size() - 1; i > 0; --i)
+        order.at(i)->parent->nodes += order.at(i)->nodes;
+
+    preorder_.clear();
+    preorder_.reserve(nodesById_.size());
+    relabel(root_, 0, kPreorderLimit);
     endResetModel();
 }
 
+QModelIndex PasswordGroupModel::indexForNode(Node *node) const
+{
+    if (!node || node == root_ || !node->parent)
+        return {};
+    return createIndex(node->row, 0, node);
+}
+
+int PasswordGroupModel::sortedRow(const Node *parent, const QString &name, const Node *skip)
+{
+    int row = 0;
+    for (const auto *child : parent->children) {
+        if (child == skip)
+            continue;
+        if (!nameLess(child->group.name, name))
+            break;
+        ++row;
+    }
+    return row;
+}
+
+bool PasswordGroupModel::insertGroup(const PasswordGroup &group)
+{
+    if (group.id <= 0 || nodesById_.contains(group.id))
+        return false;
+
+    auto *parentNode = nodesById_.value(group.parentId, root_);
+    const auto row = sortedRow(parentNode, group.name, nullptr);
+
+    beginInsertRows(indexForNode(parentNode), row, row);
+    auto *node = new Node();
+    node->group = group;
+    node->parent = parentNode;
+    parentNode->children.insert(row, node);
+    nodesById_.insert(group.id, node);
+    updateRows(parentNode, row);
+    addToSubtreeSizes(parentNode, 1);
+    placeSubtree(node);
+    endInsertRows();
+    return true;
+}
+
+bool PasswordGroupModel::renameGroup(qint64 groupId, const QString &name)
+{
+    auto *node = nodesById_.value(groupId, nullptr);
+    if (!node || node == root_)
+        return false;
+
+    node->group.name = name;
+
+    auto *parentNode = node->parent;
+    const auto from = node->row;
+    const auto to = sortedRow(parentNode, name, node);
+    if (to != from) {
+        const auto parentIndex = indexForNode(parentNode);
+        // beginMoveRows wants the destination row as counted before the move.
+        if (!beginMoveRows(parentIndex, from, from, parentIndex, to > from ? to + 1 : to))
+            return false;
+        // Sibling order has no bearing on the intervals; only the rows in between shift.
+        parentNode->children.removeAt(from);
+        parentNode->children.insert(to, node);
+        updateRows(parentNode, qMin(from, to));
+        endMoveRows();
+    }
+
+    const auto idx = indexForNode(node);
+    emit dataChanged(idx, idx, {Qt::DisplayRole});
+    return true;
+}
+
+bool PasswordGroupModel::removeGroup(qint64 groupId)
+{
+    auto *node = nodesById_.value(groupId, nullptr);
+    if (!node || node == root_)
+        return false;
+
+    auto *parentNode = node->parent;
+    const auto row = node->row;
+    const auto removedEntries = node->subtreeEntries;
+    beginRemoveRows(indexForNode(parentNode), row, row);
+    parentNode->children.removeAt(row);
+    updateRows(parentNode, row);
+    addToSubtreeSizes(parentNode, -node->nodes);
+
+    // The freed interval is left as a gap; the parent's and everyone else's numbers stay as they are.
+    QVector<const Node *> pending{node};
+    while (!pending.isEmpty()) {
+        const auto *current = pending.takeLast();
+        nodesById_.remove(current->group.id);
+        preorder_.remove(current->group.id);
+        for (const auto *child : current->children)
+            pending.push_back(child);
+    }
+    delete node;
+
+    endRemoveRows();
+    if (removedEntries != 0)
+        addToSubtreeCounts(parentNode, -removedEntries);
+    return true;
+}
+
+bool PasswordGroupModel::moveGroup(qint64 groupId, qint64 newParentId)
+{
+    auto *node = nodesById_.value(groupId, nullptr);
+    auto *newParent = nodesById_.value(newParentId, nullptr);
+    if (!node || node == root_ || !newParent)
+        return false;
+    if (isInSubtree(newParentId, groupId))
+        return false; // would create a cycle
+    if (node->parent == newParent)
+        return true;
+
+    auto *oldParent = node->parent;
+    const auto from = node->row;
+    const auto to = sortedRow(newParent, node->group.name, node);
+    if (!beginMoveRows(indexForNode(oldParent), from, from, indexForNode(newParent), to))
+        return false;
+
+    oldParent->children.removeAt(from);
+    updateRows(oldParent, from);
+    addToSubtreeSizes(oldParent, -node->nodes);
+    newParent->children.insert(to, node);
+    node->parent = newParent;
+    node->group.parentId = newParentId;
+    updateRows(newParent, to);
+    addToSubtreeSizes(newParent, node->nodes);
+    placeSubtree(node);
+    endMoveRows();
+    if (node->subtreeEntries != 0) {
+        addToSubtreeCounts(oldParent, -node->subtreeEntries);
+        addToSubtreeCounts(newParent, node->subtreeEntries);
+    }
+    return true;
+}
+
 qint64 PasswordGroupModel::groupIdForIndex(const QModelIndex &index) const
 {
     if (!index.isValid())
@@ -176,15 +368,11 @@ qint64 PasswordGroupModel::groupIdForIndex(const QModelIndex &index) const
 
 QModelIndex PasswordGroupModel::indexForGroupId(qint64 groupId) const
 {
-    const auto *node = nodesById_.value(groupId, nullptr);
+    auto *node = nodesById_.value(groupId, nullptr);
     if (!node || node == root_ || !node->parent)
         return {};
 
-    const auto row = node->parent->children.indexOf(const_cast<Node *>(node));
-    if (row < 0)
-        return {};
-
-    return createIndex(row, 0, const_cast<Node *>(node));
+    return createIndex(node->row, 0, node);
 }
 
 void PasswordGroupModel::collectDescendants(const Node *node, QVector<qint64> &out) const
@@ -209,3 +397,164 @@ QVector<qint64> PasswordGroupModel::descendantGroupIds(qint64 groupId) const
     collectDescendants(node, out);
     return out;
 }
+
+void PasswordGroupModel::setEntryCounts(const QHash<qint64, int> &directCounts)
+{
+    // Breadth-first order lists every child after its parent; walking it backwards sums children first.
+    QVector<Node *> order{root_};
+    order.reserve(nodesById_.size());
+    for (int i = 0; i < order.size(); ++i) {
+        for (auto *child : order.at(i)->children)
+            order.push_back(child);
+    }
+
+    QVector<int> oldDirect(order.size());
+    QVector<int> oldSubtree(order.size());
+    for (int i = 0; i < order.size(); ++i) {
+        auto *node = order.at(i);
+        oldDirect[i] = node->entries;
+        oldSubtree[i] = node->subtreeEntries;
+        node->entries = node == root_ ? 0 : directCounts.value(node->group.id, 0);
+        node->subtreeEntries = node->entries;
+    }
+    for (int i = order.size() - 1; i > 0; --i)
+        order.at(i)->parent->subtreeEntries += order.at(i)->subtreeEntries;
+
+    for (int i = 1; i < order.size(); ++i) {
+        auto *node = order.at(i);
+        if (node->entries == oldDirect.at(i) && node->subtreeEntries == oldSubtree.at(i))
+            continue;
+        const auto idx = indexForNode(node);
+        emit dataChanged(idx, idx, countRoles());
+    }
+}
+
+bool PasswordGroupModel::adjustEntryCount(qint64 groupId, int delta)
+{
+    auto *node = nodesById_.value(groupId, nullptr);
+    if (!node || node == root_)
+        return false;
+    if (delta == 0)
+        return true;
+
+    node->entries += delta;
+    addToSubtreeCounts(node, delta);
+    return true;
+}
+
+int PasswordGroupModel::entryCount(qint64 groupId) const
+{
+    const auto *node = nodesById_.value(groupId, nullptr);
+    return node ? node->entries : 0;
+}
+
+int PasswordGroupModel::subtreeEntryCount(qint64 groupId) const
+{
+    const auto *node = nodesById_.value(groupId, nullptr);
+    return node ? node->subtreeEntries : 0;
+}
+
+void PasswordGroupModel::addToSubtreeCounts(Node *node, int delta)
+{
+    for (auto *current = node; current; current = current->parent) {
+        current->subtreeEntries += delta;
+        if (current == root_)
+            break;
+        const auto idx = indexForNode(current);
+        emit dataChanged(idx, idx, countRoles());
+    }
+}
+
+bool PasswordGroupModel::isInSubtree(qint64 groupId, qint64 rootId) const
+{
+    const auto *node = nodesById_.value(groupId, nullptr);
+    const auto *root = nodesById_.value(rootId, nullptr);
+    if (!node || !root)
+        return false;
+    return node->enter >= root->enter && node->enter <= root->exit;
+}
+
+PasswordGroupSubtree PasswordGroupModel::subtree(qint64 rootId) const
+{
+    PasswordGroupSubtree out;
+    out.matchesAll_ = false;
+    // A shallow copy; the model's next edit detaches its own hash and leaves this one untouched.
+    out.preorder_ = preorder_;
+
+    const auto *root = nodesById_.value(rootId, nullptr);
+    if (root) {
+        out.enter_ = root->enter;
+        out.exit_ = root->exit;
+    }
+    return out;
+}
+
+void PasswordGroupModel::updateRows(Node *parent, int from)
+{
+    for (int row = from; row < parent->children.size(); ++row)
+        parent->children.at(row)->row = row;
+}
+
+void PasswordGroupModel::addToSubtreeSizes(Node *node, int delta)
+{
+    for (auto *current = node; current; current = current->parent)
+        current->nodes += delta;
+}
+
+void PasswordGroupModel::placeSubtree(Node *node)
+{
+    auto *parentNode = node->parent;
+    int used = parentNode->enter;
+    for (const auto *sibling : parentNode->children) {
+        if (sibling != node)
+            used = qMax(used, sibling->exit);
+    }
+
+    const auto room = parentNode->exit - used;
+    if (room >= node->nodes) {
+        // Half of the free tail: the parent keeps room for the next sibling, the subtree for its own children.
+        relabel(node, used + 1, used + qMax(node->nodes, room / 2));
+        return;
+    }
+
+    // Sizes already include `node`, so relabelling an ancestor with twice its size in numbers fits it too.
+    auto *owner = parentNode;
+    while (owner != root_ && qint64(owner->exit) - owner->enter < 2 * qint64(owner->nodes))
+        owner = owner->parent;
+    relabel(owner, owner->enter, owner->exit);
+}
+
+void PasswordGroupModel::relabel(Node *node, int enter, int exit)
+{
+    struct Span final
+    {
+        Node *node;
+        int enter;
+        int exit;
+    };
+
+    // A worklist instead of recursion, so deep hierarchies cannot overflow the stack.
+    QVector<Span> pending{{node, enter, exit}};
+    while (!pending.isEmpty()) {
+        const auto span = pending.takeLast();
+        auto *current = span.node;
+        current->enter = span.enter;
+        current->exit = span.exit;
+        preorder_.insert(current->group.id, span.enter);
+
+        const auto descendants = current->nodes - 1;
+        if (descendants <= 0)
+            continue;
+
+        // One node's share of the interval stays free at the end for groups created later; the children split
+        // the rest by size, so a long chain of single children does not halve its room at every level.
+        const auto room = qint64(span.exit) - span.enter;
+        const auto budget = qMax<qint64>(descendants, room - room / (descendants + 1));
+        auto next = span.enter + 1;
+        for (auto *child : current->children) {
+            const auto width = static_cast<int>(qMax<qint64>(child->nodes, budget * child->nodes / descendants));
+            pending.push_back({child, next, next + width - 1});
+            next += width;
+        }
+    }
+}
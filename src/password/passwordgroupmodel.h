@@ -6,6 +6,29 @@
 #include <QHash>
 #include <QVector>
 
+// Membership test for one group subtree, detached from the model so the filter thread can hold it.
+// A default-constructed value matches every group.
+class PasswordGroupSubtree final
+{
+public:
+    bool matchesAll() const { return matchesAll_; }
+    bool contains(qint64 groupId) const
+    {
+        if (matchesAll_)
+            return true;
+        const auto it = preorder_.constFind(groupId);
+        return it != preorder_.constEnd() && it.value() >= enter_ && it.value() <= exit_;
+    }
+
+private:
+    friend class PasswordGroupModel;
+
+    bool matchesAll_ = true;
+    QHash<qint64, int> preorder_; // group id -> pre-order number; implicitly shared with the model
+    int enter_ = 0;
+    int exit_ = -1;
+};
+
 class PasswordGroupModel final : public QAbstractItemModel
 {
     Q_OBJECT
@@ -14,6 +37,9 @@ public:
     enum Roles
     {
         GroupIdRole = Qt::UserRole + 1,
+        EntryCountRole,        // int, entries directly in the group
+        SubtreeEntryCountRole, // int, entries in the group and all its descendants
+        EntryCountBadgeRole,   // QString for the tree badge: "12", or "3/12" when descendants hold entries
     };
 
     explicit PasswordGroupModel(QObject *parent = nullptr);
@@ -27,17 +53,55 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
     void setGroups(const QVector<PasswordGroup> &groups);
+
+    // Incremental edits: precise row signals, so expansion state, the current index and
+    // QPersistentModelIndexes survive. Siblings stay sorted by name as in setGroups().
+    bool insertGroup(const PasswordGroup &group);
+    bool renameGroup(qint64 groupId, const QString &name);
+    bool removeGroup(qint64 groupId); // removes the whole subtree
+    // Not reachable from the UI yet (the repository has no group move); kept for tests of the numbering.
+    bool moveGroup(qint64 groupId, qint64 newParentId);
     qint64 groupIdForIndex(const QModelIndex &index) const;
     QModelIndex indexForGroupId(qint64 groupId) const;
     QVector<qint64> descendantGroupIds(qint64 groupId) const;
 
+    // Entry counts are kept per node so painting never has to count. setEntryCounts() takes the direct counts
+    // from PasswordRepository::entryCountsByGroup() and sums subtrees once; adjustEntryCount() then applies a
+    // single insert/move/delete by walking the ancestor chain.
+    void setEntryCounts(const QHash<qint64, int> &directCounts);
+    bool adjustEntryCount(qint64 groupId, int delta);
+    int entryCount(qint64 groupId) const;
+    int subtreeEntryCount(qint64 groupId) const;
+
+    // O(1) via the pre-order intervals; a group is in its own subtree.
+    bool isInSubtree(qint64 groupId, qint64 rootId) const;
+    PasswordGroupSubtree subtree(qint64 rootId) const;
+
 private:
     struct Node;
 
     Node *nodeFromIndex(const QModelIndex &index) const;
+    QModelIndex indexForNode(Node *node) const;
+    // Row at which a child named `name` belongs under `parent`, ignoring `skip` (the node being moved).
+    static int sortedRow(const Node *parent, const QString &name, const Node *skip);
     void collectDescendants(const Node *node, QVector<qint64> &out) const;
+    // Adds `delta` to the subtree count of `node` and every ancestor, announcing the change for each.
+    void addToSubtreeCounts(Node *node, int delta);
+    // Renumbers `parent`'s children from `from` on after an insert, removal or move among them.
+    static void updateRows(Node *parent, int from);
+    // Adds `delta` to the node count of `node` and every ancestor.
+    static void addToSubtreeSizes(Node *node, int delta);
+    // Gives a freshly attached or moved subtree an interval inside its parent. The free tail of the parent's
+    // interval is used when it is wide enough; otherwise the nearest ancestor with room to spare is relabelled,
+    // so one edit touches a few intervals instead of the whole tree.
+    void placeSubtree(Node *node);
+    // Spreads [enter, exit] over `node`'s subtree in proportion to subtree sizes, keeping some of every
+    // interval free for later inserts, and records the new pre-order numbers.
+    void relabel(Node *node, int enter, int exit);
 
     Node *root_ = nullptr;
     QHash<qint64, Node *> nodesById_;
+    // Intervals nest but are sparse: a subtree owns [enter, exit] even where no descendant uses a number yet.
+    QHash<qint64, int> preorder_;
 };
 
@@ -23,6 +23,10 @@ struct PasswordHealthItem final
     bool reused = false;
     int reuseCount = 0;
 
+    // Part of a group of different but near-identical passwords ("Summer2023!" / "Summer2024!!").
+    bool similar = false;
+    int similarCount = 0;
+
     bool stale = false;
     int daysSinceUpdate = 0;
 
@@ -32,7 +36,7 @@ struct PasswordHealthItem final
     bool pwnedChecked = false;
     qint64 pwnedCount = 0;
 
-    bool hasIssues() const { return weak || reused || stale || corrupted || pwned; }
+    bool hasIssues() const { return weak || reused || similar || stale || corrupted || pwned; }
 
     QString issuesText() const
     {
@@ -43,6 +47,8 @@ struct PasswordHealthItem final
             issues.push_back(QString("弱密码(%1)").arg(strengthScore));
         if (reused)
             issues.push_back(QString("重复(%1)").arg(reuseCount));
+        if (similar)
+            issues.push_back(QString("相似(%1)").arg(similarCount));
         if (stale)
             issues.push_back(QString("久未更新(%1天)").arg(daysSinceUpdate));
         if (pwned)
@@ -3,6 +3,8 @@
 #include <QBrush>
 #include <QColor>
 
+#include <algorithm>
+
 PasswordHealthModel::PasswordHealthModel(QObject *parent) : QAbstractTableModel(parent) {}
 
 int PasswordHealthModel::rowCount(const QModelIndex &parent) const
@@ -61,7 +63,7 @@ QVariant PasswordHealthModel::data(const QModelIndex &index, int role) const
             return QBrush(QColor("#ffd6d6"));
         if (item.weak)
             return QBrush(QColor("#fff1d6"));
-        if (item.reused)
+        if (item.reused || item.similar)
             return QBrush(QColor("#fff7cc"));
         if (item.stale)
             return QBrush(QColor("#f1f1f1"));
@@ -97,9 +99,76 @@ void PasswordHealthModel::setItems(const QVector<PasswordHealthItem> &items)
 {
     beginResetModel();
     items_ = items;
+    rebuildRowIndex();
     endResetModel();
 }
 
+void PasswordHealthModel::appendItems(const QVector<PasswordHealthItem> &items)
+{
+    if (items.isEmpty())
+        return;
+
+    const auto first = items_.size();
+    beginInsertRows({}, first, first + items.size() - 1);
+    items_ += items;
+    for (int row = first; row < items_.size(); ++row)
+        rowByEntryId_.insert(items_.at(row).entryId, row);
+    endInsertRows();
+}
+
+void PasswordHealthModel::updateItems(const QVector<PasswordHealthItem> &items)
+{
+    QVector<int> rows;
+    rows.reserve(items.size());
+    for (const auto &item : items) {
+        const auto row = rowByEntryId_.value(item.entryId, -1);
+        if (row < 0)
+            continue;
+        items_[row] = item;
+        rows.push_back(row);
+    }
+
+    // Patches tend to touch scattered rows; one dataChanged per contiguous run keeps the proxy's work local.
+    std::sort(rows.begin(), rows.end());
+    for (int i = 0; i < rows.size();) {
+        int last = i;
+        while (last + 1 < rows.size() && rows.at(last + 1) <= rows.at(last) + 1)
+            ++last;
+        emit dataChanged(index(rows.at(i), 0), index(rows.at(last), ColumnCount - 1));
+        i = last + 1;
+    }
+}
+
+void PasswordHealthModel::removeEntries(const QSet<qint64> &entryIds)
+{
+    if (entryIds.isEmpty())
+        return;
+
+    // Back to front so earlier row numbers stay valid; adjacent rows go in one signal.
+    for (int row = items_.size() - 1; row >= 0;) {
+        if (!entryIds.contains(items_.at(row).entryId)) {
+            --row;
+            continue;
+        }
+        int first = row;
+        while (first > 0 && entryIds.contains(items_.at(first - 1).entryId))
+            --first;
+        beginRemoveRows({}, first, row);
+        items_.remove(first, row - first + 1);
+        endRemoveRows();
+        row = first - 1;
+    }
+    rebuildRowIndex();
+}
+
+void PasswordHealthModel::rebuildRowIndex()
+{
+    rowByEntryId_.clear();
+    rowByEntryId_.reserve(items_.size());
+    for (int row = 0; row < items_.size(); ++row)
+        rowByEntryId_.insert(items_.at(row).entryId, row);
+}
+
 PasswordHealthItem PasswordHealthModel::itemAt(int row) const
 {
     if (row < 0 || row >= items_.size())
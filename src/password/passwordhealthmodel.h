@@ -3,6 +3,8 @@
 #include "passwordhealth.h"
 
 #include <QAbstractTableModel>
+#include <QHash>
+#include <QSet>
 #include <QVector>
 
 class PasswordHealthModel final : public QAbstractTableModel
@@ -29,9 +31,18 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
     void setItems(const QVector<PasswordHealthItem> &items);
+    // Streaming scans: rows arrive in batches and are later patched in place, matched by entryId.
+    void appendItems(const QVector<PasswordHealthItem> &items);
+    void updateItems(const QVector<PasswordHealthItem> &items);
+    // Drops rows of deleted entries without resetting the view.
+    void removeEntries(const QSet<qint64> &entryIds);
     PasswordHealthItem itemAt(int row) const;
+    const QVector<PasswordHealthItem> &items() const { return items_; }
 
 private:
+    void rebuildRowIndex();
+
     QVector<PasswordHealthItem> items_;
+    QHash<qint64, int> rowByEntryId_;
 };
 
@@ -1,39 +1,202 @@
 #include "passwordhealthworker.h"
 
 #include "core/crypto.h"
+#include "passwordpwnedofflinedb.h"
+#include "passwordpwnedrangeblob.h"
+#include "passwordpwnedrangefetcher.h"
+#include "passwordsimilarity.h"
 #include "passwordstrength.h"
 
 #include <QCryptographicHash>
 #include <QDateTime>
 #include <QEventLoop>
 #include <QHash>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include <QSet>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QTimer>
+#include <QtEndian>
 #include <QUuid>
+#include <QtConcurrent>
 
+#include <cstring>
 #include <optional>
+#include <utility>
+#include <vector>
 
 namespace {
 
 constexpr int kStaleDaysThreshold = 90;
 constexpr qint64 kPwnedCacheTtlSecs = 30 * 86400;
-constexpr int kPwnedTimeoutMs = 8000;
-constexpr qsizetype kMaxPwnedBodyBytes = 2 * 1024 * 1024;
+// Rows handed to the thread pool at a time; the reader fills the next batch while this one is analysed.
+constexpr int kScanBatchRows = 2048;
+// Rows per map task inside a batch, so a batch spreads over every core without per-row task overhead.
+constexpr int kScanChunkRows = 128;
+// Pwned results are handed to the UI in patches of this many rows rather than one signal per prefix.
+constexpr int kPwnedPatchRows = 256;
+// How often the range fetch loop looks at requestCancel().
+constexpr int kCancelPollMs = 50;
+// Bump whenever evaluatePasswordStrength or the analysis payload below changes; older cache rows are re-analysed.
+constexpr int kHealthScannerVersion = 3;
+constexpr quint8 kAnalysisPayloadFormat = 2;
+// Fixed part of the payload; the similarity skeleton follows it.
+constexpr int kAnalysisPayloadFixedSize = 1 + 1 + 1 + 8 + 8 + 32 + 40 + 1;
 
 QByteArray sha1Hex(const QByteArray &data)
 {
     return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex().toUpper();
 }
 
-bool loadPwnedCache(QSqlDatabase &db, const QByteArray &prefix, QByteArray &bodyOut, qint64 &fetchedAtOut)
+// What health_analysis_cache remembers about one entry, besides the entry id and updated_at it is keyed by.
+struct AnalysisRecord final
+{
+    int strengthScore = 0;
+    bool corrupted = false;
+    QByteArray passwordHash; // SHA-256 of the plaintext; empty when the entry could not be decrypted
+    QByteArray sha1;         // upper-case hex, for the pwned range lookup
+    QString skeleton;        // PasswordSimilarity::skeleton of the plaintext, for near-duplicate grouping
+    qint64 pwnedCheckedAt = 0;
+    qint64 pwnedCount = 0;
+    bool dirty = false; // needs writing back to the cache
+};
+
+struct ScanRow final
+{
+    PasswordHealthItem item;
+    QString tagsCsv;
+    QByteArray passwordEnc;
+    QByteArray cachedAnalysis; // sealed payload, only selected when its key still matches the entry
+    AnalysisRecord analysis;
+};
+
+struct ScanChunk final
+{
+    int begin = 0;
+    int end = 0;
+};
+
+// format | score | corrupted | pwnedCount | pwnedCheckedAt | sha256 | sha1 hex | skeleton length | skeleton (UTF-8);
+// sealed with the vault key by the caller.
+QByteArray encodeAnalysis(const AnalysisRecord &record)
+{
+    const auto skeleton = record.corrupted ? QByteArray() : record.skeleton.toUtf8().left(255);
+    QByteArray out(kAnalysisPayloadFixedSize, '\0');
+    auto *p = reinterpret_cast<uchar *>(out.data());
+    p[0] = kAnalysisPayloadFormat;
+    p[1] = static_cast<uchar>(qBound(0, record.strengthScore, 100));
+    p[2] = record.corrupted ? 1 : 0;
+    qToBigEndian<qint64>(record.pwnedCount, p + 3);
+    qToBigEndian<qint64>(record.pwnedCheckedAt, p + 11);
+    if (!record.corrupted) {
+        memcpy(p + 19, record.passwordHash.constData(), 32);
+        memcpy(p + 51, record.sha1.constData(), 40);
+    }
+    p[91] = static_cast<uchar>(skeleton.size());
+    out.append(skeleton);
+    return out;
+}
+
+bool decodeAnalysis(const QByteArray &payload, AnalysisRecord &out)
+{
+    if (payload.size() < kAnalysisPayloadFixedSize)
+        return false;
+    const auto *p = reinterpret_cast<const uchar *>(payload.constData());
+    if (p[0] != kAnalysisPayloadFormat || p[1] > 100 || payload.size() != kAnalysisPayloadFixedSize + p[91])
+        return false;
+
+    out.strengthScore = p[1];
+    out.corrupted = p[2] != 0;
+    out.pwnedCount = qFromBigEndian<qint64>(p + 3);
+    out.pwnedCheckedAt = qFromBigEndian<qint64>(p + 11);
+    if (!out.corrupted) {
+        out.passwordHash = payload.mid(19, 32);
+        out.sha1 = payload.mid(51, 40);
+        out.skeleton = QString::fromUtf8(payload.mid(kAnalysisPayloadFixedSize));
+    }
+    return true;
+}
+
+// Everything that needs the plaintext happens here, on a pool thread; the plaintext never leaves this call.
+// An entry whose cached analysis is still current skips the decrypt/score/hash work entirely.
+void analyseRow(ScanRow &row, const QByteArray &masterKey, qint64 nowSecs)
+{
+    auto &item = row.item;
+    if (!row.tagsCsv.trimmed().isEmpty()) {
+        for (const auto &t : row.tagsCsv.split(',', Qt::SkipEmptyParts))
+            item.tags.push_back(t.trimmed());
+    }
+
+    const auto ageDays = item.updatedAtSecs > 0 ? static_cast<int>((nowSecs - item.updatedAtSecs) / 86400) : 0;
+    item.daysSinceUpdate = qMax(0, ageDays);
+    item.stale = item.daysSinceUpdate >= kStaleDaysThreshold;
+
+    auto &analysis = row.analysis;
+    bool restored = false;
+    if (!row.cachedAnalysis.isEmpty()) {
+        const auto payload = Crypto::open(masterKey, row.cachedAnalysis);
+        restored = payload.has_value() && decodeAnalysis(payload.value(), analysis);
+        row.cachedAnalysis.clear();
+    }
+
+    if (!restored) {
+        analysis = AnalysisRecord{};
+        analysis.dirty = true;
+        auto plain = Crypto::open(masterKey, row.passwordEnc);
+        if (!plain.has_value()) {
+            analysis.corrupted = true;
+        } else {
+            const auto text = QString::fromUtf8(plain.value());
+            analysis.strengthScore = evaluatePasswordStrength(text).score;
+            analysis.skeleton = PasswordSimilarity::skeleton(text);
+            analysis.passwordHash = Crypto::sha256(plain.value());
+            analysis.sha1 = sha1Hex(plain.value());
+            Crypto::secureZero(plain.value());
+        }
+    }
+    row.passwordEnc.clear();
+
+    item.corrupted = analysis.corrupted;
+    item.strengthScore = analysis.corrupted ? 0 : analysis.strengthScore;
+    item.weak = analysis.corrupted || analysis.strengthScore < 40;
+}
+
+QFuture<void> analyseBatch(std::vector<ScanRow> &batch,
+                           std::vector<ScanChunk> &chunks,
+                           const QByteArray &masterKey,
+                           qint64 nowSecs,
+                           const std::atomic_bool &cancelRequested,
+                           ProgressChannel &progress)
+{
+    chunks.clear();
+    const auto rows = static_cast<int>(batch.size());
+    for (int begin = 0; begin < rows; begin += kScanChunkRows)
+        chunks.push_back(ScanChunk{begin, qMin(begin + kScanChunkRows, rows)});
+
+    auto *data = batch.data();
+    return QtConcurrent::map(chunks, [data, &masterKey, nowSecs, &cancelRequested, &progress](const ScanChunk &chunk) {
+        for (int i = chunk.begin; i < chunk.end; ++i) {
+            if (cancelRequested.load(std::memory_order_relaxed))
+                return;
+            analyseRow(data[i], masterKey, nowSecs);
+        }
+        progress.advance(chunk.end - chunk.begin);
+    });
+}
+
+struct PwnedCacheRow final
+{
+    QByteArray body; // PasswordPwnedRangeBlob, or text from before that format
+    qint64 fetchedAt = 0;
+    QByteArray etag;
+    QByteArray lastModified;
+};
+
+bool loadPwnedCache(QSqlDatabase &db, const QByteArray &prefix, PwnedCacheRow &out)
 {
     QSqlQuery query(db);
     query.prepare(R"sql(
-        SELECT body, fetched_at
+        SELECT body, fetched_at, etag, last_modified
         FROM pwned_prefix_cache
         WHERE prefix = ?
         LIMIT 1
@@ -42,93 +205,86 @@ bool loadPwnedCache(QSqlDatabase &db, const QByteArray &prefix, QByteArray &body
     if (!query.exec() || !query.next())
         return false;
 
-    bodyOut = query.value(0).toByteArray();
-    fetchedAtOut = query.value(1).toLongLong();
-    return !bodyOut.isEmpty();
+    out.body = query.value(0).toByteArray();
+    out.fetchedAt = query.value(1).toLongLong();
+    out.etag = query.value(2).toByteArray();
+    out.lastModified = query.value(3).toByteArray();
+    return !out.body.isEmpty();
 }
 
-void savePwnedCache(QSqlDatabase &db, const QByteArray &prefix, const QByteArray &body, qint64 fetchedAt)
+void savePwnedCache(QSqlDatabase &db,
+                    const QByteArray &prefix,
+                    const QByteArray &stored,
+                    const PasswordPwnedRange &fetched,
+                    qint64 fetchedAt)
 {
     QSqlQuery query(db);
     query.prepare(R"sql(
-        INSERT OR REPLACE INTO pwned_prefix_cache(prefix, body, fetched_at)
-        VALUES(?, ?, ?)
+        INSERT OR REPLACE INTO pwned_prefix_cache(prefix, body, fetched_at, etag, last_modified)
+        VALUES(?, ?, ?, ?, ?)
     )sql");
     query.addBindValue(QString::fromLatin1(prefix));
-    query.addBindValue(body);
+    query.addBindValue(stored);
     query.addBindValue(fetchedAt);
+    query.addBindValue(fetched.etag.isEmpty() ? QVariant() : QString::fromLatin1(fetched.etag));
+    query.addBindValue(fetched.lastModified.isEmpty() ? QVariant() : QString::fromLatin1(fetched.lastModified));
     query.exec();
 }
 
-std::optional<QByteArray> fetchPwnedRange(QNetworkAccessManager &net, const QByteArray &prefix, QString &errorOut)
+void touchPwnedCache(QSqlDatabase &db, const QByteArray &prefix, qint64 fetchedAt)
 {
-    QNetworkRequest req(QUrl(QString("https://api.pwnedpasswords.com/range/%1").arg(QString::fromLatin1(prefix))));
-    req.setHeader(QNetworkRequest::UserAgentHeader, "ToolboxPassword/1.0");
-    req.setRawHeader("Add-Padding", "true");
-    req.setRawHeader("Accept", "text/plain");
-    req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
-
-    auto *reply = net.get(req);
-
-    QEventLoop loop;
-    QTimer timer;
-    timer.setSingleShot(true);
-    QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    timer.start(kPwnedTimeoutMs);
-    loop.exec();
-
-    if (!reply->isFinished()) {
-        reply->abort();
-        errorOut = "泄露检查超时";
-        reply->deleteLater();
-        return std::nullopt;
-    }
+    QSqlQuery query(db);
+    query.prepare("UPDATE pwned_prefix_cache SET fetched_at = ? WHERE prefix = ?");
+    query.addBindValue(fetchedAt);
+    query.addBindValue(QString::fromLatin1(prefix));
+    query.exec();
+}
 
-    const auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    const auto bytes = reply->readAll();
-    const auto ok = (reply->error() == QNetworkReply::NoError) && status >= 200 && status < 300;
-    if (!ok) {
-        errorOut = QString("泄露检查失败：%1").arg(reply->errorString());
-        reply->deleteLater();
-        return std::nullopt;
+struct SealJob final
+{
+    int record = 0;
+    QByteArray sealed;
+};
+
+// Writes back every record that was analysed or pwned-checked in this scan, in one transaction.
+void saveAnalysisCache(QSqlDatabase &db,
+                       const QByteArray &masterKey,
+                       const QVector<PasswordHealthItem> &items,
+                       const std::vector<AnalysisRecord> &records)
+{
+    QVector<SealJob> jobs;
+    for (int i = 0; i < static_cast<int>(records.size()) && i < items.size(); ++i) {
+        if (records.at(static_cast<size_t>(i)).dirty)
+            jobs.push_back(SealJob{i, {}});
     }
+    if (jobs.isEmpty())
+        return;
 
-    reply->deleteLater();
-
-    if (bytes.isEmpty()) {
-        errorOut = "泄露检查响应为空";
-        return std::nullopt;
-    }
-    if (bytes.size() > kMaxPwnedBodyBytes) {
-        errorOut = "泄露检查响应过大";
-        return std::nullopt;
-    }
+    // Sealing costs about as much as the decrypt did, so it goes through the pool as well.
+    QtConcurrent::blockingMap(jobs, [&masterKey, &records](SealJob &job) {
+        job.sealed = Crypto::seal(masterKey, encodeAnalysis(records.at(static_cast<size_t>(job.record))));
+    });
 
-    return bytes;
-}
+    if (!db.transaction())
+        return;
 
-QHash<QByteArray, qint64> parsePwnedBody(const QByteArray &body)
-{
-    QHash<QByteArray, qint64> suffixCounts;
-
-    const auto lines = body.split('\n');
-    for (auto line : lines) {
-        line = line.trimmed();
-        if (line.isEmpty())
-            continue;
-        const auto colon = line.indexOf(':');
-        if (colon <= 0)
-            continue;
-        const auto suffix = line.left(colon).trimmed().toUpper();
-        bool ok = false;
-        const auto count = line.mid(colon + 1).trimmed().toLongLong(&ok);
-        if (!ok)
-            continue;
-        suffixCounts.insert(suffix, count);
+    QSqlQuery upsert(db);
+    upsert.prepare(R"sql(
+        INSERT OR REPLACE INTO health_analysis_cache(entry_id, updated_at, scanner_version, analysis_enc)
+        VALUES(?, ?, ?, ?)
+    )sql");
+    for (const auto &job : std::as_const(jobs)) {
+        const auto &item = items.at(job.record);
+        upsert.addBindValue(item.entryId);
+        upsert.addBindValue(item.updatedAtSecs);
+        upsert.addBindValue(kHealthScannerVersion);
+        upsert.addBindValue(job.sealed);
+        if (!upsert.exec()) {
+            db.rollback();
+            return;
+        }
     }
-
-    return suffixCounts;
+    db.commit();
 }
 
 } // namespace
@@ -160,10 +316,12 @@ void PasswordHealthWorker::run()
 {
     const auto connectionName = QString("toolbox_password_health_%1").arg(QUuid::createUuid().toString(QUuid::WithoutBraces));
     QVector<PasswordHealthItem> items;
-    QVector<QByteArray> passwordHashes;
-    QVector<QByteArray> sha1Hexes;
+    std::vector<AnalysisRecord> records;
+    QHash<QByteArray, int> reuseCounts;
     QString error;
     bool ok = true;
+    progress_->setRange(0, 0);
+    progress_->setValue(0);
 
     {
         auto db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
@@ -185,9 +343,12 @@ void PasswordHealthWorker::run()
         }
 
         if (ok)
-            emit progressRangeChanged(0, total);
+            progress_->setRange(0, total);
 
+        // The cached analysis is only selected when it was written for this very revision of the entry and by
+        // this scanner version; everything else comes back NULL and is analysed from scratch.
         QSqlQuery query(db);
+        query.setForwardOnly(true);
         query.prepare(R"sql(
             SELECT
                 e.id,
@@ -198,150 +359,294 @@ void PasswordHealthWorker::run()
                 e.category,
                 e.updated_at,
                 e.password_enc,
-                GROUP_CONCAT(t.name, ',') AS tags_csv
+                GROUP_CONCAT(t.name, ',') AS tags_csv,
+                CASE WHEN c.updated_at = e.updated_at AND c.scanner_version = ? THEN c.analysis_enc END
             FROM password_entries e
+            LEFT JOIN health_analysis_cache c ON c.entry_id = e.id
             LEFT JOIN entry_tags et ON et.entry_id = e.id
             LEFT JOIN tags t ON t.id = et.tag_id
             GROUP BY e.id
             ORDER BY e.updated_at DESC
         )sql");
+        query.addBindValue(kHealthScannerVersion);
 
         if (ok && !query.exec()) {
             error = QString("读取条目失败：%1").arg(query.lastError().text());
             ok = false;
         }
 
+        // Pipeline: this thread streams rows from SQLite into a batch while the previous batch is decrypted,
+        // scored and hashed on the global pool; finished batches are merged here in cursor order.
         const auto nowSecs = QDateTime::currentDateTime().toSecsSinceEpoch();
+        std::vector<ScanRow> reading;
+        std::vector<ScanRow> analysing;
+        std::vector<ScanChunk> chunks;
+        QFuture<void> pending;
         int index = 0;
+
+        const auto mergeAnalysed = [&]() {
+            pending.waitForFinished();
+            if (analysing.empty())
+                return;
+            if (cancelRequested_.load()) {
+                analysing.clear();
+                return;
+            }
+            QVector<PasswordHealthItem> ready;
+            ready.reserve(static_cast<int>(analysing.size()));
+            for (auto &row : analysing) {
+                const auto &analysis = row.analysis;
+                if (!analysis.passwordHash.isEmpty())
+                    ++reuseCounts[analysis.passwordHash];
+                // Pwned results checked within the range-cache TTL are reused as they are.
+                const auto checkedAge = nowSecs - analysis.pwnedCheckedAt;
+                if (enablePwnedCheck_ && analysis.sha1.size() == 40 && analysis.pwnedCheckedAt > 0 && checkedAge >= 0
+                    && checkedAge <= kPwnedCacheTtlSecs) {
+                    row.item.pwnedChecked = true;
+                    row.item.pwned = analysis.pwnedCount > 0;
+                    row.item.pwnedCount = analysis.pwnedCount;
+                }
+                ready.push_back(row.item);
+                items.push_back(std::move(row.item));
+                records.push_back(std::move(row.analysis));
+            }
+            index += static_cast<int>(analysing.size());
+            analysing.clear();
+            emit itemsReady(ready);
+        };
+
+        const auto dispatch = [&]() {
+            mergeAnalysed();
+            std::swap(reading, analysing);
+            pending = analyseBatch(analysing, chunks, masterKey_, nowSecs, cancelRequested_, *progress_);
+        };
+
+        reading.reserve(kScanBatchRows);
         while (ok && query.next()) {
             if (cancelRequested_.load())
                 break;
 
-            PasswordHealthItem item;
-            item.entryId = query.value(0).toLongLong();
-            item.groupId = query.value(1).toLongLong();
-            item.title = query.value(2).toString();
-            item.username = query.value(3).toString();
-            item.url = query.value(4).toString();
-            item.category = query.value(5).toString();
-            item.updatedAtSecs = query.value(6).toLongLong();
-            const auto passwordEnc = query.value(7).toByteArray();
-            const auto tagsCsv = query.value(8).toString();
-            if (!tagsCsv.trimmed().isEmpty()) {
-                for (const auto &t : tagsCsv.split(',', Qt::SkipEmptyParts))
-                    item.tags.push_back(t.trimmed());
-            }
-
-            const auto ageDays = item.updatedAtSecs > 0 ? static_cast<int>((nowSecs - item.updatedAtSecs) / 86400) : 0;
-            item.daysSinceUpdate = qMax(0, ageDays);
-            item.stale = item.daysSinceUpdate >= kStaleDaysThreshold;
+            ScanRow row;
+            row.item.entryId = query.value(0).toLongLong();
+            row.item.groupId = query.value(1).toLongLong();
+            row.item.title = query.value(2).toString();
+            row.item.username = query.value(3).toString();
+            row.item.url = query.value(4).toString();
+            row.item.category = query.value(5).toString();
+            row.item.updatedAtSecs = query.value(6).toLongLong();
+            row.passwordEnc = query.value(7).toByteArray();
+            row.tagsCsv = query.value(8).toString();
+            row.cachedAnalysis = query.value(9).toByteArray();
+            reading.push_back(std::move(row));
+
+            if (static_cast<int>(reading.size()) >= kScanBatchRows)
+                dispatch();
+        }
+        if (!reading.empty() && !cancelRequested_.load())
+            dispatch();
+        mergeAnalysed();
+        query.finish();
 
-            QByteArray hash;
-            const auto plain = Crypto::open(masterKey_, passwordEnc);
-            if (!plain.has_value()) {
-                item.corrupted = true;
-                item.strengthScore = 0;
-                item.weak = true;
-            } else {
-                const auto pwd = QString::fromUtf8(plain.value());
-                const auto strength = evaluatePasswordStrength(pwd);
-                item.strengthScore = strength.score;
-                item.weak = strength.score < 40;
-                hash = Crypto::sha256(plain.value());
-                sha1Hexes.push_back(sha1Hex(plain.value()));
+        // Every row has been delivered by now, so reuse and similarity are final; patch the rows they apply to.
+        if (ok) {
+            QVector<QString> skeletons;
+            skeletons.reserve(static_cast<int>(records.size()));
+            for (const auto &record : records)
+                skeletons.push_back(record.skeleton);
+            const auto clusters = PasswordSimilarity::cluster(skeletons);
+            // A cluster only counts when it holds two different passwords; copies of one password are reuse.
+            QHash<int, int> clusterEntries;
+            QHash<int, QSet<QByteArray>> clusterPasswords;
+            for (int i = 0; i < clusters.size(); ++i) {
+                const auto c = clusters.at(i);
+                if (c < 0)
+                    continue;
+                ++clusterEntries[c];
+                clusterPasswords[c].insert(records.at(static_cast<size_t>(i)).passwordHash);
             }
 
-            items.push_back(item);
-            passwordHashes.push_back(hash);
-            if (!plain.has_value())
-                sha1Hexes.push_back({});
+            QVector<PasswordHealthItem> patch;
+            for (int i = 0; i < items.size() && i < static_cast<int>(records.size()); ++i) {
+                const auto &h = records.at(static_cast<size_t>(i)).passwordHash;
+                if (h.isEmpty())
+                    continue;
+                bool changed = false;
+                const auto count = reuseCounts.value(h, 0);
+                if (count > 1) {
+                    items[i].reused = true;
+                    items[i].reuseCount = count;
+                    changed = true;
+                }
+                const auto c = i < clusters.size() ? clusters.at(i) : -1;
+                if (c >= 0 && clusterPasswords.value(c).size() > 1) {
+                    items[i].similar = true;
+                    items[i].similarCount = clusterEntries.value(c);
+                    changed = true;
+                }
+                if (!changed)
+                    continue;
+                patch.push_back(items.at(i));
+                if (patch.size() >= kScanBatchRows) {
+                    emit itemsUpdated(patch);
+                    patch.clear();
+                }
+            }
+            if (!patch.isEmpty())
+                emit itemsUpdated(patch);
+        }
 
-            index++;
-            emit progressValueChanged(index);
+        // With the offline corpus every remaining row is answered locally (misses mostly by its in-memory filter)
+        // and nothing is left for the ranges.
+        PasswordPwnedOfflineDb offlineDb;
+        if (enablePwnedCheck_ && ok && !pwnedOfflineDbPath_.isEmpty() && offlineDb.open(pwnedOfflineDbPath_)) {
+            QVector<PasswordHealthItem> patch;
+            for (int i = 0; i < static_cast<int>(records.size()) && i < items.size(); ++i) {
+                if (cancelRequested_.load())
+                    break;
+                auto &record = records[static_cast<size_t>(i)];
+                if (record.sha1.size() != 40 || items.at(i).pwnedChecked)
+                    continue;
+                const auto count = offlineDb.lookup(record.sha1);
+                if (!count.has_value())
+                    continue;
+                items[i].pwnedChecked = true;
+                items[i].pwned = count.value() > 0;
+                items[i].pwnedCount = count.value();
+                record.pwnedCheckedAt = nowSecs;
+                record.pwnedCount = count.value();
+                record.dirty = true;
+                patch.push_back(items.at(i));
+                if (patch.size() >= kPwnedPatchRows) {
+                    emit itemsUpdated(patch);
+                    patch.clear();
+                }
+            }
+            if (!patch.isEmpty())
+                emit itemsUpdated(patch);
         }
 
         if (enablePwnedCheck_ && ok) {
+            // Rows whose cached result was still fresh were marked checked while merging; the rest go to the ranges.
             QHash<QByteArray, QVector<int>> prefixToIndices;
-            for (int i = 0; i < sha1Hexes.size() && i < items.size(); ++i) {
-                const auto &hex = sha1Hexes.at(i);
-                if (hex.size() != 40)
+            for (int i = 0; i < static_cast<int>(records.size()) && i < items.size(); ++i) {
+                const auto &hex = records.at(static_cast<size_t>(i)).sha1;
+                if (hex.size() != 40 || items.at(i).pwnedChecked)
                     continue;
                 const auto prefix = hex.left(5);
                 prefixToIndices[prefix].push_back(i);
             }
 
             if (!prefixToIndices.isEmpty()) {
-                emit progressRangeChanged(0, index + prefixToIndices.size());
-
-                QNetworkAccessManager net;
-                QHash<QByteArray, QByteArray> bodyCache;
+                progress_->setRange(0, index + prefixToIndices.size());
 
-                qint64 pwnedCacheErrors = 0;
-                qint64 pwnedNetworkErrors = 0;
                 int prefixDone = 0;
-
-                for (auto it = prefixToIndices.begin(); it != prefixToIndices.end(); ++it) {
-                    if (cancelRequested_.load())
-                        break;
-
-                    const auto prefix = it.key();
-                    QByteArray body;
-                    qint64 fetchedAt = 0;
-                    const auto now = QDateTime::currentDateTime().toSecsSinceEpoch();
-
-                    bool haveBody = false;
-                    if (bodyCache.contains(prefix)) {
-                        body = bodyCache.value(prefix);
-                        haveBody = !body.isEmpty();
-                    } else {
-                        if (loadPwnedCache(db, prefix, body, fetchedAt)) {
-                            const auto age = now - fetchedAt;
-                            if (age >= 0 && age <= kPwnedCacheTtlSecs) {
-                                bodyCache.insert(prefix, body);
-                                haveBody = true;
-                            }
-                        }
-
-                        if (!haveBody && allowNetwork_) {
-                            QString fetchError;
-                            const auto fetched = fetchPwnedRange(net, prefix, fetchError);
-                            if (fetched.has_value()) {
-                                body = fetched.value();
-                                bodyCache.insert(prefix, body);
-                                savePwnedCache(db, prefix, body, now);
-                                haveBody = true;
-                            } else {
-                                pwnedNetworkErrors++;
-                            }
-                        } else if (!haveBody) {
-                            pwnedCacheErrors++;
-                        }
-                    }
-
-                    if (haveBody) {
-                        const auto suffixCounts = parsePwnedBody(body);
-                        for (const auto idx : it.value()) {
+                QVector<PasswordHealthItem> patch;
+                // `stored` is the cached form of the range; each suffix is found by binary search on it in place.
+                const auto applyRange = [&](const QByteArray &prefix, const QByteArray &stored, qint64 checkedAt) {
+                    if (!stored.isEmpty()) {
+                        for (const auto idx : prefixToIndices.value(prefix)) {
                             if (idx < 0 || idx >= items.size())
                                 continue;
-                            const auto suffix = sha1Hexes.at(idx).mid(5).toUpper();
+                            auto &record = records[static_cast<size_t>(idx)];
                             items[idx].pwnedChecked = true;
-                            const auto count = suffixCounts.value(suffix, 0);
+                            const auto count = PasswordPwnedRangeBlob::count(stored, record.sha1.mid(5));
                             if (count > 0) {
                                 items[idx].pwned = true;
                                 items[idx].pwnedCount = count;
                             }
+                            record.pwnedCheckedAt = checkedAt;
+                            record.pwnedCount = count;
+                            record.dirty = true;
+                            patch.push_back(items.at(idx));
+                        }
+                        if (patch.size() >= kPwnedPatchRows) {
+                            emit itemsUpdated(patch);
+                            patch.clear();
                         }
                     }
-
                     prefixDone++;
-                    emit progressValueChanged(index + prefixDone);
+                    progress_->setValue(index + prefixDone);
+                };
+
+                // Everything still fresh in pwned_prefix_cache first, without touching the network. Expired
+                // copies are kept for their validators, and for their body when the server answers 304.
+                QHash<QByteArray, PwnedCacheRow> expired;
+                QVector<QByteArray> toFetch;
+                const auto now = QDateTime::currentDateTime().toSecsSinceEpoch();
+                for (auto it = prefixToIndices.cbegin(); it != prefixToIndices.cend(); ++it) {
+                    if (cancelRequested_.load())
+                        break;
+
+                    const auto &prefix = it.key();
+                    PwnedCacheRow cached;
+                    if (loadPwnedCache(db, prefix, cached)) {
+                        const auto age = now - cached.fetchedAt;
+                        if (age >= 0 && age <= kPwnedCacheTtlSecs) {
+                            // The result is as old as the range, not this scan; stamping `now` would let the
+                            // entry skip the network for up to another TTL.
+                            applyRange(prefix, cached.body, cached.fetchedAt);
+                            continue;
+                        }
+                        if (allowNetwork_)
+                            expired.insert(prefix, cached);
+                    }
+
+                    if (allowNetwork_)
+                        toFetch.push_back(prefix);
+                    else
+                        applyRange(prefix, {}, now); // stays unchecked
+                }
+
+                // The rest go out concurrently; each range is stored and applied the moment it lands.
+                if (!toFetch.isEmpty() && !cancelRequested_.load()) {
+                    PasswordPwnedRangeFetcher fetcher(pwnedRangeBaseUrl_);
+                    fetcher.setMaxInFlight(pwnedMaxInFlight_);
+                    QEventLoop loop;
+
+                    connect(&fetcher, &PasswordPwnedRangeFetcher::rangeReady, &loop, [&db, &expired, &applyRange](const PasswordPwnedRange &range) {
+                        const auto fetchedAt = QDateTime::currentDateTime().toSecsSinceEpoch();
+                        if (range.notModified) {
+                            touchPwnedCache(db, range.prefix, fetchedAt);
+                            applyRange(range.prefix, expired.value(range.prefix).body, fetchedAt);
+                        } else {
+                            const auto stored = PasswordPwnedRangeBlob::encode(range.body);
+                            savePwnedCache(db, range.prefix, stored, range, fetchedAt);
+                            applyRange(range.prefix, stored, fetchedAt);
+                        }
+                    });
+                    connect(&fetcher, &PasswordPwnedRangeFetcher::rangeFailed, &loop, [&applyRange](const QByteArray &prefix) {
+                        applyRange(prefix, {}, 0);
+                    });
+                    connect(&fetcher, &PasswordPwnedRangeFetcher::idle, &loop, &QEventLoop::quit);
+
+                    QTimer cancelPoll;
+                    connect(&cancelPoll, &QTimer::timeout, &loop, [this, &fetcher, &loop]() {
+                        if (!cancelRequested_.load())
+                            return;
+                        fetcher.abort();
+                        loop.quit();
+                    });
+                    cancelPoll.start(kCancelPollMs);
+
+                    for (const auto &prefix : std::as_const(toFetch)) {
+                        const auto cached = expired.constFind(prefix);
+                        if (cached != expired.cend())
+                            fetcher.enqueue(prefix, cached->etag, cached->lastModified);
+                        else
+                            fetcher.enqueue(prefix);
+                    }
+                    if (!fetcher.isIdle())
+                        loop.exec();
                 }
 
-                Q_UNUSED(pwnedCacheErrors);
-                Q_UNUSED(pwnedNetworkErrors);
+                if (!patch.isEmpty())
+                    emit itemsUpdated(patch);
             }
         }
 
+        if (ok && !cancelRequested_.load())
+            saveAnalysisCache(db, masterKey_, items, records);
+
         db.close();
     }
 
@@ -352,23 +657,5 @@ void PasswordHealthWorker::run()
         return;
     }
 
-    QHash<QByteArray, int> counts;
-    for (const auto &h : passwordHashes) {
-        if (h.isEmpty())
-            continue;
-        counts[h] = counts.value(h, 0) + 1;
-    }
-
-    for (int i = 0; i < items.size() && i < passwordHashes.size(); ++i) {
-        const auto &h = passwordHashes.at(i);
-        if (h.isEmpty())
-            continue;
-        const auto count = counts.value(h, 0);
-        if (count > 1) {
-            items[i].reused = true;
-            items[i].reuseCount = count;
-        }
-    }
-
     emit finished(items);
 }
@@ -1,12 +1,15 @@
 #pragma once
 
+#include "core/progresschannel.h"
 #include "passwordhealth.h"
 
 #include <QByteArray>
 #include <QObject>
 #include <QString>
+#include <QUrl>
 
 #include <atomic>
+#include <memory>
 
 class PasswordHealthWorker final : public QObject
 {
@@ -21,10 +24,23 @@ public:
     ~PasswordHealthWorker() override;
 
     void requestCancel();
+    // Rows analysed; when the pwned check runs, the range grows by the number of prefixes to resolve.
+    std::shared_ptr<const ProgressChannel> progress() const { return progress_; }
+
+    // Range API endpoint; the 5-character prefix is appended. Overridable for tests and mirrors.
+    void setPwnedRangeBaseUrl(const QUrl &url) { pwnedRangeBaseUrl_ = url; }
+    // Range requests kept open at once while the pwned check runs.
+    void setPwnedMaxInFlight(int requests) { pwnedMaxInFlight_ = qMax(1, requests); }
+    // Offline corpus (see PasswordPwnedOfflineDb) consulted before the range cache and the network.
+    void setPwnedOfflineDbPath(const QString &path) { pwnedOfflineDbPath_ = path; }
 
 signals:
-    void progressRangeChanged(int min, int max);
-    void progressValueChanged(int value);
+    // Rows in scan order, one batch at a time as soon as they are analysed. Reuse and pwned flags are not final.
+    void itemsReady(const QVector<PasswordHealthItem> &items);
+    // Later versions of rows already sent through itemsReady (same entryId): reuse and similarity first, then
+    // pwned results.
+    void itemsUpdated(const QVector<PasswordHealthItem> &items);
+    // The complete, final result. QVector is implicitly shared, so the queued copy is a reference count.
     void finished(const QVector<PasswordHealthItem> &items);
     void failed(const QString &error);
 
@@ -36,5 +52,9 @@ private:
     QByteArray masterKey_;
     bool enablePwnedCheck_ = false;
     bool allowNetwork_ = true;
+    QUrl pwnedRangeBaseUrl_{QStringLiteral("https://api.pwnedpasswords.com/range/")};
+    int pwnedMaxInFlight_ = 8;
+    QString pwnedOfflineDbPath_;
     std::atomic_bool cancelRequested_{false};
+    const std::shared_ptr<ProgressChannel> progress_ = std::make_shared<ProgressChannel>();
 };
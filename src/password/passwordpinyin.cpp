@@ -0,0 +1,115 @@
+#include "passwordpinyin.h"
+
+#include <QStringView>
+#include <QtGlobal>
+
+namespace {
+
+#include "passwordpinyintable.inc"
+
+static_assert(sizeof(kPinyinSyllableIndex) / sizeof(kPinyinSyllableIndex[0]) == kPinyinLastHan - kPinyinFirstHan + 1,
+              "pinyin table does not cover the Han range");
+
+struct PhraseReading final
+{
+    const char16_t *phrase;
+    const char *syllables[3]; // one per character of `phrase`
+};
+
+// The generated table holds one reading per character, ICU's default, which is wrong for heteronyms in many
+// words that name banks, cities and services: 银行 would read "yinxing", 重庆 "zhongqing". Words listed here
+// are read as a whole before falling back to the per-character table. Keep it to words likely to appear in
+// entry titles and categories.
+constexpr PhraseReading kPhraseReadings[] = {
+    {u"银行", {"yin", "hang"}},        {u"工行", {"gong", "hang"}},      {u"农行", {"nong", "hang"}},
+    {u"中行", {"zhong", "hang"}},      {u"建行", {"jian", "hang"}},      {u"交行", {"jiao", "hang"}},
+    {u"招行", {"zhao", "hang"}},       {u"支行", {"zhi", "hang"}},       {u"分行", {"fen", "hang"}},
+    {u"总行", {"zong", "hang"}},       {u"行业", {"hang", "ye"}},        {u"重庆", {"chong", "qing"}},
+    {u"长沙", {"chang", "sha"}},       {u"长春", {"chang", "chun"}},     {u"长城", {"chang", "cheng"}},
+    {u"长江", {"chang", "jiang"}},     {u"长安", {"chang", "an"}},       {u"厦门", {"xia", "men"}},
+    {u"成都", {"cheng", "du"}},        {u"首都", {"shou", "du"}},        {u"都市", {"du", "shi"}},
+    {u"蚌埠", {"beng", "bu"}},         {u"六安", {"lu", "an"}},          {u"音乐", {"yin", "yue"}},
+    {u"会计", {"kuai", "ji"}},         {u"还款", {"huan", "kuan"}},      {u"地址", {"di", "zhi"}},
+    {u"地图", {"di", "tu"}},           {u"地铁", {"di", "tie"}},         {u"地区", {"di", "qu"}},
+    {u"空调", {"kong", "tiao"}},       {u"角色", {"jue", "se"}},         {u"薄荷", {"bo", "he"}},
+};
+
+// The longest listed word starting at `text[pos]`, or nullptr.
+const PhraseReading *phraseAt(const QString &text, int pos)
+{
+    const auto rest = QStringView(text).mid(pos);
+    const PhraseReading *best = nullptr;
+    qsizetype bestLength = 0;
+    for (const auto &reading : kPhraseReadings) {
+        const QStringView phrase(reading.phrase);
+        if (phrase.size() > bestLength && rest.startsWith(phrase)) {
+            best = &reading;
+            bestLength = phrase.size();
+        }
+    }
+    return best;
+}
+
+const char *syllableFor(QChar ch)
+{
+    const auto code = ch.unicode();
+    if (code < kPinyinFirstHan || code > kPinyinLastHan)
+        return nullptr;
+
+    const auto index = kPinyinSyllableIndex[code - kPinyinFirstHan];
+    return index == 0 ? nullptr : kPinyinSyllables[index];
+}
+
+} // namespace
+
+namespace PasswordPinyin {
+
+bool containsHan(const QString &text)
+{
+    for (const auto ch : text) {
+        if (syllableFor(ch))
+            return true;
+    }
+    return false;
+}
+
+Keys keysFor(const QString &text)
+{
+    Keys keys;
+    keys.full.reserve(text.size() * 4);
+    keys.initials.reserve(text.size());
+
+    bool inWord = false;
+    for (int pos = 0; pos < text.size(); ++pos) {
+        const auto ch = text.at(pos);
+        if (const auto *syllable = syllableFor(ch)) {
+            if (const auto *reading = phraseAt(text, pos)) {
+                const auto length = static_cast<int>(QStringView(reading->phrase).size());
+                for (int i = 0; i < length; ++i) {
+                    keys.full.append(QLatin1String(reading->syllables[i]));
+                    keys.initials.append(QLatin1Char(reading->syllables[i][0]));
+                }
+                pos += length - 1;
+            } else {
+                keys.full.append(QLatin1String(syllable));
+                keys.initials.append(QLatin1Char(syllable[0]));
+            }
+            inWord = true;
+        } else if (ch.isLetterOrNumber()) {
+            const auto folded = QString(ch).toCaseFolded();
+            keys.full.append(folded);
+            keys.initials.append(folded);
+            inWord = true;
+        } else if (inWord) {
+            keys.full.append(QLatin1Char(' '));
+            keys.initials.append(QLatin1Char(' '));
+            inWord = false;
+        }
+    }
+
+    keys.full = keys.full.trimmed();
+    keys.initials = keys.initials.trimmed();
+    return keys;
+}
+
+} // namespace PasswordPinyin
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QString>
+
+namespace PasswordPinyin {
+
+struct Keys final
+{
+    QString full;     // "支付宝" -> "zhifubao"
+    QString initials; // "支付宝" -> "zfb"
+};
+
+bool containsHan(const QString &text);
+
+// Toneless pinyin for Han characters (table generated at build time, see tools/gen_pinyin_table.py), with
+// whole-word readings for common heteronyms, so "工商银行" gives "gongshangyinhang" / "gsyh".
+// Letters and digits pass through case-folded, so "QQ邮箱" gives "qqyouxiang" / "qqyx";
+// other characters become word breaks.
+Keys keysFor(const QString &text);
+
+} // namespace PasswordPinyin
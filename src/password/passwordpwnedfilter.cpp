@@ -0,0 +1,436 @@
+#include "passwordpwnedfilter.h"
+
+#include "passwordpwnedofflinedb.h"
+
+#include "core/progresschannel.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'B', 'X', 'F', 'U', 'S', 'E', '8'};
+constexpr quint32 kFingerprintBits = 8;
+constexpr quint32 kArity = 3;
+constexpr quint32 kMaxSegmentLength = 262144;
+// Construction succeeds on the first seed almost always; the bound only guards against pathological input.
+constexpr int kMaxSeedAttempts = 100;
+
+struct FuseShape
+{
+    quint64 seed = 0;
+    quint32 segmentLength = 0;
+    quint32 segmentCount = 0;
+    quint32 arrayLength = 0;
+
+    quint32 segmentLengthMask() const { return segmentLength - 1; }
+    quint64 segmentCountLength() const { return quint64(segmentCount) * segmentLength; }
+};
+
+quint64 murmur64(quint64 h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+quint64 splitmix64(quint64 &state)
+{
+    auto z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// High 64 bits of a 64x64 product, without relying on a 128-bit integer type.
+quint64 mulhi(quint64 a, quint64 b)
+{
+    const auto aLo = a & 0xffffffffull;
+    const auto aHi = a >> 32;
+    const auto bLo = b & 0xffffffffull;
+    const auto bHi = b >> 32;
+    const auto loLo = aLo * bLo;
+    const auto hiLo = aHi * bLo;
+    const auto loHi = aLo * bHi;
+    const auto cross = (loLo >> 32) + (hiLo & 0xffffffffull) + loHi;
+    return aHi * bHi + (hiLo >> 32) + (cross >> 32);
+}
+
+uchar fingerprint(quint64 hash)
+{
+    return static_cast<uchar>(hash ^ (hash >> 32));
+}
+
+// The three slots of a key: one per consecutive segment, starting at a segment picked by the high bits.
+quint32 slot(quint32 index, quint64 hash, const FuseShape &shape)
+{
+    auto h = mulhi(hash, shape.segmentCountLength());
+    h += quint64(index) * shape.segmentLength;
+    const auto low = hash & ((1ull << 36) - 1);
+    h ^= (low >> (36 - 18 * index)) & shape.segmentLengthMask();
+    return static_cast<quint32>(h);
+}
+
+FuseShape shapeFor(quint64 size)
+{
+    FuseShape shape;
+    shape.segmentLength =
+        size == 0 ? 4 : quint32(1) << int(std::floor(std::log(double(size)) / std::log(3.33) + 2.25));
+    shape.segmentLength = qMin(shape.segmentLength, kMaxSegmentLength);
+    const auto sizeFactor = size <= 1 ? 0.0 : std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) / std::log(double(size)));
+    const auto capacity = size <= 1 ? quint32(0) : static_cast<quint32>(std::round(double(size) * sizeFactor));
+    // Unsigned wrap-around in the first step is undone by the second, as in the reference construction.
+    const quint32 initSegmentCount = (capacity + shape.segmentLength - 1) / shape.segmentLength - (kArity - 1);
+    auto arrayLength = (initSegmentCount + kArity - 1) * shape.segmentLength;
+    auto segmentCount = (arrayLength + shape.segmentLength - 1) / shape.segmentLength;
+    segmentCount = segmentCount <= kArity - 1 ? 1 : segmentCount - (kArity - 1);
+    shape.segmentCount = segmentCount;
+    shape.arrayLength = (segmentCount + kArity - 1) * shape.segmentLength;
+    return shape;
+}
+
+// Peels the 3-hypergraph of `keys` and assigns fingerprints so that the three slots of every key XOR to its
+// fingerprint. Retries with a fresh seed when the graph does not peel.
+bool populate(const std::vector<quint64> &keys, FuseShape &shape, std::vector<uchar> &fingerprints)
+{
+    const auto size = keys.size();
+    const auto capacity = static_cast<size_t>(shape.arrayLength);
+    fingerprints.assign(capacity, 0);
+
+    quint64 rng = 0x726b2b9d438b9d4dull;
+    shape.seed = splitmix64(rng);
+    if (size == 0)
+        return true;
+
+    std::vector<quint64> reverseOrder(size + 1, 0);
+    std::vector<uchar> reverseH(size, 0);
+    std::vector<quint32> alone(capacity, 0);
+    std::vector<uchar> t2count(capacity, 0);
+    std::vector<quint64> t2hash(capacity, 0);
+
+    int blockBits = 1;
+    while ((quint32(1) << blockBits) < shape.segmentCount)
+        ++blockBits;
+    const auto block = size_t(1) << blockBits;
+    std::vector<size_t> startPos(block, 0);
+    quint32 h012[5];
+    size_t stackSize = 0;
+
+    for (int attempt = 0;; ++attempt) {
+        if (attempt >= kMaxSeedAttempts)
+            return false;
+
+        // Bucket the hashes by their top bits first, so the counting pass below walks memory mostly in order.
+        std::fill(reverseOrder.begin(), reverseOrder.end(), 0);
+        reverseOrder[size] = 1;
+        for (size_t i = 0; i < block; ++i)
+            startPos[i] = (quint64(i) * size) >> blockBits;
+        for (size_t i = 0; i < size; ++i) {
+            const auto hash = murmur64(keys[i] + shape.seed);
+            auto segment = static_cast<size_t>(hash >> (64 - blockBits));
+            while (reverseOrder[startPos[segment]] != 0)
+                segment = (segment + 1) & (block - 1);
+            reverseOrder[startPos[segment]] = hash;
+            ++startPos[segment];
+        }
+
+        // t2count: number of keys per slot (upper bits) and XOR of which of its three slots this is (low 2 bits).
+        bool error = false;
+        size_t duplicates = 0;
+        for (size_t i = 0; i < size; ++i) {
+            const auto hash = reverseOrder[i];
+            const auto h0 = slot(0, hash, shape);
+            const auto h1 = slot(1, hash, shape);
+            const auto h2 = slot(2, hash, shape);
+            t2count[h0] += 4;
+            t2hash[h0] ^= hash;
+            t2count[h1] += 4;
+            t2count[h1] ^= 1;
+            t2hash[h1] ^= hash;
+            t2count[h2] += 4;
+            t2hash[h2] ^= hash;
+            t2count[h2] ^= 2;
+            if ((t2hash[h0] & t2hash[h1] & t2hash[h2]) == 0) {
+                if ((t2hash[h0] == 0 && t2count[h0] == 8) || (t2hash[h1] == 0 && t2count[h1] == 8)
+                    || (t2hash[h2] == 0 && t2count[h2] == 8)) {
+                    ++duplicates;
+                    t2count[h0] -= 4;
+                    t2hash[h0] ^= hash;
+                    t2count[h1] -= 4;
+                    t2count[h1] ^= 1;
+                    t2hash[h1] ^= hash;
+                    t2count[h2] -= 4;
+                    t2count[h2] ^= 2;
+                    t2hash[h2] ^= hash;
+                }
+            }
+            // A slot count that wrapped means more than 63 keys landed in one slot; try another seed.
+            error = error || t2count[h0] < 4 || t2count[h1] < 4 || t2count[h2] < 4;
+        }
+
+        if (!error) {
+            size_t queued = 0;
+            for (size_t i = 0; i < capacity; ++i) {
+                alone[queued] = static_cast<quint32>(i);
+                queued += (t2count[i] >> 2) == 1 ? 1 : 0;
+            }
+            stackSize = 0;
+            while (queued > 0) {
+                --queued;
+                const auto index = alone[queued];
+                if ((t2count[index] >> 2) != 1)
+                    continue;
+                const auto hash = t2hash[index];
+                const auto found = t2count[index] & 3;
+                reverseH[stackSize] = found;
+                reverseOrder[stackSize] = hash;
+                ++stackSize;
+
+                h012[0] = slot(0, hash, shape);
+                h012[1] = slot(1, hash, shape);
+                h012[2] = slot(2, hash, shape);
+                h012[3] = h012[0];
+                h012[4] = h012[1];
+
+                const auto other1 = h012[found + 1];
+                alone[queued] = other1;
+                queued += (t2count[other1] >> 2) == 2 ? 1 : 0;
+                t2count[other1] -= 4;
+                t2count[other1] ^= (found + 1) % 3;
+                t2hash[other1] ^= hash;
+
+                const auto other2 = h012[found + 2];
+                alone[queued] = other2;
+                queued += (t2count[other2] >> 2) == 2 ? 1 : 0;
+                t2count[other2] -= 4;
+                t2count[other2] ^= (found + 2) % 3;
+                t2hash[other2] ^= hash;
+            }
+            if (stackSize + duplicates == size)
+                break;
+        }
+
+        std::fill(t2count.begin(), t2count.end(), 0);
+        std::fill(t2hash.begin(), t2hash.end(), 0);
+        shape.seed = splitmix64(rng);
+    }
+
+    // Assign in reverse peeling order: each key's free slot is the last of its three to be written.
+    for (size_t i = stackSize; i-- > 0;) {
+        const auto hash = reverseOrder[i];
+        const auto found = reverseH[i];
+        h012[0] = slot(0, hash, shape);
+        h012[1] = slot(1, hash, shape);
+        h012[2] = slot(2, hash, shape);
+        h012[3] = h012[0];
+        h012[4] = h012[1];
+        fingerprints[h012[found]] = fingerprint(hash) ^ fingerprints[h012[found + 1]] ^ fingerprints[h012[found + 2]];
+    }
+    return true;
+}
+
+} // namespace
+
+PasswordPwnedFilter::~PasswordPwnedFilter()
+{
+    close();
+}
+
+QString PasswordPwnedFilter::pathForCorpus(const QString &corpusPath)
+{
+    const QFileInfo info(corpusPath);
+    return info.dir().filePath(info.completeBaseName() + ".filter");
+}
+
+bool PasswordPwnedFilter::build(const PasswordPwnedOfflineDb &corpus,
+                                const QString &outputPath,
+                                const std::atomic_bool &cancelRequested,
+                                ProgressChannel &progress)
+{
+    lastError_.clear();
+    if (!corpus.isOpen()) {
+        setError("离线泄露库未打开");
+        return false;
+    }
+
+    quint32 shardBits = 0;
+    while ((corpus.recordCount() >> shardBits) > kMaxShardKeys && shardBits < PasswordPwnedOfflineDb::kPrefixBits)
+        ++shardBits;
+    const auto shards = quint32(1) << shardBits;
+    const auto bucketsPerShard = quint32(1) << (PasswordPwnedOfflineDb::kPrefixBits - shardBits);
+
+    QSaveFile out(outputPath);
+    if (!out.open(QIODevice::WriteOnly)) {
+        setError(QString("无法写入泄露过滤器：%1").arg(out.errorString()));
+        return false;
+    }
+
+    // Header and shard table are filled in once every shard is placed.
+    QByteArray header(kHeaderSize, '\0');
+    QByteArray table(static_cast<int>(shards) * kShardEntrySize, '\0');
+    if (out.write(header) != header.size() || out.write(table) != table.size()) {
+        out.cancelWriting();
+        setError(QString("写入泄露过滤器失败：%1").arg(out.errorString()));
+        return false;
+    }
+
+    progress.setValue(0);
+    progress.setRange(0, shards);
+
+    std::vector<quint64> keys;
+    std::vector<uchar> fingerprints;
+    quint64 totalKeys = 0;
+    for (quint32 shard = 0; shard < shards; ++shard) {
+        if (cancelRequested.load()) {
+            out.cancelWriting();
+            setError("已取消导入");
+            return false;
+        }
+
+        keys.clear();
+        corpus.collectKeys(shard * bucketsPerShard, (shard + 1) * bucketsPerShard, keys);
+        auto shape = shapeFor(keys.size());
+        if (!populate(keys, shape, fingerprints)) {
+            out.cancelWriting();
+            setError("构建泄露过滤器失败：哈希冲突过多");
+            return false;
+        }
+
+        auto *entry = reinterpret_cast<uchar *>(table.data()) + qint64(shard) * kShardEntrySize;
+        qToLittleEndian<quint64>(shape.seed, entry);
+        qToLittleEndian<quint32>(shape.segmentLength, entry + 8);
+        qToLittleEndian<quint32>(shape.segmentCount, entry + 12);
+        qToLittleEndian<quint32>(shape.arrayLength, entry + 16);
+        qToLittleEndian<quint64>(static_cast<quint64>(out.pos()), entry + 24);
+        const auto bytes = static_cast<qint64>(fingerprints.size());
+        if (out.write(reinterpret_cast<const char *>(fingerprints.data()), bytes) != bytes) {
+            out.cancelWriting();
+            setError(QString("写入泄露过滤器失败：%1").arg(out.errorString()));
+            return false;
+        }
+        totalKeys += keys.size();
+        progress.advance();
+    }
+
+    auto *h = reinterpret_cast<uchar *>(header.data());
+    std::memcpy(h, kMagic, sizeof(kMagic));
+    qToLittleEndian<quint32>(kFormat, h + 8);
+    qToLittleEndian<quint32>(shardBits, h + 12);
+    qToLittleEndian<quint32>(kFingerprintBits, h + 16);
+    qToLittleEndian<quint64>(totalKeys, h + 24);
+    qToLittleEndian<quint64>(corpus.recordCount(), h + 32);
+
+    if (!out.seek(0) || out.write(header) != header.size() || out.write(table) != table.size() || !out.commit()) {
+        out.cancelWriting();
+        setError(QString("写入泄露过滤器失败：%1").arg(out.errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool PasswordPwnedFilter::open(const QString &path)
+{
+    close();
+    lastError_.clear();
+
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadOnly)) {
+        setError(QString("打开泄露过滤器失败：%1").arg(file_.errorString()));
+        return false;
+    }
+
+    const auto size = file_.size();
+    if (size < kHeaderSize) {
+        setError("泄露过滤器文件不完整");
+        file_.close();
+        return false;
+    }
+    auto *base = file_.map(0, size);
+    if (!base) {
+        setError(QString("映射泄露过滤器失败：%1").arg(file_.errorString()));
+        file_.close();
+        return false;
+    }
+
+    const auto fail = [this, base](const QString &error) {
+        setError(error);
+        file_.unmap(base);
+        file_.close();
+        return false;
+    };
+
+    const auto format = qFromLittleEndian<quint32>(base + 8);
+    const auto shardBits = qFromLittleEndian<quint32>(base + 12);
+    const auto fingerprintBits = qFromLittleEndian<quint32>(base + 16);
+    if (std::memcmp(base, kMagic, sizeof(kMagic)) != 0 || format != kFormat || fingerprintBits != kFingerprintBits
+        || shardBits > quint32(PasswordPwnedOfflineDb::kPrefixBits))
+        return fail("泄露过滤器格式不受支持");
+
+    const auto shards = quint32(1) << shardBits;
+    if (size < kHeaderSize + qint64(shards) * kShardEntrySize)
+        return fail("泄露过滤器文件不完整");
+    // Check every shard once here so lookups can index without bounds checks.
+    for (quint32 shard = 0; shard < shards; ++shard) {
+        const auto *entry = base + kHeaderSize + qint64(shard) * kShardEntrySize;
+        const auto segmentLength = qFromLittleEndian<quint32>(entry + 8);
+        const auto segmentCount = qFromLittleEndian<quint32>(entry + 12);
+        const auto arrayLength = qFromLittleEndian<quint32>(entry + 16);
+        const auto offset = qFromLittleEndian<quint64>(entry + 24);
+        if (segmentLength == 0 || (segmentLength & (segmentLength - 1)) != 0 || segmentLength > kMaxSegmentLength
+            || segmentCount == 0 || quint64(arrayLength) < (quint64(segmentCount) + kArity - 1) * segmentLength
+            || offset > quint64(size) || quint64(size) - offset < arrayLength)
+            return fail("泄露过滤器文件已损坏");
+    }
+
+    base_ = base;
+    shardBits_ = shardBits;
+    keyCount_ = qFromLittleEndian<quint64>(base + 24);
+    corpusRecords_ = qFromLittleEndian<quint64>(base + 32);
+    return true;
+}
+
+void PasswordPwnedFilter::close()
+{
+    if (base_)
+        file_.unmap(const_cast<uchar *>(base_));
+    base_ = nullptr;
+    shardBits_ = 0;
+    keyCount_ = 0;
+    corpusRecords_ = 0;
+    if (file_.isOpen())
+        file_.close();
+}
+
+bool PasswordPwnedFilter::mayContain(quint64 key60) const
+{
+    if (!isOpen())
+        return true;
+
+    const auto shard = shardBits_ == 0 ? quint32(0) : static_cast<quint32>(key60 >> (60 - shardBits_));
+    const auto *entry = base_ + kHeaderSize + qint64(shard) * kShardEntrySize;
+    FuseShape shape;
+    shape.seed = qFromLittleEndian<quint64>(entry);
+    shape.segmentLength = qFromLittleEndian<quint32>(entry + 8);
+    shape.segmentCount = qFromLittleEndian<quint32>(entry + 12);
+    const auto *fingerprints = base_ + qFromLittleEndian<quint64>(entry + 24);
+
+    const auto hash = murmur64(key60 + shape.seed);
+    const auto f = fingerprint(hash) ^ fingerprints[slot(0, hash, shape)] ^ fingerprints[slot(1, hash, shape)]
+                   ^ fingerprints[slot(2, hash, shape)];
+    return f == 0;
+}
+
+void PasswordPwnedFilter::setError(const QString &error)
+{
+    lastError_ = error;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+
+#include <atomic>
+
+class PasswordPwnedOfflineDb;
+class ProgressChannel;
+
+// Binary fuse filter (8-bit fingerprints, three-way) over the 60-bit keys of the offline breach corpus, so a
+// lookup that misses costs three cache lines in RAM instead of a probe into the multi-GB corpus. About 9 bits
+// per key, with a 1/256 false-positive rate that the exact lookup then resolves. Layout (little-endian):
+//   header  magic "TBXFUSE8", u32 format, u32 shard bits, u32 fingerprint bits (8), u32 reserved,
+//           u64 keys, u64 corpus records (the filter is ignored unless this matches the corpus)
+//   shards  2^shard bits entries of u64 seed, u32 segment length, u32 segment count, u32 array length,
+//           u32 reserved, u64 fingerprint offset
+//   fingerprints of every shard, back to back
+// Keys are sharded by their top bits so construction stays within a few hundred MB for the full corpus.
+class PasswordPwnedFilter final
+{
+public:
+    static constexpr quint32 kFormat = 1;
+    static constexpr int kHeaderSize = 40;
+    static constexpr int kShardEntrySize = 32;
+    static constexpr quint64 kMaxShardKeys = 4u * 1024 * 1024;
+
+    PasswordPwnedFilter() = default;
+    ~PasswordPwnedFilter();
+    PasswordPwnedFilter(const PasswordPwnedFilter &) = delete;
+    PasswordPwnedFilter &operator=(const PasswordPwnedFilter &) = delete;
+
+    // The filter lives next to the corpus it was built from.
+    static QString pathForCorpus(const QString &corpusPath);
+
+    // Writes a filter over every key of `corpus`. `progress` counts shards.
+    bool build(const PasswordPwnedOfflineDb &corpus,
+               const QString &outputPath,
+               const std::atomic_bool &cancelRequested,
+               ProgressChannel &progress);
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return base_ != nullptr; }
+    QString lastError() const { return lastError_; }
+
+    quint64 keyCount() const { return keyCount_; }
+    quint64 corpusRecords() const { return corpusRecords_; }
+    // false: the key is definitely not in the corpus. true: it probably is.
+    bool mayContain(quint64 key60) const;
+
+private:
+    void setError(const QString &error);
+
+    QFile file_;
+    const uchar *base_ = nullptr;
+    quint32 shardBits_ = 0;
+    quint64 keyCount_ = 0;
+    quint64 corpusRecords_ = 0;
+    QString lastError_;
+};
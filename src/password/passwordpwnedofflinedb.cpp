@@ -0,0 +1,157 @@
+#include "passwordpwnedofflinedb.h"
+
+#include "core/apppaths.h"
+
+#include <QDir>
+#include <QFile>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'B', 'X', 'P', 'W', 'N', 'E', 'D'};
+constexpr quint32 kBuckets = 1u << PasswordPwnedOfflineDb::kPrefixBits;
+
+quint64 readKey40(const uchar *p)
+{
+    return (quint64(p[0]) << 32) | (quint64(p[1]) << 24) | (quint64(p[2]) << 16) | (quint64(p[3]) << 8) | quint64(p[4]);
+}
+
+} // namespace
+
+PasswordPwnedOfflineDb::~PasswordPwnedOfflineDb()
+{
+    close();
+}
+
+QString PasswordPwnedOfflineDb::defaultPath()
+{
+    return QDir(AppPaths::appDataDir()).filePath("pwned-offline.bin");
+}
+
+bool PasswordPwnedOfflineDb::open(const QString &path)
+{
+    close();
+    lastError_.clear();
+
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadOnly)) {
+        setError(QString("打开离线泄露库失败：%1").arg(file_.errorString()));
+        return false;
+    }
+
+    const auto size = file_.size();
+    const auto tableBytes = qint64(kBuckets + 1) * 4;
+    if (size < kHeaderSize + tableBytes) {
+        setError("离线泄露库文件不完整");
+        file_.close();
+        return false;
+    }
+
+    auto *base = file_.map(0, size);
+    if (!base) {
+        setError(QString("映射离线泄露库失败：%1").arg(file_.errorString()));
+        file_.close();
+        return false;
+    }
+
+    const auto format = qFromLittleEndian<quint32>(base + 8);
+    const auto prefixBits = qFromLittleEndian<quint32>(base + 12);
+    const auto recordSize = qFromLittleEndian<quint32>(base + 16);
+    const auto records = qFromLittleEndian<quint64>(base + 24);
+    if (std::memcmp(base, kMagic, sizeof(kMagic)) != 0 || format != kFormat || prefixBits != kPrefixBits
+        || recordSize != kRecordSize) {
+        setError("离线泄露库格式不受支持");
+        file_.unmap(base);
+        file_.close();
+        return false;
+    }
+    if (size != kHeaderSize + tableBytes + qint64(records) * kRecordSize
+        || qFromLittleEndian<quint32>(base + kHeaderSize + qint64(kBuckets) * 4) != records) {
+        setError("离线泄露库文件不完整");
+        file_.unmap(base);
+        file_.close();
+        return false;
+    }
+
+    offsets_ = base + kHeaderSize;
+    records_ = offsets_ + tableBytes;
+    recordCount_ = records;
+
+    // The filter is optional; one left over from an earlier corpus would answer wrongly, so it must match.
+    const auto filterPath = PasswordPwnedFilter::pathForCorpus(path);
+    if (QFile::exists(filterPath) && filter_.open(filterPath) && filter_.corpusRecords() != records)
+        filter_.close();
+    return true;
+}
+
+void PasswordPwnedOfflineDb::close()
+{
+    filter_.close();
+    if (offsets_)
+        file_.unmap(const_cast<uchar *>(offsets_ - kHeaderSize));
+    offsets_ = nullptr;
+    records_ = nullptr;
+    recordCount_ = 0;
+    if (file_.isOpen())
+        file_.close();
+}
+
+std::optional<quint64> PasswordPwnedOfflineDb::hashKey(const QByteArray &sha1)
+{
+    const auto raw = sha1.size() == 40 ? QByteArray::fromHex(sha1) : sha1;
+    if (raw.size() != 20)
+        return std::nullopt;
+    const auto top = qFromBigEndian<quint64>(raw.constData());
+    return top >> 4;
+}
+
+std::optional<qint64> PasswordPwnedOfflineDb::lookup(const QByteArray &sha1) const
+{
+    if (!isOpen())
+        return std::nullopt;
+
+    const auto key60 = hashKey(sha1);
+    if (!key60.has_value())
+        return std::nullopt;
+    if (filter_.isOpen() && !filter_.mayContain(key60.value()))
+        return 0;
+
+    // Bits 0..19 pick the bucket, bits 20..59 are the stored key.
+    const auto bucket = static_cast<quint32>(key60.value() >> 40);
+    const auto key = key60.value() & 0xFFFFFFFFFFull;
+
+    auto lo = qFromLittleEndian<quint32>(offsets_ + qint64(bucket) * 4);
+    auto hi = qFromLittleEndian<quint32>(offsets_ + qint64(bucket + 1) * 4);
+    while (lo < hi) {
+        const auto mid = lo + (hi - lo) / 2;
+        const auto *record = records_ + qint64(mid) * kRecordSize;
+        const auto candidate = readKey40(record);
+        if (candidate == key)
+            return qint64((quint32(record[5]) << 16) | (quint32(record[6]) << 8) | quint32(record[7]));
+        if (candidate < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
+
+void PasswordPwnedOfflineDb::collectKeys(quint32 firstBucket, quint32 endBucket, std::vector<quint64> &out) const
+{
+    if (!isOpen())
+        return;
+    endBucket = qMin(endBucket, kBuckets);
+    for (auto bucket = firstBucket; bucket < endBucket; ++bucket) {
+        const auto begin = qFromLittleEndian<quint32>(offsets_ + qint64(bucket) * 4);
+        const auto end = qFromLittleEndian<quint32>(offsets_ + qint64(bucket + 1) * 4);
+        for (auto i = begin; i < end; ++i)
+            out.push_back((quint64(bucket) << 40) | readKey40(records_ + qint64(i) * kRecordSize));
+    }
+}
+
+void PasswordPwnedOfflineDb::setError(const QString &error)
+{
+    lastError_ = error;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "passwordpwnedfilter.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <optional>
+#include <vector>
+
+// Read side of the offline breach corpus written by PasswordPwnedOfflineImporter. Layout (integers little-endian
+// unless noted):
+//   header   magic "TBXPWNED", u32 format, u32 prefix bits (20), u32 record size (8), u32 reserved, u64 records
+//   offsets  2^20 + 1 u32: records of prefix p are [offsets[p], offsets[p + 1])
+//   records  sorted; 5-byte big-endian SHA-1 bits 20..59, then a 3-byte big-endian count (saturated)
+// The file is memory-mapped and searched in place, so opening it costs nothing and a lookup touches one bucket.
+// A 60-bit truncated hash collides with a different password about once in 10^9 lookups on the full corpus.
+// When the PasswordPwnedFilter built for the corpus sits next to it, misses are answered by the filter alone.
+class PasswordPwnedOfflineDb final
+{
+public:
+    static constexpr quint32 kFormat = 1;
+    static constexpr int kPrefixBits = 20;
+    static constexpr int kRecordSize = 8;
+    static constexpr int kHeaderSize = 32;
+    static constexpr qint64 kMaxCount = 0xFFFFFF;
+
+    PasswordPwnedOfflineDb() = default;
+    ~PasswordPwnedOfflineDb();
+    PasswordPwnedOfflineDb(const PasswordPwnedOfflineDb &) = delete;
+    PasswordPwnedOfflineDb &operator=(const PasswordPwnedOfflineDb &) = delete;
+
+    // Where the password manager looks for the corpus by default.
+    static QString defaultPath();
+    // The first 60 bits of a SHA-1 digest (20 raw bytes or 40 hex characters), as stored in the corpus.
+    static std::optional<quint64> hashKey(const QByteArray &sha1);
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return records_ != nullptr; }
+    QString lastError() const { return lastError_; }
+
+    quint64 recordCount() const { return recordCount_; }
+    bool hasFilter() const { return filter_.isOpen(); }
+    // Breach count for a SHA-1 digest (20 raw bytes or 40 hex characters); 0 when the corpus does not list it.
+    // nullopt when the database is not open or the digest is malformed.
+    std::optional<qint64> lookup(const QByteArray &sha1) const;
+    // Appends the 60-bit keys of buckets [firstBucket, endBucket) in ascending order.
+    void collectKeys(quint32 firstBucket, quint32 endBucket, std::vector<quint64> &out) const;
+
+private:
+    void setError(const QString &error);
+
+    QFile file_;
+    const uchar *offsets_ = nullptr;
+    const uchar *records_ = nullptr;
+    quint64 recordCount_ = 0;
+    PasswordPwnedFilter filter_;
+    QString lastError_;
+};
@@ -0,0 +1,221 @@
+#include "passwordpwnedofflineimporter.h"
+
+#include "passwordpwnedfilter.h"
+#include "passwordpwnedofflinedb.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QSaveFile>
+#include <QVector>
+#include <QtEndian>
+
+#include <cstring>
+#include <utility>
+
+namespace {
+
+constexpr quint32 kBuckets = 1u << PasswordPwnedOfflineDb::kPrefixBits;
+constexpr int kMaxLineBytes = 256;
+constexpr int kWriteBufferRecords = 64 * 1024;
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+// The first 60 bits of a 40-character hex digest; false if the line does not start with one.
+bool parseHash60(const char *line, qint64 length, quint64 &out)
+{
+    if (length < 40)
+        return false;
+    quint64 value = 0;
+    for (int i = 0; i < 15; ++i) {
+        const auto v = hexValue(line[i]);
+        if (v < 0)
+            return false;
+        value = (value << 4) | quint64(v);
+    }
+    for (int i = 15; i < 40; ++i) {
+        if (hexValue(line[i]) < 0)
+            return false;
+    }
+    out = value;
+    return true;
+}
+
+} // namespace
+
+PasswordPwnedOfflineImporter::PasswordPwnedOfflineImporter(QString dumpPath, QString outputPath, QObject *parent)
+    : QObject(parent), dumpPath_(std::move(dumpPath)), outputPath_(std::move(outputPath))
+{
+}
+
+void PasswordPwnedOfflineImporter::requestCancel()
+{
+    cancelRequested_.store(true);
+}
+
+void PasswordPwnedOfflineImporter::run()
+{
+    QFile in(dumpPath_);
+    if (!in.open(QIODevice::ReadOnly)) {
+        emit failed(QString("无法读取泄露库文件：%1").arg(in.errorString()));
+        return;
+    }
+    progress_->setValue(0);
+    progress_->setRange(0, in.size() / 1024);
+
+    QSaveFile out(outputPath_);
+    if (!out.open(QIODevice::WriteOnly)) {
+        emit failed(QString("无法写入离线泄露库：%1").arg(out.errorString()));
+        return;
+    }
+
+    // Header and offset table are rewritten at the end, once the counts are known.
+    QByteArray header(PasswordPwnedOfflineDb::kHeaderSize, '\0');
+    QVector<quint32> offsets(kBuckets + 1, 0);
+    QByteArray table(static_cast<int>(offsets.size()) * 4, '\0');
+    if (out.write(header) != header.size() || out.write(table) != table.size()) {
+        out.cancelWriting();
+        emit failed(QString("写入离线泄露库失败：%1").arg(out.errorString()));
+        return;
+    }
+
+    QByteArray buffer;
+    buffer.reserve(kWriteBufferRecords * PasswordPwnedOfflineDb::kRecordSize);
+    quint64 records = 0;
+    quint64 pendingKey = 0;
+    qint64 pendingCount = -1; // -1: nothing pending
+    quint32 bucket = 0;
+    qint64 lineNo = 0;
+    char line[kMaxLineBytes];
+
+    const auto flushBuffer = [&out, &buffer]() {
+        const auto ok = out.write(buffer) == buffer.size();
+        buffer.clear();
+        return ok;
+    };
+
+    // Dump hashes are unique, but truncating to 60 bits can merge neighbours; their counts are added up.
+    const auto emitPending = [&]() {
+        if (pendingCount < 0)
+            return true;
+        const auto pendingBucket = static_cast<quint32>(pendingKey >> 40);
+        while (bucket < pendingBucket)
+            offsets[static_cast<int>(++bucket)] = static_cast<quint32>(records);
+        uchar record[PasswordPwnedOfflineDb::kRecordSize];
+        for (int i = 0; i < 5; ++i)
+            record[i] = static_cast<uchar>(pendingKey >> (8 * (4 - i)));
+        const auto count = static_cast<quint32>(qMin(pendingCount, PasswordPwnedOfflineDb::kMaxCount));
+        record[5] = static_cast<uchar>(count >> 16);
+        record[6] = static_cast<uchar>(count >> 8);
+        record[7] = static_cast<uchar>(count);
+        buffer.append(reinterpret_cast<const char *>(record), sizeof(record));
+        ++records;
+        if (buffer.size() >= kWriteBufferRecords * PasswordPwnedOfflineDb::kRecordSize)
+            return flushBuffer();
+        return true;
+    };
+
+    QString error;
+    for (;;) {
+        const auto length = in.readLine(line, sizeof(line));
+        if (length <= 0)
+            break;
+        ++lineNo;
+        if ((lineNo & 0xFFFF) == 0) {
+            if (cancelRequested_.load()) {
+                error = "已取消导入";
+                break;
+            }
+            progress_->setValue(in.pos() / 1024);
+        }
+
+        qint64 trimmed = length;
+        while (trimmed > 0 && (line[trimmed - 1] == '\n' || line[trimmed - 1] == '\r' || line[trimmed - 1] == ' '))
+            --trimmed;
+        if (trimmed == 0)
+            continue;
+
+        quint64 key = 0;
+        if (trimmed < 42 || line[40] != ':' || !parseHash60(line, trimmed, key)) {
+            error = QString("第 %1 行格式无效（应为 SHA1:次数）").arg(lineNo);
+            break;
+        }
+        bool ok = false;
+        const auto count = QByteArray::fromRawData(line + 41, static_cast<int>(trimmed - 41)).toLongLong(&ok);
+        if (!ok || count < 0) {
+            error = QString("第 %1 行次数无效").arg(lineNo);
+            break;
+        }
+
+        if (pendingCount >= 0 && key == pendingKey) {
+            pendingCount += count;
+            continue;
+        }
+        if (pendingCount >= 0 && key < pendingKey) {
+            error = QString("第 %1 行未按哈希排序，请使用按哈希排序（ordered by hash）的版本").arg(lineNo);
+            break;
+        }
+        if (!emitPending() || records >= 0xFFFFFFFFull) {
+            error = QString("写入离线泄露库失败：%1").arg(out.errorString());
+            break;
+        }
+        pendingKey = key;
+        pendingCount = count;
+    }
+
+    if (error.isEmpty() && in.error() != QFileDevice::NoError)
+        error = QString("读取泄露库文件失败：%1").arg(in.errorString());
+    if (error.isEmpty() && (!emitPending() || !flushBuffer()))
+        error = QString("写入离线泄露库失败：%1").arg(out.errorString());
+    if (error.isEmpty() && records == 0)
+        error = "泄露库文件中没有任何记录";
+    if (!error.isEmpty()) {
+        out.cancelWriting();
+        emit failed(error);
+        return;
+    }
+
+    while (bucket < kBuckets)
+        offsets[static_cast<int>(++bucket)] = static_cast<quint32>(records);
+
+    auto *h = reinterpret_cast<uchar *>(header.data());
+    memcpy(h, "TBXPWNED", 8);
+    qToLittleEndian<quint32>(PasswordPwnedOfflineDb::kFormat, h + 8);
+    qToLittleEndian<quint32>(PasswordPwnedOfflineDb::kPrefixBits, h + 12);
+    qToLittleEndian<quint32>(PasswordPwnedOfflineDb::kRecordSize, h + 16);
+    qToLittleEndian<quint64>(records, h + 24);
+    auto *t = reinterpret_cast<uchar *>(table.data());
+    for (int i = 0; i < offsets.size(); ++i)
+        qToLittleEndian<quint32>(offsets.at(i), t + qint64(i) * 4);
+
+    // A filter from the previous corpus must not outlive it, even if building the new one fails below.
+    const auto filterPath = PasswordPwnedFilter::pathForCorpus(outputPath_);
+    QFile::remove(filterPath);
+    if (!out.seek(0) || out.write(header) != header.size() || out.write(table) != table.size() || !out.commit()) {
+        out.cancelWriting();
+        emit failed(QString("写入离线泄露库失败：%1").arg(out.errorString()));
+        return;
+    }
+    progress_->setValue(in.size() / 1024);
+
+    PasswordPwnedOfflineDb corpus;
+    if (!corpus.open(outputPath_)) {
+        emit failed(corpus.lastError());
+        return;
+    }
+    PasswordPwnedFilter filter;
+    if (!filter.build(corpus, filterPath, cancelRequested_, *progress_)) {
+        emit failed(filter.lastError());
+        return;
+    }
+
+    emit finished(static_cast<qint64>(records));
+}
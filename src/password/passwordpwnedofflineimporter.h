@@ -0,0 +1,38 @@
+#pragma once
+
+#include "core/progresschannel.h"
+
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+
+// Converts the Pwned Passwords "SHA-1, ordered by hash" text dump ("HASH:COUNT" per line, sorted by hash) into
+// the binary corpus read by PasswordPwnedOfflineDb, then builds the PasswordPwnedFilter next to it. The dump is
+// streamed once and never held in memory; the output only replaces `outputPath` once it is complete.
+class PasswordPwnedOfflineImporter final : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PasswordPwnedOfflineImporter(QString dumpPath, QString outputPath, QObject *parent = nullptr);
+
+    void requestCancel();
+    // KiB of the dump consumed (the full dump is tens of GB, more than the sampler's int range in bytes), then
+    // filter shards built.
+    std::shared_ptr<const ProgressChannel> progress() const { return progress_; }
+
+signals:
+    void finished(qint64 records);
+    void failed(const QString &error);
+
+public slots:
+    void run();
+
+private:
+    QString dumpPath_;
+    QString outputPath_;
+    std::atomic_bool cancelRequested_{false};
+    const std::shared_ptr<ProgressChannel> progress_ = std::make_shared<ProgressChannel>();
+};
@@ -0,0 +1,222 @@
+#include "passwordpwnedrangeblob.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[2] = {'P', 'R'};
+constexpr uchar kFormat = 1;
+constexpr int kHeaderSize = 8;
+constexpr int kSuffixNibbles = 35;
+
+using Suffix = std::array<uchar, kSuffixNibbles>;
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool parseSuffix(const char *p, qint64 length, Suffix &out)
+{
+    if (length != kSuffixNibbles)
+        return false;
+    for (int i = 0; i < kSuffixNibbles; ++i) {
+        const auto v = hexValue(p[i]);
+        if (v < 0)
+            return false;
+        out[static_cast<size_t>(i)] = static_cast<uchar>(v);
+    }
+    return true;
+}
+
+// Calls `visit(suffix, count)` for every well-formed "SUFFIX:COUNT" line; returns early when it returns false.
+template<typename Visit>
+void forEachTextLine(const QByteArray &body, Visit visit)
+{
+    const auto *data = body.constData();
+    const auto size = static_cast<qint64>(body.size());
+    qint64 pos = 0;
+    while (pos < size) {
+        const auto *newline = static_cast<const char *>(std::memchr(data + pos, '\n', static_cast<size_t>(size - pos)));
+        const auto end = newline ? newline - data : size;
+        auto begin = pos;
+        auto stop = end;
+        pos = end + 1;
+        while (begin < stop && isBlank(data[begin]))
+            ++begin;
+        while (stop > begin && isBlank(data[stop - 1]))
+            --stop;
+        const auto *colon = static_cast<const char *>(std::memchr(data + begin, ':', static_cast<size_t>(stop - begin)));
+        if (!colon)
+            continue;
+        auto suffixEnd = colon - data;
+        while (suffixEnd > begin && isBlank(data[suffixEnd - 1]))
+            --suffixEnd;
+        Suffix suffix;
+        if (!parseSuffix(data + begin, suffixEnd - begin, suffix))
+            continue;
+        bool ok = false;
+        const auto countStart = colon - data + 1;
+        const auto count =
+            QByteArray::fromRawData(data + countStart, static_cast<int>(stop - countStart)).trimmed().toLongLong(&ok);
+        if (!ok)
+            continue;
+        if (!visit(suffix, count))
+            return;
+    }
+}
+
+int nibbleAt(const uchar *packed, qint64 n)
+{
+    const auto b = packed[n >> 1];
+    return (n & 1) ? (b & 0x0F) : (b >> 4);
+}
+
+int compareSuffix(const uchar *packed, quint32 record, const Suffix &target)
+{
+    const auto base = qint64(record) * kSuffixNibbles;
+    for (int i = 0; i < kSuffixNibbles; ++i) {
+        const auto diff = nibbleAt(packed, base + i) - target[static_cast<size_t>(i)];
+        if (diff != 0)
+            return diff;
+    }
+    return 0;
+}
+
+qint64 packedSuffixBytes(quint32 records)
+{
+    return (qint64(records) * kSuffixNibbles + 1) / 2;
+}
+
+} // namespace
+
+namespace PasswordPwnedRangeBlob {
+
+QByteArray encode(const QByteArray &textBody)
+{
+    std::vector<std::pair<Suffix, quint64>> entries;
+    entries.reserve(static_cast<size_t>(textBody.size() / 40));
+    forEachTextLine(textBody, [&entries](const Suffix &suffix, qint64 count) {
+        if (count > 0)
+            entries.emplace_back(suffix, static_cast<quint64>(count));
+        return true;
+    });
+
+    // The service answers sorted already; sorting again only guards the binary search. On a repeated
+    // suffix the later line wins.
+    std::stable_sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    std::vector<std::pair<Suffix, quint64>> unique;
+    unique.reserve(entries.size());
+    for (const auto &entry : entries) {
+        if (!unique.empty() && unique.back().first == entry.first)
+            unique.back().second = entry.second;
+        else
+            unique.push_back(entry);
+    }
+
+    quint64 maxCount = 0;
+    for (const auto &entry : unique)
+        maxCount = qMax(maxCount, entry.second);
+    int width = 1;
+    while (width < 8 && (maxCount >> (8 * width)) != 0)
+        ++width;
+
+    const auto records = static_cast<quint32>(unique.size());
+    const auto suffixBytes = packedSuffixBytes(records);
+    QByteArray out(static_cast<int>(kHeaderSize + suffixBytes + qint64(records) * width), '\0');
+    auto *p = reinterpret_cast<uchar *>(out.data());
+    p[0] = static_cast<uchar>(kMagic[0]);
+    p[1] = static_cast<uchar>(kMagic[1]);
+    p[2] = kFormat;
+    p[3] = static_cast<uchar>(width);
+    qToLittleEndian<quint32>(records, p + 4);
+
+    auto *suffixes = p + kHeaderSize;
+    auto *counts = suffixes + suffixBytes;
+    for (quint32 r = 0; r < records; ++r) {
+        const auto &entry = unique[r];
+        const auto base = qint64(r) * kSuffixNibbles;
+        for (int i = 0; i < kSuffixNibbles; ++i) {
+            const auto n = base + i;
+            const auto v = entry.first[static_cast<size_t>(i)];
+            suffixes[n >> 1] |= (n & 1) ? v : static_cast<uchar>(v << 4);
+        }
+        for (int b = 0; b < width; ++b)
+            counts[qint64(r) * width + b] = static_cast<uchar>(entry.second >> (8 * (width - 1 - b)));
+    }
+    return out;
+}
+
+bool isEncoded(const QByteArray &stored)
+{
+    if (stored.size() < kHeaderSize || stored.at(0) != kMagic[0] || stored.at(1) != kMagic[1]
+        || static_cast<uchar>(stored.at(2)) != kFormat)
+        return false;
+    const auto *p = reinterpret_cast<const uchar *>(stored.constData());
+    const int width = p[3];
+    const auto records = qFromLittleEndian<quint32>(p + 4);
+    return width >= 1 && width <= 8
+           && stored.size() == kHeaderSize + packedSuffixBytes(records) + qint64(records) * width;
+}
+
+qint64 count(const QByteArray &stored, const QByteArray &suffixHex)
+{
+    Suffix target;
+    if (!parseSuffix(suffixHex.constData(), suffixHex.size(), target))
+        return 0;
+
+    if (!isEncoded(stored)) {
+        qint64 found = 0;
+        forEachTextLine(stored, [&target, &found](const Suffix &suffix, qint64 listed) {
+            if (suffix != target)
+                return true;
+            found = listed;
+            return false;
+        });
+        return found;
+    }
+
+    const auto *p = reinterpret_cast<const uchar *>(stored.constData());
+    const int width = p[3];
+    const auto records = qFromLittleEndian<quint32>(p + 4);
+    const auto *suffixes = p + kHeaderSize;
+    const auto *counts = suffixes + packedSuffixBytes(records);
+
+    quint32 lo = 0;
+    quint32 hi = records;
+    while (lo < hi) {
+        const auto mid = lo + (hi - lo) / 2;
+        const auto cmp = compareSuffix(suffixes, mid, target);
+        if (cmp == 0) {
+            quint64 value = 0;
+            for (int b = 0; b < width; ++b)
+                value = (value << 8) | counts[qint64(mid) * width + b];
+            return static_cast<qint64>(qMin<quint64>(value, quint64(std::numeric_limits<qint64>::max())));
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
+
+} // namespace PasswordPwnedRangeBlob
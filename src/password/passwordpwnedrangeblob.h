@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QByteArray>
+
+// Storage form of a Pwned Passwords range in pwned_prefix_cache. The text response ("SUFFIX:COUNT" lines, plus
+// count-0 padding) is packed once when it arrives:
+//   header   "PR", u8 format, u8 count width in bytes, u32 records (little-endian)
+//   suffixes 35-nibble (17.5-byte) suffixes, sorted, packed back to back
+//   counts   one big-endian integer of `count width` bytes per record, in suffix order
+// Padding lines are dropped, since an absent suffix already means a count of 0. Lookups binary search the
+// blob in place; bodies cached as text before this format still answer through a line scan.
+namespace PasswordPwnedRangeBlob {
+
+QByteArray encode(const QByteArray &textBody);
+bool isEncoded(const QByteArray &stored);
+// Breach count of the 35-character hex suffix (any case) in a stored range; 0 when it is not listed.
+qint64 count(const QByteArray &stored, const QByteArray &suffixHex);
+
+} // namespace PasswordPwnedRangeBlob
@@ -0,0 +1,171 @@
+#include "passwordpwnedrangefetcher.h"
+
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QTimer>
+
+#include <utility>
+
+namespace {
+
+constexpr qsizetype kMaxRangeBodyBytes = 2 * 1024 * 1024;
+constexpr int kMaxBackoffMs = 30000;
+
+bool isTransient(QNetworkReply::NetworkError error, int status)
+{
+    if (status == 429 || (status >= 500 && status < 600))
+        return true;
+    switch (error) {
+    case QNetworkReply::OperationCanceledError: // our own timeout
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+PasswordPwnedRangeFetcher::PasswordPwnedRangeFetcher(QUrl baseUrl, QObject *parent)
+    : QObject(parent), baseUrl_(std::move(baseUrl))
+{
+    qRegisterMetaType<PasswordPwnedRange>();
+}
+
+PasswordPwnedRangeFetcher::~PasswordPwnedRangeFetcher()
+{
+    abort();
+}
+
+void PasswordPwnedRangeFetcher::enqueue(const QByteArray &prefix, const QByteArray &etag, const QByteArray &lastModified)
+{
+    queue_.enqueue(Job{prefix, etag, lastModified, 0});
+    pump();
+}
+
+void PasswordPwnedRangeFetcher::abort()
+{
+    ++generation_;
+    queue_.clear();
+    waiting_ = 0;
+    const auto replies = inFlight_.keys();
+    inFlight_.clear();
+    for (auto *reply : replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void PasswordPwnedRangeFetcher::pump()
+{
+    while (inFlight_.size() < maxInFlight_ && !queue_.isEmpty())
+        start(queue_.dequeue());
+}
+
+void PasswordPwnedRangeFetcher::start(const Job &job)
+{
+    QNetworkRequest req(baseUrl_.resolved(QUrl(QString::fromLatin1(job.prefix))));
+    req.setHeader(QNetworkRequest::UserAgentHeader, "ToolboxPassword/1.0");
+    req.setRawHeader("Add-Padding", "true");
+    req.setRawHeader("Accept", "text/plain");
+    req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    if (!job.etag.isEmpty())
+        req.setRawHeader("If-None-Match", job.etag);
+    if (!job.lastModified.isEmpty())
+        req.setRawHeader("If-Modified-Since", job.lastModified);
+
+    auto *reply = net_.get(req);
+    inFlight_.insert(reply, job);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() { handleReply(reply); });
+
+    if (timeoutMs_ > 0) {
+        // Parented to the reply, so it goes away with it; an abort surfaces as OperationCanceledError.
+        auto *timer = new QTimer(reply);
+        timer->setSingleShot(true);
+        connect(timer, &QTimer::timeout, reply, &QNetworkReply::abort);
+        timer->start(timeoutMs_);
+    }
+}
+
+void PasswordPwnedRangeFetcher::handleReply(QNetworkReply *reply)
+{
+    reply->deleteLater();
+    const auto it = inFlight_.find(reply);
+    if (it == inFlight_.end())
+        return;
+    auto job = it.value();
+    inFlight_.erase(it);
+
+    const auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const auto error = reply->error();
+
+    if (error == QNetworkReply::NoError && status == 304 && (!job.etag.isEmpty() || !job.lastModified.isEmpty())) {
+        PasswordPwnedRange range;
+        range.prefix = job.prefix;
+        range.notModified = true;
+        emit rangeReady(range);
+        finishJob();
+        return;
+    }
+
+    const auto ok = error == QNetworkReply::NoError && status >= 200 && status < 300;
+    if (!ok) {
+        if (isTransient(error, status) && job.attempt + 1 < maxAttempts_) {
+            retryLater(std::move(job), reply->rawHeader("Retry-After").toInt());
+            pump();
+            return;
+        }
+        const auto reason = error == QNetworkReply::OperationCanceledError ? QString("泄露检查超时") : reply->errorString();
+        emit rangeFailed(job.prefix, QString("泄露检查失败：%1").arg(reason));
+        finishJob();
+        return;
+    }
+
+    PasswordPwnedRange range;
+    range.prefix = job.prefix;
+    range.body = reply->readAll();
+    range.etag = reply->rawHeader("ETag");
+    range.lastModified = reply->rawHeader("Last-Modified");
+    if (range.body.isEmpty())
+        emit rangeFailed(job.prefix, "泄露检查响应为空");
+    else if (range.body.size() > kMaxRangeBodyBytes)
+        emit rangeFailed(job.prefix, "泄露检查响应过大");
+    else
+        emit rangeReady(range);
+    finishJob();
+}
+
+void PasswordPwnedRangeFetcher::retryLater(Job job, int retryAfterSecs)
+{
+    ++job.attempt;
+    // Half the window plus jitter, so a burst of throttled requests does not come back in lockstep.
+    const auto ceiling = qMin(kMaxBackoffMs, initialBackoffMs_ << qMin(job.attempt - 1, 16));
+    auto delayMs = ceiling > 0 ? ceiling / 2 + QRandomGenerator::global()->bounded(ceiling / 2 + 1) : 0;
+    if (retryAfterSecs > 0)
+        delayMs = qMin(kMaxBackoffMs, retryAfterSecs * 1000);
+
+    ++waiting_;
+    const auto generation = generation_;
+    QTimer::singleShot(delayMs, this, [this, job, generation]() {
+        if (generation != generation_)
+            return;
+        --waiting_;
+        queue_.prepend(job);
+        pump();
+    });
+}
+
+void PasswordPwnedRangeFetcher::finishJob()
+{
+    pump();
+    if (isIdle())
+        emit idle();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMetaType>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QUrl>
+
+class QNetworkReply;
+
+struct PasswordPwnedRange final
+{
+    QByteArray prefix;
+    bool notModified = false; // 304 on a conditional request; body and validators are empty
+    QByteArray body;
+    QByteArray etag;
+    QByteArray lastModified;
+};
+
+Q_DECLARE_METATYPE(PasswordPwnedRange)
+
+// Fetches k-anonymity ranges (`baseUrl` + 5-character prefix) asynchronously, keeping up to maxInFlight requests
+// open on one QNetworkAccessManager: multiplexed over HTTP/2 where the server offers it, over kept-alive
+// connections otherwise. Timeouts, 429, 5xx and dropped connections are retried with exponential backoff
+// (Retry-After wins when the server sends one); anything else fails the prefix right away.
+// Results are signalled on the thread that owns the fetcher, as each range completes.
+class PasswordPwnedRangeFetcher final : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PasswordPwnedRangeFetcher(QUrl baseUrl, QObject *parent = nullptr);
+    ~PasswordPwnedRangeFetcher() override;
+
+    void setMaxInFlight(int requests) { maxInFlight_ = qMax(1, requests); }
+    void setMaxAttempts(int attempts) { maxAttempts_ = qMax(1, attempts); }
+    void setTimeoutMs(int ms) { timeoutMs_ = ms; }
+    // Delay before the first retry; doubled for every further attempt.
+    void setInitialBackoffMs(int ms) { initialBackoffMs_ = ms; }
+
+    // `etag` / `lastModified` are the validators of a cached copy, sent so the server can answer 304.
+    void enqueue(const QByteArray &prefix, const QByteArray &etag = {}, const QByteArray &lastModified = {});
+    // Drops everything queued and aborts what is in flight; no further signals are emitted for them.
+    void abort();
+    bool isIdle() const { return queue_.isEmpty() && inFlight_.isEmpty() && waiting_ == 0; }
+
+signals:
+    void rangeReady(const PasswordPwnedRange &range);
+    void rangeFailed(const QByteArray &prefix, const QString &error);
+    // Nothing queued, waiting for a retry or in flight any more.
+    void idle();
+
+private:
+    struct Job final
+    {
+        QByteArray prefix;
+        QByteArray etag;
+        QByteArray lastModified;
+        int attempt = 0;
+    };
+
+    void pump();
+    void start(const Job &job);
+    void handleReply(QNetworkReply *reply);
+    void retryLater(Job job, int retryAfterSecs);
+    void finishJob();
+
+    QNetworkAccessManager net_;
+    QUrl baseUrl_;
+    int maxInFlight_ = 8;
+    int maxAttempts_ = 4;
+    int timeoutMs_ = 8000;
+    int initialBackoffMs_ = 500;
+    QQueue<Job> queue_;
+    QHash<QNetworkReply *, Job> inFlight_;
+    int waiting_ = 0;     // jobs sleeping before a retry
+    quint64 generation_ = 0; // bumped by abort() so sleeping retries know they were dropped
+};
@@ -3,12 +3,15 @@
 #include "core/crypto.h"
 #include "passworddatabase.h"
 #include "passwordvault.h"
+#include "passwordvaulteventbus.h"
 
 #include <QDateTime>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QSet>
 
+#include <utility>
+
 namespace {
 
 bool isVaultAvailable(PasswordVault *vault)
@@ -44,8 +47,31 @@ QStringList normalizeTags(const QStringList &tags)
     return out;
 }
 
-bool replaceEntryTags(QSqlDatabase &database, qint64 entryId, const QStringList &tags, QString &errorOut)
+// `changedOut` is false when the entry already had exactly these tags; nothing is rewritten then.
+bool replaceEntryTags(QSqlDatabase &database, qint64 entryId, const QStringList &tags, bool &changedOut, QString &errorOut)
 {
+    changedOut = false;
+
+    QSqlQuery current(database);
+    current.prepare(R"sql(
+        SELECT t.name
+        FROM entry_tags et
+        JOIN tags t ON t.id = et.tag_id
+        WHERE et.entry_id = ?
+    )sql");
+    current.addBindValue(entryId);
+    if (!current.exec()) {
+        errorOut = QString("读取标签关联失败：%1").arg(current.lastError().text());
+        return false;
+    }
+
+    QSet<QString> existing;
+    while (current.next())
+        existing.insert(current.value(0).toString());
+    if (existing == QSet<QString>(tags.cbegin(), tags.cend()))
+        return true;
+    changedOut = true;
+
     QSqlQuery del(database);
     del.prepare(R"sql(
         DELETE FROM entry_tags WHERE entry_id = ?
@@ -107,10 +133,37 @@ bool replaceEntryTags(QSqlDatabase &database, qint64 entryId, const QStringList
     return true;
 }
 
+std::optional<qint64> entryGroupId(QSqlDatabase &database, qint64 entryId)
+{
+    QSqlQuery query(database);
+    query.prepare(R"sql(
+        SELECT group_id FROM password_entries WHERE id = ?
+    )sql");
+    query.addBindValue(entryId);
+    if (!query.exec() || !query.next())
+        return std::nullopt;
+    return query.value(0).toLongLong();
+}
+
 } // namespace
 
 PasswordRepository::PasswordRepository(PasswordVault *vault) : vault_(vault) {}
 
+void PasswordRepository::setEntryCountListener(EntryCountListener listener)
+{
+    entryCountListener_ = std::move(listener);
+}
+
+void PasswordRepository::notifyEntryMoved(qint64 fromGroupId, qint64 toGroupId) const
+{
+    if (!entryCountListener_ || fromGroupId == toGroupId)
+        return;
+    if (fromGroupId > 0)
+        entryCountListener_(fromGroupId, -1);
+    if (toGroupId > 0)
+        entryCountListener_(toGroupId, +1);
+}
+
 QString PasswordRepository::lastError() const
 {
     return lastError_;
@@ -123,24 +176,63 @@ void PasswordRepository::setError(const QString &error) const
 
 QVector<PasswordEntry> PasswordRepository::listEntries() const
 {
+    const auto current = snapshot();
+    const auto &store = current->entries();
+
     QVector<PasswordEntry> items;
+    items.reserve(store.size());
+    for (int row = 0; row < store.size(); ++row)
+        items.push_back(store.entryAt(row));
+    return items;
+}
+
+std::shared_ptr<const PasswordVaultSnapshot> PasswordRepository::snapshot() const
+{
+    if (!PasswordDatabase::db().isOpen())
+        setError("数据库未打开");
+    return PasswordVaultSnapshot::current();
+}
+
+std::optional<QHash<qint64, PasswordEntry>> PasswordRepository::loadEntries(const QSet<qint64> &entryIds) const
+{
+    QHash<qint64, PasswordEntry> entries;
+    if (entryIds.isEmpty())
+        return entries;
 
     auto database = PasswordDatabase::db();
     if (!database.isOpen()) {
         setError("数据库未打开");
-        return items;
+        return std::nullopt;
     }
 
+    auto placeholders = QString("?, ").repeated(entryIds.size());
+    placeholders.chop(2);
+
     QSqlQuery query(database);
-    query.prepare(R"sql(
-        SELECT id, group_id, entry_type, title, username, url, category, created_at, updated_at
-        FROM password_entries
-        ORDER BY updated_at DESC
-    )sql");
+    query.prepare(QString(R"sql(
+        SELECT
+            e.id,
+            e.group_id,
+            e.entry_type,
+            e.title,
+            e.username,
+            e.url,
+            e.category,
+            e.created_at,
+            e.updated_at,
+            GROUP_CONCAT(t.name, ',') AS tags_csv
+        FROM password_entries e
+        LEFT JOIN entry_tags et ON et.entry_id = e.id
+        LEFT JOIN tags t ON t.id = et.tag_id
+        WHERE e.id IN (%1)
+        GROUP BY e.id
+    )sql").arg(placeholders));
+    for (const auto id : entryIds)
+        query.addBindValue(id);
 
     if (!query.exec()) {
-        setError(QString("查询失败：%1").arg(query.lastError().text()));
-        return items;
+        setError(QString("查询条目失败：%1").arg(query.lastError().text()));
+        return std::nullopt;
     }
 
     while (query.next()) {
@@ -154,10 +246,15 @@ QVector<PasswordEntry> PasswordRepository::listEntries() const
         entry.category = query.value(6).toString();
         entry.createdAt = QDateTime::fromSecsSinceEpoch(query.value(7).toLongLong());
         entry.updatedAt = QDateTime::fromSecsSinceEpoch(query.value(8).toLongLong());
-        items.push_back(entry);
+        const auto tagsCsv = query.value(9).toString();
+        if (!tagsCsv.trimmed().isEmpty()) {
+            for (const auto &tag : tagsCsv.split(',', Qt::SkipEmptyParts))
+                entry.tags.push_back(tag.trimmed());
+        }
+        entries.insert(entry.id, entry);
     }
 
-    return items;
+    return entries;
 }
 
 QStringList PasswordRepository::listCategories() const
@@ -222,6 +319,74 @@ QVector<PasswordGroup> PasswordRepository::listGroups() const
     return groups;
 }
 
+std::optional<QHash<qint64, PasswordGroup>> PasswordRepository::loadGroups(const QSet<qint64> &groupIds) const
+{
+    QHash<qint64, PasswordGroup> groups;
+    if (groupIds.isEmpty())
+        return groups;
+
+    auto database = PasswordDatabase::db();
+    if (!database.isOpen()) {
+        setError("数据库未打开");
+        return std::nullopt;
+    }
+
+    auto placeholders = QString("?, ").repeated(groupIds.size());
+    placeholders.chop(2);
+
+    QSqlQuery query(database);
+    query.prepare(QString(R"sql(
+        SELECT id, parent_id, name
+        FROM groups
+        WHERE id IN (%1)
+    )sql").arg(placeholders));
+    for (const auto id : groupIds)
+        query.addBindValue(id);
+
+    if (!query.exec()) {
+        setError(QString("查询分组失败：%1").arg(query.lastError().text()));
+        return std::nullopt;
+    }
+
+    while (query.next()) {
+        PasswordGroup group;
+        group.id = query.value(0).toLongLong();
+        group.parentId = query.value(1).isNull() ? 0 : query.value(1).toLongLong();
+        group.name = query.value(2).toString();
+        groups.insert(group.id, group);
+    }
+
+    return groups;
+}
+
+QHash<qint64, int> PasswordRepository::entryCountsByGroup() const
+{
+    QHash<qint64, int> counts;
+
+    auto database = PasswordDatabase::db();
+    if (!database.isOpen()) {
+        setError("数据库未打开");
+        return counts;
+    }
+
+    QSqlQuery query(database);
+    query.prepare(R"sql(
+        SELECT group_id, COUNT(1)
+        FROM password_entries
+        GROUP BY group_id
+    )sql");
+
+    if (!query.exec()) {
+        setError(QString("统计分组条目失败：%1").arg(query.lastError().text()));
+        return counts;
+    }
+
+    while (query.next())
+        counts.insert(query.value(0).toLongLong(), query.value(1).toInt());
+
+    return counts;
+}
+
 QStringList PasswordRepository::listAllTags() const
 {
     QStringList tags;
@@ -525,7 +690,9 @@ std::optional<qint64> PasswordRepository::createGroup(qint64 parentId, const QSt
         return std::nullopt;
     }
 
-    return query.lastInsertId().toLongLong();
+    const auto groupId = query.lastInsertId().toLongLong();
+    PasswordVaultEventBus::instance()->publishGroupChanged(groupId);
+    return groupId;
 }
 
 bool PasswordRepository::renameGroup(qint64 groupId, const QString &name)
@@ -567,6 +734,7 @@ bool PasswordRepository::renameGroup(qint64 groupId, const QString &name)
         return false;
     }
 
+    PasswordVaultEventBus::instance()->publishGroupChanged(groupId);
     return true;
 }
 
@@ -622,6 +790,7 @@ bool PasswordRepository::deleteGroup(qint64 groupId)
         return false;
     }
 
+    PasswordVaultEventBus::instance()->publishGroupChanged(groupId);
     return true;
 }
 
@@ -681,8 +850,9 @@ bool PasswordRepository::addEntryWithTimestamps(const PasswordEntrySecrets &secr
     }
 
     const auto entryId = query.lastInsertId().toLongLong();
+    bool tagsChanged = false;
     QString tagsError;
-    if (!replaceEntryTags(database, entryId, normalizeTags(secrets.entry.tags), tagsError)) {
+    if (!replaceEntryTags(database, entryId, normalizeTags(secrets.entry.tags), tagsChanged, tagsError)) {
         database.rollback();
         setError(tagsError);
         return false;
@@ -694,6 +864,12 @@ bool PasswordRepository::addEntryWithTimestamps(const PasswordEntrySecrets &secr
         return false;
     }
 
+    PasswordVaultSnapshot::invalidate();
+    notifyEntryMoved(0, groupId);
+    auto *bus = PasswordVaultEventBus::instance();
+    bus->publishEntryUpserted(entryId);
+    if (tagsChanged)
+        bus->publishEntryRetagged(entryId);
     return true;
 }
 
@@ -715,6 +891,8 @@ bool PasswordRepository::updateEntry(const PasswordEntrySecrets &secrets)
         return false;
     }
 
+    const auto previousGroupId = entryGroupId(database, secrets.entry.id);
+
     if (!database.transaction()) {
         setError(QString("开启事务失败：%1").arg(database.lastError().text()));
         return false;
@@ -750,8 +928,9 @@ bool PasswordRepository::updateEntry(const PasswordEntrySecrets &secrets)
         return false;
     }
 
+    bool tagsChanged = false;
     QString tagsError;
-    if (!replaceEntryTags(database, secrets.entry.id, normalizeTags(secrets.entry.tags), tagsError)) {
+    if (!replaceEntryTags(database, secrets.entry.id, normalizeTags(secrets.entry.tags), tagsChanged, tagsError)) {
         database.rollback();
         setError(tagsError);
         return false;
@@ -763,6 +942,13 @@ bool PasswordRepository::updateEntry(const PasswordEntrySecrets &secrets)
         return false;
     }
 
+    PasswordVaultSnapshot::invalidate();
+    if (previousGroupId)
+        notifyEntryMoved(previousGroupId.value(), groupId);
+    auto *bus = PasswordVaultEventBus::instance();
+    bus->publishEntryUpserted(secrets.entry.id);
+    if (tagsChanged)
+        bus->publishEntryRetagged(secrets.entry.id);
     return true;
 }
 
@@ -784,6 +970,8 @@ bool PasswordRepository::moveEntryToGroup(qint64 entryId, qint64 groupId)
         return false;
     }
 
+    const auto previousGroupId = entryGroupId(database, entryId);
+
     QSqlQuery query(database);
     query.prepare(R"sql(
         UPDATE password_entries
@@ -799,6 +987,10 @@ bool PasswordRepository::moveEntryToGroup(qint64 entryId, qint64 groupId)
         return false;
     }
 
+    PasswordVaultSnapshot::invalidate();
+    if (previousGroupId)
+        notifyEntryMoved(previousGroupId.value(), groupId);
+    PasswordVaultEventBus::instance()->publishEntryUpserted(entryId);
     return true;
 }
 
@@ -810,6 +1002,8 @@ bool PasswordRepository::deleteEntry(qint64 id)
         return false;
     }
 
+    const auto previousGroupId = entryGroupId(database, id);
+
     QSqlQuery query(database);
     query.prepare(R"sql(
         DELETE FROM password_entries WHERE id = ?
@@ -821,6 +1015,10 @@ bool PasswordRepository::deleteEntry(qint64 id)
         return false;
     }
 
+    PasswordVaultSnapshot::invalidate();
+    if (previousGroupId && query.numRowsAffected() > 0)
+        notifyEntryMoved(previousGroupId.value(), 0);
+    PasswordVaultEventBus::instance()->publishEntryRemoved(id);
     return true;
 }
 
@@ -1,27 +1,47 @@
 #pragma once
 
 #include "passwordentry.h"
+#include "passwordvaultsnapshot.h"
 #include "passwordgroup.h"
 
+#include <QHash>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 #include <QVector>
 
+#include <functional>
+#include <memory>
 #include <optional>
 
 class PasswordVault;
 
+// Every committed write is announced on PasswordVaultEventBus.
 class PasswordRepository final
 {
 public:
+    // Called after an entry write commits: +1/-1 for the group that gained/lost an entry. A move reports both.
+    using EntryCountListener = std::function<void(qint64 groupId, int delta)>;
+
     explicit PasswordRepository(PasswordVault *vault);
 
     QString lastError() const;
 
+    void setEntryCountListener(EntryCountListener listener);
+
     QVector<PasswordEntry> listEntries() const;
+    // Shared read-only entry list; the same instance until an entry write commits. Prefer this over
+    // listEntries() on interactive paths.
+    std::shared_ptr<const PasswordVaultSnapshot> snapshot() const;
+    // The listed entries that still exist, without secrets, keyed by id; std::nullopt when the query fails.
+    std::optional<QHash<qint64, PasswordEntry>> loadEntries(const QSet<qint64> &entryIds) const;
     QStringList listCategories() const;
 
     QVector<PasswordGroup> listGroups() const;
+    // The listed groups that still exist, keyed by id; std::nullopt when the query fails.
+    std::optional<QHash<qint64, PasswordGroup>> loadGroups(const QSet<qint64> &groupIds) const;
+    // Direct entry count per group id, one aggregate query; groups without entries are absent.
+    QHash<qint64, int> entryCountsByGroup() const;
     QStringList listAllTags() const;
 
     QVector<PasswordCommonPassword> listCommonPasswords() const;
@@ -44,7 +64,9 @@ public:
 
 private:
     void setError(const QString &error) const;
+    void notifyEntryMoved(qint64 fromGroupId, qint64 toGroupId) const;
 
     PasswordVault *vault_ = nullptr;
+    EntryCountListener entryCountListener_;
     mutable QString lastError_;
 };
@@ -0,0 +1,395 @@
+#include "passwordsearchindex.h"
+
+#include "passwordpinyin.h"
+#include "passwordurl.h"
+
+#include <QSet>
+#include <QStringView>
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Only the candidates sharing the most trigrams with the query are scored exactly.
+constexpr int kMinScoredCandidates = 2000;
+
+quint64 packTrigram(QChar a, QChar b, QChar c)
+{
+    return (static_cast<quint64>(a.unicode()) << 32) | (static_cast<quint64>(b.unicode()) << 16) | c.unicode();
+}
+
+void appendTrigrams(const QString &folded, QVector<quint64> &out)
+{
+    if (folded.isEmpty())
+        return;
+
+    const auto padded = QStringLiteral("  ") + folded + QLatin1Char(' ');
+    for (int i = 0; i + 2 < padded.size(); ++i)
+        out.push_back(packTrigram(padded.at(i), padded.at(i + 1), padded.at(i + 2)));
+}
+
+void sortUnique(QVector<quint64> &values)
+{
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+}
+
+// Calls `visit(token)` for every run of letters and digits in `folded` until it returns false.
+template<typename Visit>
+void forEachToken(const QString &folded, Visit visit)
+{
+    int start = -1;
+    for (int i = 0; i <= folded.size(); ++i) {
+        const bool word = i < folded.size() && folded.at(i).isLetterOrNumber();
+        if (word && start < 0) {
+            start = i;
+        } else if (!word && start >= 0) {
+            if (!visit(QStringView(folded).mid(start, i - start)))
+                return;
+            start = -1;
+        }
+    }
+}
+
+// Optimal string alignment distance (adjacent transpositions cost 1), giving up once it exceeds maxDistance.
+int boundedEditDistance(QStringView a, QStringView b, int maxDistance)
+{
+    const auto n = static_cast<int>(a.size());
+    const auto m = static_cast<int>(b.size());
+    if (qAbs(n - m) > maxDistance)
+        return maxDistance + 1;
+
+    QVarLengthArray<int, 96> buffer(3 * (m + 1));
+    int *before = buffer.data();
+    int *previous = before + (m + 1);
+    int *current = previous + (m + 1);
+    for (int j = 0; j <= m; ++j)
+        previous[j] = j;
+
+    for (int i = 1; i <= n; ++i) {
+        current[0] = i;
+        int rowMin = current[0];
+        for (int j = 1; j <= m; ++j) {
+            const int cost = a.at(i - 1) == b.at(j - 1) ? 0 : 1;
+            int value = qMin(qMin(previous[j] + 1, current[j - 1] + 1), previous[j - 1] + cost);
+            if (i > 1 && j > 1 && a.at(i - 1) == b.at(j - 2) && a.at(i - 2) == b.at(j - 1))
+                value = qMin(value, before[j - 2] + 1);
+            current[j] = value;
+            rowMin = qMin(rowMin, value);
+        }
+        if (rowMin > maxDistance)
+            return maxDistance + 1;
+
+        int *recycled = before;
+        before = previous;
+        previous = current;
+        current = recycled;
+    }
+
+    return qMin(previous[m], maxDistance + 1);
+}
+
+// Number of skipped characters when matching `query` as an in-order subsequence of `field`, or -1.
+int subsequenceGaps(const QString &field, const QString &query)
+{
+    int qi = 0;
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < field.size() && qi < query.size(); ++i) {
+        if (field.at(i) != query.at(qi))
+            continue;
+        if (first < 0)
+            first = i;
+        last = i;
+        ++qi;
+    }
+
+    if (qi < query.size())
+        return -1;
+    return (last - first + 1) - static_cast<int>(query.size());
+}
+
+int scoreField(const QString &field, const QString &query, int maxEdits)
+{
+    if (field.isEmpty())
+        return 0;
+
+    if (field == query)
+        return 1000;
+
+    const auto pos = field.indexOf(query);
+    if (pos == 0)
+        return 900;
+    if (pos > 0) {
+        const bool atWordStart = !field.at(pos - 1).isLetterOrNumber();
+        return (atWordStart ? 850 : 800) - qMin(static_cast<int>(pos), 100);
+    }
+
+    if (maxEdits > 0) {
+        // Tokens are found on the fly; only the few candidates that reach this point pay for it.
+        int bestDistance = maxEdits + 1;
+        forEachToken(field, [&](QStringView token) {
+            bestDistance = qMin(bestDistance, boundedEditDistance(query, token, maxEdits));
+            // Also compare against the token prefix so a half-typed word with a typo still matches.
+            if (token.size() > query.size())
+                bestDistance = qMin(bestDistance, boundedEditDistance(query, token.left(query.size()), maxEdits));
+            return bestDistance > 0;
+        });
+        if (bestDistance <= maxEdits)
+            return 600 - 150 * bestDistance;
+    }
+
+    const auto gaps = subsequenceGaps(field, query);
+    if (gaps >= 0 && gaps <= 2 * query.size())
+        return qMax(100, 400 - 10 * gaps);
+
+    return 0;
+}
+
+uint sourceHash(const PasswordEntry &entry)
+{
+    return qHash(entry.title) ^ (qHash(entry.username) * 31u) ^ (qHash(entry.url) * 131u) ^ (qHash(entry.tags.join('\n')) * 1031u)
+           ^ (qHash(entry.category) * 10007u);
+}
+
+} // namespace
+
+void PasswordSearchIndex::clear()
+{
+    docs_.clear();
+    freeSlots_.clear();
+    slotById_.clear();
+    postings_.clear();
+}
+
+PasswordSearchIndex::Document PasswordSearchIndex::makeDocument(const PasswordEntry &entry)
+{
+    Document doc;
+    doc.entryId = entry.id;
+    doc.sourceHash = sourceHash(entry);
+    doc.fields[TitleField] = entry.title.trimmed().toCaseFolded();
+    doc.fields[HostField] = PasswordUrl::hostFromUrl(entry.url).toCaseFolded();
+    doc.fields[UsernameField] = entry.username.trimmed().toCaseFolded();
+    doc.fields[TagsField] = entry.tags.join(' ').toCaseFolded();
+
+    QStringList pinyin;
+    for (const auto &source : {entry.title, entry.category}) {
+        if (!PasswordPinyin::containsHan(source))
+            continue;
+        const auto keys = PasswordPinyin::keysFor(source);
+        pinyin << keys.full << keys.initials;
+    }
+    doc.fields[PinyinField] = pinyin.join(' ');
+
+    for (const auto &field : doc.fields)
+        appendTrigrams(field, doc.trigrams);
+    sortUnique(doc.trigrams);
+    return doc;
+}
+
+void PasswordSearchIndex::upsert(const PasswordEntry &entry)
+{
+    if (entry.id <= 0)
+        return;
+
+    auto doc = makeDocument(entry);
+    const auto it = slotById_.constFind(entry.id);
+    if (it != slotById_.constEnd()) {
+        const auto slot = it.value();
+        removePostings(slot);
+        docs_[slot] = std::move(doc);
+        addPostings(slot);
+        return;
+    }
+
+    int slot = 0;
+    if (!freeSlots_.isEmpty()) {
+        slot = freeSlots_.takeLast();
+        docs_[slot] = std::move(doc);
+    } else {
+        slot = docs_.size();
+        docs_.push_back(std::move(doc));
+    }
+    slotById_.insert(entry.id, slot);
+    addPostings(slot);
+}
+
+void PasswordSearchIndex::remove(qint64 entryId)
+{
+    const auto it = slotById_.find(entryId);
+    if (it == slotById_.end())
+        return;
+
+    const auto slot = it.value();
+    slotById_.erase(it);
+    removePostings(slot);
+    docs_[slot] = Document();
+    freeSlots_.push_back(slot);
+}
+
+void PasswordSearchIndex::sync(const QVector<PasswordEntry> &entries)
+{
+    QSet<qint64> seen;
+    seen.reserve(entries.size());
+    for (const auto &entry : entries) {
+        seen.insert(entry.id);
+        const auto it = slotById_.constFind(entry.id);
+        if (it != slotById_.constEnd() && docs_.at(it.value()).sourceHash == sourceHash(entry))
+            continue;
+        upsert(entry);
+    }
+
+    removeMissing(seen);
+}
+
+void PasswordSearchIndex::sync(const PasswordEntryStore &store)
+{
+    QSet<qint64> seen;
+    seen.reserve(store.size());
+    for (int row = 0; row < store.size(); ++row) {
+        const auto id = store.row(row).id();
+        seen.insert(id);
+        const auto entry = store.entryAt(row);
+        const auto it = slotById_.constFind(id);
+        if (it != slotById_.constEnd() && docs_.at(it.value()).sourceHash == sourceHash(entry))
+            continue;
+        upsert(entry);
+    }
+
+    removeMissing(seen);
+}
+
+void PasswordSearchIndex::removeMissing(const QSet<qint64> &seen)
+{
+    QVector<qint64> removed;
+    for (auto it = slotById_.cbegin(); it != slotById_.cend(); ++it) {
+        if (!seen.contains(it.key()))
+            removed.push_back(it.key());
+    }
+    for (const auto id : removed)
+        remove(id);
+}
+
+void PasswordSearchIndex::addPostings(int slot)
+{
+    for (const auto trigram : docs_.at(slot).trigrams) {
+        auto &posting = postings_[trigram];
+        // New slots are appended at the end, so the ascending order usually costs nothing; reused slots insert.
+        if (posting.isEmpty() || posting.last() < slot)
+            posting.push_back(slot);
+        else
+            posting.insert(std::lower_bound(posting.begin(), posting.end(), slot), slot);
+    }
+}
+
+void PasswordSearchIndex::removePostings(int slot)
+{
+    for (const auto trigram : docs_.at(slot).trigrams) {
+        auto it = postings_.find(trigram);
+        if (it == postings_.end())
+            continue;
+
+        auto &posting = it.value();
+        const auto pos = std::lower_bound(posting.begin(), posting.end(), slot);
+        if (pos != posting.end() && *pos == slot)
+            posting.erase(pos);
+        if (posting.isEmpty())
+            postings_.erase(it);
+    }
+}
+
+int PasswordSearchIndex::scoreDocument(const Document &doc, const QString &query, int maxEdits)
+{
+    static constexpr int kFieldBonus[FieldCount] = {30, 20, 10, 0, 25};
+
+    int best = 0;
+    for (int f = 0; f < FieldCount; ++f) {
+        const auto score = scoreField(doc.fields[f], query, maxEdits);
+        if (score > 0)
+            best = qMax(best, score + kFieldBonus[f]);
+    }
+    return best;
+}
+
+QVector<PasswordSearchIndex::Hit> PasswordSearchIndex::query(const QString &text, int limit, const EntryPredicate &accept) const
+{
+    const auto q = text.trimmed().toCaseFolded();
+    if (q.isEmpty() || limit <= 0 || slotById_.isEmpty())
+        return {};
+
+    const int maxEdits = q.size() >= 8 ? 2 : (q.size() >= 4 ? 1 : 0);
+    const auto accepted = [&](int slot) { return !accept || accept(docs_.at(slot).entryId); };
+
+    // Min-heap of (score, -slot): the weakest hit is on top and gets evicted first.
+    using Ranked = std::pair<int, int>;
+    std::priority_queue<Ranked, std::vector<Ranked>, std::greater<Ranked>> heap;
+    const auto offer = [&](int slot) {
+        const auto score = scoreDocument(docs_.at(slot), q, maxEdits);
+        if (score <= 0)
+            return;
+        if (static_cast<int>(heap.size()) < limit) {
+            heap.emplace(score, -slot);
+        } else if (heap.top().first < score) {
+            heap.pop();
+            heap.emplace(score, -slot);
+        }
+    };
+
+    if (q.size() < 3) {
+        // Too short for trigrams to discriminate; a linear pass over the folded fields is cheap enough.
+        for (int slot = 0; slot < docs_.size(); ++slot) {
+            if (docs_.at(slot).entryId != 0 && accepted(slot))
+                offer(slot);
+        }
+    } else {
+        QVector<quint64> grams;
+        appendTrigrams(q, grams);
+        sortUnique(grams);
+
+        // Rejected slots are remembered as such (kRejected) so the predicate runs once per candidate, and they
+        // never count against the scoring cap.
+        constexpr quint16 kRejected = 0xFFFF;
+        QVector<quint16> shared(docs_.size(), 0);
+        QVector<int> candidates;
+        for (const auto gram : grams) {
+            const auto it = postings_.constFind(gram);
+            if (it == postings_.constEnd())
+                continue;
+            for (const auto slot : it.value()) {
+                auto &count = shared[slot];
+                if (count == kRejected)
+                    continue;
+                if (count == 0 && !accepted(slot)) {
+                    count = kRejected;
+                    continue;
+                }
+                if (count++ == 0)
+                    candidates.push_back(slot);
+            }
+        }
+
+        const auto cap = qMax(kMinScoredCandidates, limit * 8);
+        if (candidates.size() > cap) {
+            std::nth_element(candidates.begin(), candidates.begin() + cap, candidates.end(), [&](int a, int b) {
+                return shared.at(a) > shared.at(b);
+            });
+            candidates.resize(cap);
+        }
+
+        for (const auto slot : candidates)
+            offer(slot);
+    }
+
+    QVector<Hit> hits(static_cast<int>(heap.size()));
+    for (int i = hits.size() - 1; i >= 0; --i) {
+        hits[i].entryId = docs_.at(-heap.top().second).entryId;
+        hits[i].score = heap.top().first;
+        heap.pop();
+    }
+    return hits;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "passwordentry.h"
+#include "passwordentrystore.h"
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+// In-memory trigram index over title, host, username, tags and the pinyin of Chinese titles/categories. Queries are scored by exact/prefix/substring
+// matches, bounded edit distance (typos such as "githbu") and subsequences, and return the best `limit` hits.
+// Copies are cheap (implicitly shared containers), so a snapshot can be handed to a worker thread.
+class PasswordSearchIndex final
+{
+public:
+    struct Hit final
+    {
+        qint64 entryId = 0;
+        int score = 0;
+    };
+
+    void clear();
+    void upsert(const PasswordEntry &entry);
+    void remove(qint64 entryId);
+    // Brings the index in line with `entries`: new or modified entries are (re)indexed, missing ones removed.
+    void sync(const QVector<PasswordEntry> &entries);
+    // Same, reading the columnar store one row at a time instead of a materialized entry list.
+    void sync(const PasswordEntryStore &store);
+
+    bool contains(qint64 entryId) const { return slotById_.contains(entryId); }
+    int size() const { return slotById_.size(); }
+
+    // Entries rejected by `accept` never compete for the `limit` places, so filters applied by the caller do
+    // not thin out the ranked hits.
+    using EntryPredicate = std::function<bool(qint64 entryId)>;
+    QVector<Hit> query(const QString &text, int limit, const EntryPredicate &accept = {}) const;
+
+private:
+    enum Field
+    {
+        TitleField = 0,
+        HostField,
+        UsernameField,
+        TagsField,
+        PinyinField,
+        FieldCount
+    };
+
+    struct Document final
+    {
+        qint64 entryId = 0;
+        uint sourceHash = 0;
+        QString fields[FieldCount];
+        QVector<quint64> trigrams;
+    };
+
+    static Document makeDocument(const PasswordEntry &entry);
+    void removeMissing(const QSet<qint64> &seen);
+    static int scoreDocument(const Document &doc, const QString &query, int maxEdits);
+
+    void addPostings(int slot);
+    void removePostings(int slot);
+
+    QVector<Document> docs_;
+    QVector<int> freeSlots_;
+    QHash<qint64, int> slotById_;
+    // Slot lists are kept ascending so removal is a binary search.
+    QHash<quint64, QVector<int>> postings_;
+};
@@ -0,0 +1,229 @@
+#include "passwordsimilarity.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Skeletons sharing a deletion key are compared pairwise up to this many. A larger group (a very common stem)
+// is only compared against its first member, which keeps the pass linear.
+constexpr int kMaxPairwiseGroup = 16;
+
+QChar unleet(QChar c)
+{
+    switch (c.unicode()) {
+    case '0':
+        return QChar('o');
+    case '1':
+    case '!':
+        return QChar('i');
+    case '3':
+        return QChar('e');
+    case '4':
+    case '@':
+        return QChar('a');
+    case '5':
+    case '$':
+        return QChar('s');
+    case '7':
+    case '+':
+        return QChar('t');
+    case '8':
+        return QChar('b');
+    case '9':
+        return QChar('g');
+    case '|':
+        return QChar('l');
+    default:
+        return c;
+    }
+}
+
+// FNV-1a over the UTF-16 units of `s`, leaving out position `skip` (-1 for none).
+quint64 deletionKey(const QString &s, int skip)
+{
+    quint64 h = 0xcbf29ce484222325ull;
+    for (int i = 0; i < s.size(); ++i) {
+        if (i == skip)
+            continue;
+        h ^= s.at(i).unicode();
+        h *= 0x100000001b3ull;
+    }
+    // Mix in the resulting length so strings of different lengths cannot share a key by accident.
+    h ^= static_cast<quint64>(skip < 0 ? s.size() : s.size() - 1) << 56;
+    return h;
+}
+
+bool sameTail(const QString &a, int ai, const QString &b, int bi)
+{
+    if (a.size() - ai != b.size() - bi)
+        return false;
+    for (; ai < a.size(); ++ai, ++bi) {
+        if (a.at(ai) != b.at(bi))
+            return false;
+    }
+    return true;
+}
+
+// Optimal string alignment distance <= 1: one substitution, insertion, deletion or swap of neighbours.
+bool withinOneEdit(const QString &a, const QString &b)
+{
+    const auto &shorter = a.size() <= b.size() ? a : b;
+    const auto &longer = a.size() <= b.size() ? b : a;
+    if (longer.size() - shorter.size() > 1)
+        return false;
+
+    int i = 0;
+    while (i < shorter.size() && shorter.at(i) == longer.at(i))
+        ++i;
+    if (i == shorter.size())
+        return true;
+
+    if (shorter.size() == longer.size()) {
+        if (sameTail(shorter, i + 1, longer, i + 1))
+            return true;
+        return i + 1 < shorter.size() && shorter.at(i) == longer.at(i + 1) && shorter.at(i + 1) == longer.at(i)
+               && sameTail(shorter, i + 2, longer, i + 2);
+    }
+    return sameTail(shorter, i, longer, i + 1);
+}
+
+} // namespace
+
+namespace PasswordSimilarity {
+
+QString skeleton(const QString &password)
+{
+    const auto lowered = password.toLower();
+    auto end = static_cast<int>(lowered.size());
+    while (end > 0 && !lowered.at(end - 1).isLetter())
+        --end;
+
+    QString out;
+    out.reserve(qMin(end, kMaxSkeletonLength));
+    for (int i = 0; i < end && out.size() < kMaxSkeletonLength; ++i)
+        out.append(unleet(lowered.at(i)));
+    return out;
+}
+
+QVector<int> cluster(const QVector<QString> &skeletons)
+{
+    QVector<int> result(skeletons.size(), -1);
+
+    // Identical skeletons collapse first; the edit-distance pass only sees distinct ones.
+    QHash<QString, int> distinctIds;
+    QVector<QString> distinct;
+    QVector<int> idOf(skeletons.size(), -1);
+    for (int i = 0; i < skeletons.size(); ++i) {
+        const auto &s = skeletons.at(i);
+        if (s.size() < kMinSkeletonLength)
+            continue;
+        auto it = distinctIds.constFind(s);
+        if (it == distinctIds.cend()) {
+            it = distinctIds.insert(s, distinct.size());
+            distinct.push_back(s);
+        }
+        idOf[i] = it.value();
+    }
+
+    std::vector<std::pair<quint64, int>> keys;
+    for (int id = 0; id < distinct.size(); ++id) {
+        const auto &s = distinct.at(id);
+        keys.emplace_back(deletionKey(s, -1), id);
+        for (int skip = 0; skip < s.size(); ++skip)
+            keys.emplace_back(deletionKey(s, skip), id);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<std::vector<int>> neighbours(static_cast<size_t>(distinct.size()));
+    std::vector<int> group;
+    for (size_t begin = 0; begin < keys.size();) {
+        auto end = begin + 1;
+        while (end < keys.size() && keys[end].first == keys[begin].first)
+            ++end;
+        if (end - begin > 1) {
+            group.clear();
+            for (auto k = begin; k < end; ++k)
+                group.push_back(keys[k].second);
+            const auto pairwise = static_cast<int>(group.size()) <= kMaxPairwiseGroup;
+            for (size_t a = 0; a < group.size(); ++a) {
+                for (auto b = a + 1; b < group.size(); ++b) {
+                    if (withinOneEdit(distinct.at(group[a]), distinct.at(group[b]))) {
+                        neighbours[static_cast<size_t>(group[a])].push_back(group[b]);
+                        neighbours[static_cast<size_t>(group[b])].push_back(group[a]);
+                    }
+                }
+                if (!pairwise)
+                    break;
+            }
+        }
+        begin = end;
+    }
+
+    // Entries per skeleton, and entries within one edit of it (itself included).
+    std::vector<int> weight(static_cast<size_t>(distinct.size()), 0);
+    for (const auto id : idOf) {
+        if (id >= 0)
+            ++weight[static_cast<size_t>(id)];
+    }
+    std::vector<int> support(weight);
+    for (size_t id = 0; id < neighbours.size(); ++id) {
+        auto &list = neighbours[id];
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        for (const auto other : list)
+            support[id] += weight[static_cast<size_t>(other)];
+    }
+
+    // Chaining neighbours would let love -> dove -> done -> bone end up in one cluster. Instead the best
+    // supported skeleton still free becomes a centre and takes its free neighbours, so every member is within
+    // one edit of its centre.
+    std::vector<int> order(static_cast<size_t>(distinct.size()));
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        const auto ua = static_cast<size_t>(a);
+        const auto ub = static_cast<size_t>(b);
+        if (support[ua] != support[ub])
+            return support[ua] > support[ub];
+        if (weight[ua] != weight[ub])
+            return weight[ua] > weight[ub];
+        return a < b;
+    });
+    std::vector<int> centreOf(static_cast<size_t>(distinct.size()), -1);
+    for (const auto centre : order) {
+        if (centreOf[static_cast<size_t>(centre)] >= 0)
+            continue;
+        centreOf[static_cast<size_t>(centre)] = centre;
+        for (const auto other : neighbours[static_cast<size_t>(centre)]) {
+            if (centreOf[static_cast<size_t>(other)] < 0)
+                centreOf[static_cast<size_t>(other)] = centre;
+        }
+    }
+
+    // Only groups of two or more entries count; a lone skeleton stays at -1.
+    QHash<int, int> entriesPerCentre;
+    for (int i = 0; i < skeletons.size(); ++i) {
+        if (idOf.at(i) >= 0)
+            ++entriesPerCentre[centreOf[static_cast<size_t>(idOf.at(i))]];
+    }
+    QHash<int, int> clusterOfCentre;
+    for (int i = 0; i < skeletons.size(); ++i) {
+        if (idOf.at(i) < 0)
+            continue;
+        const auto centre = centreOf[static_cast<size_t>(idOf.at(i))];
+        if (entriesPerCentre.value(centre) < 2)
+            continue;
+        auto it = clusterOfCentre.constFind(centre);
+        if (it == clusterOfCentre.cend())
+            it = clusterOfCentre.insert(centre, clusterOfCentre.size());
+        result[i] = it.value();
+    }
+    return result;
+}
+
+} // namespace PasswordSimilarity
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+// Near-duplicate detection for the health scan. Passwords are reduced to a skeleton (lower-cased, trailing
+// digits and symbols dropped, l33t substitutions undone), so "Summer2023!", "Summ3r2024!!" and "summer" all
+// become "summer". Skeletons are then grouped around centres, each member within one edit of its centre.
+namespace PasswordSimilarity {
+
+// Skeletons shorter than this never join a cluster; "abc" says nothing about how a password was derived.
+constexpr int kMinSkeletonLength = 4;
+constexpr int kMaxSkeletonLength = 32;
+
+QString skeleton(const QString &password);
+
+// Cluster index per input (dense, from 0), or -1 for skeletons that are too short or have no neighbour. Runs
+// in time linear in the input: every skeleton is indexed under itself and each of its single-character
+// deletions, and two skeletons within one edit (substitution, insertion, deletion or adjacent swap) always
+// share such a key. Candidates found that way are confirmed with a bounded edit distance. A cluster never spans
+// more than two edits: members join the best supported centre next to them instead of chaining.
+QVector<int> cluster(const QVector<QString> &skeletons);
+
+} // namespace PasswordSimilarity
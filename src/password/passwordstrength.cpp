@@ -1,76 +1,586 @@
 #include "passwordstrength.h"
 
-#include <QSet>
+#include <QDate>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
 
 namespace {
 
-bool isAllSameChar(const QString &s)
+#include "passwordstrengthtables.inc"
+
+static_assert(sizeof(kStrengthWordOffsets) / sizeof(kStrengthWordOffsets[0]) == kStrengthWordCount + 1,
+              "word offsets do not cover the word list");
+
+// Only the first characters are matched; the matchers and the search below are polynomial in the length, and
+// anything this long is at the top of the scale already.
+constexpr int kMaxLength = 64;
+constexpr int kMinMatchLength = 3;
+constexpr double kBruteforceCardinality = 10;
+constexpr double kMinSubmatchGuessesSingleChar = 10;
+constexpr double kMinSubmatchGuessesMultiChar = 50;
+// Penalty for every extra match in a decomposition, so splitting a password into many tiny matches never pays.
+constexpr double kMinGuessesBeforeGrowingSequence = 10000;
+constexpr int kMinYearSpace = 20;
+constexpr int kMinDateYear = 1000;
+constexpr int kMaxDateYear = 2050;
+constexpr int kMaxSequenceDelta = 5;
+// log10(guesses) * 6.25: 10^16 guesses and up score 100.
+constexpr double kScorePerOrderOfMagnitude = 6.25;
+
+using Text = std::u16string;
+
+// One way of explaining password[i..j]; `guesses` is what an attacker modelling that pattern needs.
+struct Match
 {
-    if (s.size() < 4)
-        return false;
+    int i = 0;
+    int j = 0;
+    double guesses = 1;
+};
+
+bool isAsciiUpper(char16_t c)
+{
+    return c >= u'A' && c <= u'Z';
+}
+
+bool isAsciiLower(char16_t c)
+{
+    return c >= u'a' && c <= u'z';
+}
+
+bool isAsciiDigit(char16_t c)
+{
+    return c >= u'0' && c <= u'9';
+}
+
+Text lowerAscii(const Text &s)
+{
+    auto out = s;
+    for (auto &c : out) {
+        if (isAsciiUpper(c))
+            c = static_cast<char16_t>(c + (u'a' - u'A'));
+    }
+    return out;
+}
+
+double nCk(int n, int k)
+{
+    if (k < 0 || k > n)
+        return 0;
+    double r = 1;
+    for (int d = 1; d <= k; ++d)
+        r = r * (n - k + d) / d;
+    return r;
+}
+
+// Sum of C(a + b, 1..min(a, b)): the ways to place `a` marked characters among `a + b`, up to the smaller half.
+double mixedVariations(int a, int b)
+{
+    if (a == 0 || b == 0)
+        return 2;
+    double sum = 0;
+    for (int k = 1; k <= qMin(a, b); ++k)
+        sum += nCk(a + b, k);
+    return sum;
+}
+
+// --- Dictionary -------------------------------------------------------------------------------------------
+
+int wordLength(int index)
+{
+    return kStrengthWordOffsets[index + 1] - kStrengthWordOffsets[index];
+}
+
+int wordCharAt(int index, int k)
+{
+    return k < wordLength(index) ? static_cast<uchar>(kStrengthWordChars[kStrengthWordOffsets[index] + k]) : -1;
+}
+
+// First index in [lo, hi) whose k-th character is at least `c` (or above it, when `above` is set). Words shorter
+// than k + 1 characters sort first, so the order holds within any range that shares its first k characters.
+int lowerBound(int lo, int hi, int k, int c, bool above)
+{
+    while (lo < hi) {
+        const auto mid = lo + (hi - lo) / 2;
+        const auto m = wordCharAt(mid, k);
+        if (m < c || (above && m == c))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Calls `visit(i, j, rank)` for every listed word equal to text[i..j]. The sorted array works as an implicit
+// trie: extending the substring by one character narrows the range of words sharing it as a prefix, and the scan
+// from `i` stops as soon as that range is empty.
+template<typename Visit>
+void forEachWord(const Text &text, Visit visit)
+{
+    const auto n = static_cast<int>(text.size());
+    for (int i = 0; i < n; ++i) {
+        int lo = 0;
+        int hi = kStrengthWordCount;
+        for (int j = i; j < n; ++j) {
+            const auto c = text[static_cast<size_t>(j)];
+            if (c > 0x7E)
+                break;
+            const auto k = j - i;
+            const auto from = lowerBound(lo, hi, k, c, false);
+            hi = lowerBound(from, hi, k, c, true);
+            lo = from;
+            if (lo == hi)
+                break;
+            if (k + 1 >= kMinMatchLength && wordLength(lo) == k + 1)
+                visit(i, j, kStrengthWordRanks[lo]);
+        }
+    }
+}
+
+double uppercaseVariations(const Text &token)
+{
+    int upper = 0;
+    int lower = 0;
+    for (const auto c : token) {
+        upper += isAsciiUpper(c) ? 1 : 0;
+        lower += isAsciiLower(c) ? 1 : 0;
+    }
+    if (upper == 0)
+        return 1;
+    // Capitalised, trailing capital and all caps are the first things an attacker tries.
+    const auto first = isAsciiUpper(token.front()) && upper == 1;
+    const auto last = isAsciiUpper(token.back()) && upper == 1;
+    if (first || last || lower == 0)
+        return 2;
+    return mixedVariations(upper, lower);
+}
+
+// '1' and '|' read as either 'i' or 'l'; the two readings are matched separately.
+char16_t unleet(char16_t c, bool oneAsL)
+{
+    switch (c) {
+    case u'0':
+        return u'o';
+    case u'1':
+    case u'|':
+        return oneAsL ? u'l' : u'i';
+    case u'!':
+        return u'i';
+    case u'3':
+        return u'e';
+    case u'4':
+    case u'@':
+        return u'a';
+    case u'5':
+    case u'$':
+        return u's';
+    case u'7':
+    case u'+':
+        return u't';
+    case u'8':
+        return u'b';
+    case u'9':
+        return u'g';
+    default:
+        return c;
+    }
+}
+
+double leetVariations(const Text &lowered, bool oneAsL)
+{
+    static constexpr char16_t kLeetChars[] = u"0134@5$7+!89|";
+    double variations = 1;
+    for (const auto *p = kLeetChars; *p; ++p) {
+        const auto subbed = static_cast<int>(std::count(lowered.begin(), lowered.end(), *p));
+        if (subbed == 0)
+            continue;
+        const auto letter = unleet(*p, oneAsL);
+        variations *= mixedVariations(subbed, static_cast<int>(std::count(lowered.begin(), lowered.end(), letter)));
+    }
+    return variations;
+}
+
+void dictionaryMatches(const Text &password, const Text &lowered, std::vector<Match> &out)
+{
+    forEachWord(lowered, [&](int i, int j, int rank) {
+        const auto token = password.substr(static_cast<size_t>(i), static_cast<size_t>(j - i + 1));
+        out.push_back({i, j, rank * uppercaseVariations(token)});
+    });
+
+    const auto n = static_cast<int>(lowered.size());
+    const Text reversed(lowered.rbegin(), lowered.rend());
+    forEachWord(reversed, [&](int i, int j, int rank) {
+        const auto from = n - 1 - j;
+        const auto token = password.substr(static_cast<size_t>(from), static_cast<size_t>(j - i + 1));
+        out.push_back({from, n - 1 - i, rank * uppercaseVariations(token) * 2});
+    });
+
+    for (const auto oneAsL : {false, true}) {
+        Text plain = lowered;
+        for (auto &c : plain)
+            c = unleet(c, oneAsL);
+        if (plain == lowered)
+            break;
+        forEachWord(plain, [&](int i, int j, int rank) {
+            const auto length = static_cast<size_t>(j - i + 1);
+            const auto subbed = lowered.substr(static_cast<size_t>(i), length);
+            // Words spelt without substitutions were matched above already.
+            if (subbed == plain.substr(static_cast<size_t>(i), length))
+                return;
+            const auto token = password.substr(static_cast<size_t>(i), length);
+            out.push_back({i, j, rank * uppercaseVariations(token) * leetVariations(subbed, oneAsL)});
+        });
+        if (lowered.find(u'1') == Text::npos && lowered.find(u'|') == Text::npos)
+            break;
+    }
+}
+
+// --- Keyboard -----------------------------------------------------------------------------------------------
+
+double spatialGuesses(int length, int turns, int shifted, double startingPositions, double averageDegree)
+{
+    double guesses = 0;
+    for (int i = 2; i <= length; ++i) {
+        const auto possibleTurns = qMin(turns, i - 1);
+        for (int t = 1; t <= possibleTurns; ++t)
+            guesses += nCk(i - 1, t - 1) * startingPositions * std::pow(averageDegree, t);
+    }
+    if (shifted > 0)
+        guesses *= mixedVariations(shifted, length - shifted);
+    return guesses;
+}
+
+// Runs of keys that neighbour each other on `graph`, such as "qwerty", "zaq1" or "7896".
+template<int Keys, int Directions>
+void spatialMatches(const Text &password, const qint8 (&keyOf)[128], const bool *shiftedChars,
+                    const qint8 (&graph)[Keys][Directions], double startingPositions, double averageDegree,
+                    std::vector<Match> &out)
+{
+    const auto keyAt = [&](int pos) {
+        const auto c = password[static_cast<size_t>(pos)];
+        return c < 128 ? keyOf[c] : qint8(-1);
+    };
+    const auto isShifted = [&](int pos) {
+        const auto c = password[static_cast<size_t>(pos)];
+        return shiftedChars && c < 128 && shiftedChars[c];
+    };
+
+    const auto n = static_cast<int>(password.size());
+    int i = 0;
+    while (i < n - 1) {
+        int j = i + 1;
+        int lastDirection = -1;
+        int turns = 0;
+        int shifted = isShifted(i) ? 1 : 0;
+        for (;;) {
+            int direction = -1;
+            if (j < n) {
+                const auto from = keyAt(j - 1);
+                const auto to = keyAt(j);
+                for (int d = 0; from >= 0 && to >= 0 && d < Directions; ++d) {
+                    if (graph[from][d] == to) {
+                        direction = d;
+                        break;
+                    }
+                }
+            }
+            if (direction < 0)
+                break;
+            if (isShifted(j))
+                ++shifted;
+            if (direction != lastDirection) {
+                ++turns;
+                lastDirection = direction;
+            }
+            ++j;
+        }
+        if (j - i >= kMinMatchLength)
+            out.push_back({i, j - 1, spatialGuesses(j - i, turns, shifted, startingPositions, averageDegree)});
+        i = j;
+    }
+}
+
+// --- Sequences, years and dates -----------------------------------------------------------------------------
+
+void sequenceMatches(const Text &password, std::vector<Match> &out)
+{
+    const auto n = static_cast<int>(password.size());
+    const auto addSequence = [&](int i, int j, int delta) {
+        if (j - i + 1 < kMinMatchLength || delta == 0 || qAbs(delta) > kMaxSequenceDelta)
+            return;
+        const auto first = password[static_cast<size_t>(i)];
+        double base = 26;
+        if (first == u'a' || first == u'A' || first == u'z' || first == u'Z' || first == u'0' || first == u'1'
+            || first == u'9')
+            base = 4;
+        else if (isAsciiDigit(first))
+            base = 10;
+        if (delta < 0)
+            base *= 2;
+        out.push_back({i, j, base * (j - i + 1)});
+    };
+
+    int i = 0;
+    int lastDelta = 0;
+    for (int k = 1; k < n; ++k) {
+        const auto delta = int(password[static_cast<size_t>(k)]) - int(password[static_cast<size_t>(k - 1)]);
+        if (k == 1)
+            lastDelta = delta;
+        if (delta == lastDelta)
+            continue;
+        addSequence(i, k - 1, lastDelta);
+        i = k - 1;
+        lastDelta = delta;
+    }
+    if (n > 1)
+        addSequence(i, n - 1, lastDelta);
+}
 
-    const auto ch = s.at(0);
-    for (int i = 1; i < s.size(); ++i) {
-        if (s.at(i) != ch)
+int digitsValue(const Text &s, int from, int length)
+{
+    int value = 0;
+    for (int k = from; k < from + length; ++k)
+        value = value * 10 + (s[static_cast<size_t>(k)] - u'0');
+    return value;
+}
+
+bool allDigits(const Text &s, int from, int length)
+{
+    if (from + length > static_cast<int>(s.size()))
+        return false;
+    for (int k = from; k < from + length; ++k) {
+        if (!isAsciiDigit(s[static_cast<size_t>(k)]))
             return false;
     }
     return true;
 }
 
-bool isSequentialChars(const QString &s)
+double yearGuesses(int year, int referenceYear)
 {
-    if (s.size() < 4)
-        return false;
+    return qMax(qAbs(year - referenceYear), kMinYearSpace);
+}
 
-    bool inc = true;
-    bool dec = true;
-    for (int i = 1; i < s.size(); ++i) {
-        const auto prev = s.at(i - 1).unicode();
-        const auto cur = s.at(i).unicode();
-        if (cur != prev + 1)
-            inc = false;
-        if (cur != prev - 1)
-            dec = false;
-        if (!inc && !dec)
-            return false;
+// Year of a reading with `a` and `b` as day and month in either order, or 0 when it is not a calendar date.
+int dateYear(int year, int yearDigits, int a, int b)
+{
+    const auto dayMonth = [](int day, int month) { return day >= 1 && day <= 31 && month >= 1 && month <= 12; };
+    if (!dayMonth(a, b) && !dayMonth(b, a))
+        return 0;
+    if (yearDigits == 2)
+        return year > 50 ? 1900 + year : 2000 + year;
+    if (yearDigits == 4 && year >= kMinDateYear && year <= kMaxDateYear)
+        return year;
+    return 0;
+}
+
+// Best guess count for the digit groups (x, y, z) read as a date with the year first or last; 0 when neither is.
+double dateGuesses(const int (&value)[3], const int (&digits)[3], int referenceYear)
+{
+    double best = 0;
+    const auto consider = [&](int year) {
+        if (year == 0)
+            return;
+        const auto guesses = yearGuesses(year, referenceYear) * 365;
+        if (best == 0 || guesses < best)
+            best = guesses;
+    };
+    if (digits[1] <= 2 && digits[2] <= 2)
+        consider(dateYear(value[0], digits[0], value[1], value[2]));
+    if (digits[0] <= 2 && digits[1] <= 2)
+        consider(dateYear(value[2], digits[2], value[0], value[1]));
+    return best;
+}
+
+void dateMatches(const Text &password, int referenceYear, std::vector<Match> &out)
+{
+    const auto n = static_cast<int>(password.size());
+    for (int i = 0; i < n; ++i) {
+        if (!isAsciiDigit(password[static_cast<size_t>(i)]))
+            continue;
+
+        if (allDigits(password, i, 4)) {
+            const auto year = digitsValue(password, i, 4);
+            if (year >= 1900 && year <= 2099)
+                out.push_back({i, i + 3, yearGuesses(year, referenceYear)});
+        }
+
+        // Run-together dates such as "2024315", "150388" or "3151988".
+        for (int length = 4; length <= 8 && allDigits(password, i, length); ++length) {
+            double best = 0;
+            for (int a = 1; a <= 4 && a < length; ++a) {
+                for (int b = 1; b <= 2 && a + b < length; ++b) {
+                    const auto c = length - a - b;
+                    if (c > 4)
+                        continue;
+                    const int value[3] = {digitsValue(password, i, a), digitsValue(password, i + a, b),
+                                          digitsValue(password, i + a + b, c)};
+                    const int digits[3] = {a, b, c};
+                    const auto guesses = dateGuesses(value, digits, referenceYear);
+                    if (guesses > 0 && (best == 0 || guesses < best))
+                        best = guesses;
+                }
+            }
+            if (best > 0)
+                out.push_back({i, i + length - 1, best});
+        }
+
+        // Dates with a repeated separator, such as "3/15/1988" or "2024-03-15".
+        static constexpr char16_t kSeparators[] = u" /\\_.-";
+        for (int a = 1; a <= 4 && allDigits(password, i, a); ++a) {
+            const auto sepAt = i + a;
+            if (sepAt >= n || !std::char_traits<char16_t>::find(kSeparators, 6, password[static_cast<size_t>(sepAt)]))
+                continue;
+            const auto separator = password[static_cast<size_t>(sepAt)];
+            for (int b = 1; b <= 2 && allDigits(password, sepAt + 1, b); ++b) {
+                const auto secondSep = sepAt + 1 + b;
+                if (secondSep >= n || password[static_cast<size_t>(secondSep)] != separator)
+                    continue;
+                for (int c = 1; c <= 4 && allDigits(password, secondSep + 1, c); ++c) {
+                    const int value[3] = {digitsValue(password, i, a), digitsValue(password, sepAt + 1, b),
+                                          digitsValue(password, secondSep + 1, c)};
+                    const int digits[3] = {a, b, c};
+                    const auto guesses = dateGuesses(value, digits, referenceYear);
+                    if (guesses > 0)
+                        out.push_back({i, secondSep + c, guesses * 4});
+                }
+            }
+        }
     }
-    return inc || dec;
-}
-
-bool isCommonWeakPassword(const QString &password)
-{
-    static const QSet<QString> kCommonWeak = {
-        "123456",
-        "12345678",
-        "123456789",
-        "111111",
-        "000000",
-        "password",
-        "qwerty",
-        "abc123",
-        "admin",
-        "letmein",
-        "iloveyou",
+}
+
+// --- Search -------------------------------------------------------------------------------------------------
+
+double minimumGuesses(const Text &password, int referenceYear);
+
+// Back-to-back copies of a base such as "abcabc" or "aaaa". The longest repeated run starting at each position
+// wins, and the base is estimated on its own.
+void repeatMatches(const Text &password, int referenceYear, std::vector<Match> &out)
+{
+    const auto n = static_cast<int>(password.size());
+    int i = 0;
+    while (i < n) {
+        int bestBase = 0;
+        int bestCount = 0;
+        for (int base = 1; i + 2 * base <= n; ++base) {
+            int count = 1;
+            while (i + (count + 1) * base <= n
+                   && password.compare(static_cast<size_t>(i + count * base), static_cast<size_t>(base), password,
+                                       static_cast<size_t>(i), static_cast<size_t>(base))
+                          == 0)
+                ++count;
+            if (count >= 2 && base * count > bestBase * bestCount) {
+                bestBase = base;
+                bestCount = count;
+            }
+        }
+        if (bestCount == 0) {
+            ++i;
+            continue;
+        }
+        const auto baseGuesses =
+            minimumGuesses(password.substr(static_cast<size_t>(i), static_cast<size_t>(bestBase)), referenceYear);
+        out.push_back({i, i + bestBase * bestCount - 1, baseGuesses * bestCount});
+        i += bestBase * bestCount;
+    }
+}
+
+std::vector<Match> collectMatches(const Text &password, int referenceYear)
+{
+    std::vector<Match> matches;
+    dictionaryMatches(password, lowerAscii(password), matches);
+    spatialMatches(password, kQwertyKeyOf, kQwertyShifted, kQwertyNeighbours, kQwertyStartingPositions,
+                   kQwertyAverageDegree, matches);
+    spatialMatches(password, kKeypadKeyOf, nullptr, kKeypadNeighbours, kKeypadStartingPositions,
+                   kKeypadAverageDegree, matches);
+    repeatMatches(password, referenceYear, matches);
+    sequenceMatches(password, matches);
+    dateMatches(password, referenceYear, matches);
+    return matches;
+}
+
+// Fewest guesses over every way of covering the password with a sequence of matches and bruteforce runs. As in
+// zxcvbn, a sequence of l matches costs l! * (product of match guesses) + 10000^(l - 1): the factorial for their
+// order, the second term so that every extra match has to earn its place. best[k][l] keeps the cheapest cover of
+// password[0..k] with l matches.
+double minimumGuesses(const Text &password, int referenceYear)
+{
+    const auto n = static_cast<int>(password.size());
+    if (n == 0)
+        return 1;
+
+    auto matches = collectMatches(password, referenceYear);
+    std::sort(matches.begin(), matches.end(), [](const Match &a, const Match &b) { return a.j < b.j; });
+
+    struct Cell
+    {
+        double total = 0;   // l! * product + penalty, compared across l
+        double product = 0; // product of the match guesses
+        bool set = false;
+        bool bruteforce = false;
     };
+    const auto width = n + 1;
+    std::vector<Cell> best(static_cast<size_t>(n * width));
+    const auto cell = [&](int k, int l) -> Cell & { return best[static_cast<size_t>(k * width + l)]; };
 
-    const auto p = password.trimmed().toLower();
-    if (p.isEmpty())
-        return true;
+    std::vector<double> factorial(static_cast<size_t>(width) + 1, 1);
+    for (int l = 1; l <= width; ++l)
+        factorial[static_cast<size_t>(l)] = factorial[static_cast<size_t>(l - 1)] * l;
 
-    if (kCommonWeak.contains(p))
-        return true;
+    const auto update = [&](int i, int j, double guesses, bool bruteforce, int l) {
+        const auto length = j - i + 1;
+        if (length < n)
+            guesses = qMax(guesses, length == 1 ? kMinSubmatchGuessesSingleChar : kMinSubmatchGuessesMultiChar);
+        auto product = guesses;
+        if (l > 1)
+            product *= cell(i - 1, l - 1).product;
+        const auto total =
+            factorial[static_cast<size_t>(l)] * product + std::pow(kMinGuessesBeforeGrowingSequence, l - 1);
+        for (int shorter = 1; shorter <= l; ++shorter) {
+            const auto &other = cell(j, shorter);
+            if (other.set && other.total <= total)
+                return;
+        }
+        cell(j, l) = {total, product, true, bruteforce};
+    };
+    const auto bruteforceGuesses = [](int length) {
+        return qMax(std::pow(kBruteforceCardinality, length),
+                    (length == 1 ? kMinSubmatchGuessesSingleChar : kMinSubmatchGuessesMultiChar) + 1);
+    };
 
-    bool allDigits = true;
-    for (const auto &ch : p) {
-        if (!ch.isDigit()) {
-            allDigits = false;
-            break;
+    size_t next = 0;
+    for (int k = 0; k < n; ++k) {
+        for (; next < matches.size() && matches[next].j == k; ++next) {
+            const auto &m = matches[next];
+            if (m.i == 0) {
+                update(m.i, m.j, m.guesses, false, 1);
+                continue;
+            }
+            for (int l = 1; l <= n - 1; ++l) {
+                if (cell(m.i - 1, l).set)
+                    update(m.i, m.j, m.guesses, false, l + 1);
+            }
+        }
+
+        update(0, k, bruteforceGuesses(k + 1), true, 1);
+        for (int i = 1; i <= k; ++i) {
+            for (int l = 1; l <= n - 1; ++l) {
+                const auto &before = cell(i - 1, l);
+                // Two bruteforce runs in a row are just a longer one.
+                if (before.set && !before.bruteforce)
+                    update(i, k, bruteforceGuesses(k - i + 1), true, l + 1);
+            }
         }
     }
-    if (allDigits && p.size() <= 10)
-        return true;
 
-    return false;
+    auto guesses = std::numeric_limits<double>::infinity();
+    for (int l = 1; l <= n; ++l) {
+        if (cell(n - 1, l).set)
+            guesses = qMin(guesses, cell(n - 1, l).total);
+    }
+    return guesses;
 }
 
 QString strengthLabelForScore(int score)
@@ -93,60 +603,8 @@ PasswordStrength evaluatePasswordStrength(const QString &password)
     if (password.isEmpty())
         return {0, "极弱"};
 
-    if (isCommonWeakPassword(password))
-        return {0, "极弱"};
-
-    bool hasLower = false;
-    bool hasUpper = false;
-    bool hasDigit = false;
-    bool hasSymbol = false;
-    int uniqueChars = 0;
-
-    {
-        QSet<QChar> uniq;
-        for (const auto &ch : password) {
-            if (ch.isLower())
-                hasLower = true;
-            else if (ch.isUpper())
-                hasUpper = true;
-            else if (ch.isDigit())
-                hasDigit = true;
-            else
-                hasSymbol = true;
-            uniq.insert(ch);
-        }
-        uniqueChars = uniq.size();
-    }
-
-    const int length = password.size();
-    const int classes = (hasLower ? 1 : 0) + (hasUpper ? 1 : 0) + (hasDigit ? 1 : 0) + (hasSymbol ? 1 : 0);
-
-    int score = 0;
-
-    score += qMin(length * 4, 40);
-    score += classes * 10;
-    if (classes >= 3)
-        score += 10;
-
-    if (length >= 16)
-        score += 15;
-    else if (length >= 12)
-        score += 10;
-    else if (length >= 8)
-        score += 5;
-
-    if (uniqueChars <= qMax(2, length / 4))
-        score -= 15;
-
-    if (isAllSameChar(password))
-        score -= 30;
-    if (isSequentialChars(password))
-        score -= 20;
-
-    if (length < 8)
-        score = qMin(score, 25);
-
-    score = qBound(0, score, 100);
+    const auto guesses = minimumGuesses(password.left(kMaxLength).toStdU16String(), QDate::currentDate().year());
+    const auto magnitude = qBound(0.0, std::log10(guesses), 100.0 / kScorePerOrderOfMagnitude);
+    const auto score = qBound(0, qRound(magnitude * kScorePerOrderOfMagnitude), 100);
     return {score, strengthLabelForScore(score)};
 }
-
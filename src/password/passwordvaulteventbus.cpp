@@ -0,0 +1,68 @@
+#include "passwordvaulteventbus.h"
+
+#include <utility>
+
+PasswordVaultEventBus *PasswordVaultEventBus::instance()
+{
+    static auto *bus = new PasswordVaultEventBus();
+    return bus;
+}
+
+PasswordVaultEventBus::PasswordVaultEventBus(QObject *parent) : QObject(parent)
+{
+    qRegisterMetaType<PasswordVaultChangeSet>();
+    flushTimer_.setSingleShot(true);
+    flushTimer_.setInterval(0);
+    connect(&flushTimer_, &QTimer::timeout, this, &PasswordVaultEventBus::flush);
+}
+
+void PasswordVaultEventBus::publishEntryUpserted(qint64 entryId)
+{
+    if (!pending_.removedEntries.contains(entryId))
+        pending_.upsertedEntries.insert(entryId);
+    schedule();
+}
+
+void PasswordVaultEventBus::publishEntryRemoved(qint64 entryId)
+{
+    pending_.upsertedEntries.remove(entryId);
+    pending_.retaggedEntries.remove(entryId);
+    pending_.removedEntries.insert(entryId);
+    schedule();
+}
+
+void PasswordVaultEventBus::publishGroupChanged(qint64 groupId)
+{
+    pending_.changedGroups.insert(groupId);
+    schedule();
+}
+
+void PasswordVaultEventBus::publishEntryRetagged(qint64 entryId)
+{
+    if (!pending_.removedEntries.contains(entryId))
+        pending_.retaggedEntries.insert(entryId);
+    schedule();
+}
+
+void PasswordVaultEventBus::publishEntriesReset()
+{
+    pending_.entriesReset = true;
+    schedule();
+}
+
+void PasswordVaultEventBus::flush()
+{
+    flushTimer_.stop();
+    if (pending_.isEmpty())
+        return;
+
+    // Swap first: a subscriber that writes to the vault starts the next batch rather than extending this one.
+    const auto changes = std::exchange(pending_, PasswordVaultChangeSet());
+    emit changed(changes);
+}
+
+void PasswordVaultEventBus::schedule()
+{
+    if (!flushTimer_.isActive())
+        flushTimer_.start();
+}
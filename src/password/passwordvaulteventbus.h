@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QMetaType>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+
+// What changed in the vault since the last delivery. Ids are merged, so an entry added and then deleted
+// within one tick only shows up in removedEntries.
+struct PasswordVaultChangeSet final
+{
+    QSet<qint64> upsertedEntries;
+    QSet<qint64> removedEntries;
+    QSet<qint64> changedGroups;   // created, renamed or deleted
+    QSet<qint64> retaggedEntries; // entries whose tag set changed; their tags may be new to the vocabulary
+    bool entriesReset = false; // bulk write outside PasswordRepository (CSV import); treat every entry as changed
+
+    bool touchesEntries() const { return entriesReset || !upsertedEntries.isEmpty() || !removedEntries.isEmpty(); }
+    bool isEmpty() const { return !touchesEntries() && changedGroups.isEmpty() && retaggedEntries.isEmpty(); }
+};
+
+Q_DECLARE_METATYPE(PasswordVaultChangeSet)
+
+// Process-wide notifications of committed vault writes. PasswordRepository publishes after each commit;
+// models, caches and dialogs subscribe to changed() instead of being refreshed by hand. Everything
+// published during one event-loop iteration is delivered as a single change set. GUI thread only.
+class PasswordVaultEventBus final : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PasswordVaultEventBus *instance();
+
+    void publishEntryUpserted(qint64 entryId);
+    void publishEntryRemoved(qint64 entryId);
+    void publishGroupChanged(qint64 groupId);
+    void publishEntryRetagged(qint64 entryId);
+    void publishEntriesReset();
+
+    // Delivers whatever is pending right away instead of on the next tick.
+    void flush();
+
+signals:
+    void changed(const PasswordVaultChangeSet &changes);
+
+private:
+    explicit PasswordVaultEventBus(QObject *parent = nullptr);
+
+    void schedule();
+
+    PasswordVaultChangeSet pending_;
+    QTimer flushTimer_;
+};
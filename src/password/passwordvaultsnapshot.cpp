@@ -0,0 +1,128 @@
+#include "passwordvaultsnapshot.h"
+
+#include "passworddatabase.h"
+
+#include <QSqlQuery>
+
+#include <optional>
+
+namespace {
+
+struct SnapshotCache final
+{
+    std::shared_ptr<const PasswordVaultSnapshot> snapshot;
+    QString databaseName;
+    qint64 dataVersion = -1;
+    quint64 writes = 0;        // bumped by invalidate()
+    quint64 writesAtBuild = 0;
+    quint64 revision = 0;
+};
+
+SnapshotCache &cache()
+{
+    static SnapshotCache instance;
+    return instance;
+}
+
+// Changes whenever another connection commits; our own writes are tracked by invalidate().
+std::optional<qint64> dataVersion(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    if (!query.exec("PRAGMA data_version") || !query.next())
+        return std::nullopt;
+    return query.value(0).toLongLong();
+}
+
+} // namespace
+
+std::shared_ptr<const PasswordVaultSnapshot> PasswordVaultSnapshot::current()
+{
+    auto database = PasswordDatabase::db();
+    if (!database.isOpen())
+        return std::make_shared<const PasswordVaultSnapshot>();
+
+    auto &c = cache();
+    const auto version = dataVersion(database);
+    if (c.snapshot && version && version.value() == c.dataVersion && c.writes == c.writesAtBuild
+        && c.databaseName == database.databaseName())
+        return c.snapshot;
+
+    auto snapshot = load(database);
+    if (!snapshot)
+        return std::make_shared<const PasswordVaultSnapshot>();
+
+    snapshot->revision_ = ++c.revision;
+    c.snapshot = std::move(snapshot);
+    c.databaseName = database.databaseName();
+    c.dataVersion = version.value_or(-1);
+    c.writesAtBuild = c.writes;
+    return c.snapshot;
+}
+
+void PasswordVaultSnapshot::invalidate()
+{
+    cache().writes++;
+}
+
+QVector<int> PasswordVaultSnapshot::rowsForHost(const QString &host) const
+{
+    const auto hostId = entries_.findHost(host);
+    if (hostId <= 0 || hostId >= rowsByHostId_.size())
+        return {};
+    return rowsByHostId_.at(hostId);
+}
+
+std::shared_ptr<PasswordVaultSnapshot> PasswordVaultSnapshot::load(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare(R"sql(
+        SELECT
+            e.id,
+            e.group_id,
+            e.entry_type,
+            e.title,
+            e.username,
+            e.url,
+            e.category,
+            e.created_at,
+            e.updated_at,
+            GROUP_CONCAT(t.name, ',') AS tags_csv
+        FROM password_entries e
+        LEFT JOIN entry_tags et ON et.entry_id = e.id
+        LEFT JOIN tags t ON t.id = et.tag_id
+        GROUP BY e.id
+        ORDER BY e.updated_at DESC
+    )sql");
+    if (!query.exec())
+        return nullptr;
+
+    auto snapshot = std::make_shared<PasswordVaultSnapshot>();
+    auto &store = snapshot->entries_;
+    while (query.next()) {
+        PasswordEntry entry;
+        entry.id = query.value(0).toLongLong();
+        entry.groupId = query.value(1).toLongLong();
+        entry.type = passwordEntryTypeFromInt(query.value(2).toInt());
+        entry.title = query.value(3).toString();
+        entry.username = query.value(4).toString();
+        entry.url = query.value(5).toString();
+        entry.category = query.value(6).toString();
+        entry.createdAt = QDateTime::fromSecsSinceEpoch(query.value(7).toLongLong());
+        entry.updatedAt = QDateTime::fromSecsSinceEpoch(query.value(8).toLongLong());
+        const auto tagsCsv = query.value(9).toString();
+        if (!tagsCsv.trimmed().isEmpty()) {
+            for (const auto &tag : tagsCsv.split(',', Qt::SkipEmptyParts))
+                entry.tags.push_back(tag.trimmed());
+        }
+
+        const auto row = store.append(entry);
+        snapshot->rowById_.insert(entry.id, row);
+        const auto hostId = store.row(row).hostId();
+        if (hostId >= snapshot->rowsByHostId_.size())
+            snapshot->rowsByHostId_.resize(hostId + 1);
+        snapshot->rowsByHostId_[hostId].push_back(row);
+    }
+
+    return snapshot;
+}
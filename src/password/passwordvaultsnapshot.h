@@ -0,0 +1,39 @@
+#pragma once
+
+#include "passwordentrystore.h"
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+class QSqlDatabase;
+
+// Immutable, shared view of the entry list (no secrets) on PasswordDatabase::db(). current() hands out the
+// same instance until the vault revision moves: a write through PasswordRepository (invalidate()) or a
+// commit from another connection such as the CSV import worker (PRAGMA data_version). Readers keep the
+// shared_ptr as long as they like; a rebuild never touches a snapshot someone still holds.
+// GUI thread only, like PasswordDatabase::db().
+class PasswordVaultSnapshot final
+{
+public:
+    static std::shared_ptr<const PasswordVaultSnapshot> current();
+    // Call after writing entries or tags on PasswordDatabase::db() without going through PasswordRepository.
+    static void invalidate();
+
+    quint64 revision() const { return revision_; }
+    const PasswordEntryStore &entries() const { return entries_; }
+
+    int rowForId(qint64 entryId) const { return rowById_.value(entryId, -1); }
+    // Rows whose URL host equals `host` (as returned by PasswordUrl::hostFromUrl), ascending.
+    QVector<int> rowsForHost(const QString &host) const;
+
+private:
+    static std::shared_ptr<PasswordVaultSnapshot> load(QSqlDatabase &database);
+
+    quint64 revision_ = 0;
+    PasswordEntryStore entries_;
+    QHash<qint64, int> rowById_;
+    QVector<QVector<int>> rowsByHostId_;
+};
@@ -5,6 +5,11 @@
 namespace PasswordWebLoginMatcher {
 
 MatchResult match(const QVector<PasswordEntry> &entries, const QString &pageUrl, const QString &username)
+{
+    return match(PasswordEntryStore::fromEntries(entries), pageUrl, username);
+}
+
+MatchResult match(const PasswordEntryStore &entries, const QString &pageUrl, const QString &username)
 {
     MatchResult result;
 
@@ -14,15 +19,17 @@ MatchResult match(const QVector<PasswordEntry> &entries, const QString &pageUrl,
 
     const auto user = username.trimmed();
 
-    for (const auto &e : entries) {
-        if (e.type != PasswordEntryType::WebLogin)
+    for (int row = 0; row < entries.size(); ++row) {
+        const auto view = entries.row(row);
+        if (view.type() != PasswordEntryType::WebLogin)
             continue;
-        if (!PasswordUrl::urlMatchesHost(e.url, result.host))
+        if (view.host().isEmpty() || !PasswordUrl::hostsEqual(view.host(), result.host))
             continue;
 
+        const auto e = view.toEntry();
         result.hostEntries.push_back(e);
 
-        const auto entryUser = e.username.trimmed();
+        const auto entryUser = view.username().trimmed();
         if (!user.isEmpty()) {
             if (entryUser.compare(user, Qt::CaseInsensitive) == 0)
                 result.userEntries.push_back(e);
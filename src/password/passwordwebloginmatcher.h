@@ -1,6 +1,7 @@
 #pragma once
 
 #include "passwordentry.h"
+#include "passwordentrystore.h"
 
 #include <QString>
 #include <QVector>
@@ -14,6 +15,8 @@ struct MatchResult final
     QVector<PasswordEntry> userEntries;
 };
 
+// Hosts are read from the store's interned column, so no entry URL is parsed per match.
+MatchResult match(const PasswordEntryStore &entries, const QString &pageUrl, const QString &username);
 MatchResult match(const QVector<PasswordEntry> &entries, const QString &pageUrl, const QString &username);
 
 } // namespace PasswordWebLoginMatcher
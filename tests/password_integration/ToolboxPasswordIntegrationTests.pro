@@ -1,4 +1,4 @@
-QT += core testlib sql network
+QT += core gui widgets testlib sql network concurrent
 
 CONFIG += c++17 console utf8_source
 
@@ -12,22 +12,41 @@ SOURCES += \
     tst_password_integration.cpp \
     ../../src/core/apppaths.cpp \
     ../../src/core/crypto.cpp \
+    ../../src/core/progresschannel.cpp \
     ../../src/password/passworddatabase.cpp \
     ../../src/password/passwordvault.cpp \
     ../../src/password/passwordrepository.cpp \
     ../../src/password/passwordcsv.cpp \
     ../../src/password/passwordcsvimportworker.cpp \
+    ../../src/password/passwordsimilarity.cpp \
     ../../src/password/passwordstrength.cpp \
     ../../src/password/passwordgenerator.cpp \
     ../../src/password/passwordurl.cpp \
     ../../src/password/passwordgraph.cpp \
     ../../src/password/passwordwebloginmatcher.cpp \
     ../../src/password/passwordfaviconservice.cpp \
-    ../../src/password/passwordhealthworker.cpp
+    ../../src/password/passwordhealthworker.cpp \
+    ../../src/password/passwordpwnedfilter.cpp \
+    ../../src/password/passwordpwnedofflinedb.cpp \
+    ../../src/password/passwordpwnedofflineimporter.cpp \
+    ../../src/password/passwordpwnedrangeblob.cpp \
+    ../../src/password/passwordpwnedrangefetcher.cpp \
+    ../../src/password/passwordhealthmodel.cpp \
+    ../../src/password/passwordentrymodel.cpp \
+    ../../src/password/passwordentrystore.cpp \
+    ../../src/password/passwordvaultsnapshot.cpp \
+    ../../src/password/passwordvaulteventbus.cpp \
+    ../../src/password/passwordfilterengine.cpp \
+    ../../src/password/passwordsearchindex.cpp \
+    ../../src/password/passwordpinyin.cpp \
+    ../../src/password/passwordgroupmodel.cpp
 
 HEADERS += \
+    localhttpserver.h \
+    localpwnedrangeserver.h \
     ../../src/core/apppaths.h \
     ../../src/core/crypto.h \
+    ../../src/core/progresschannel.h \
     ../../src/password/passworddatabase.h \
     ../../src/password/passwordentry.h \
     ../../src/password/passwordgroup.h \
@@ -35,6 +54,7 @@ HEADERS += \
     ../../src/password/passwordvault.h \
     ../../src/password/passwordcsv.h \
     ../../src/password/passwordcsvimportworker.h \
+    ../../src/password/passwordsimilarity.h \
     ../../src/password/passwordstrength.h \
     ../../src/password/passwordgenerator.h \
     ../../src/password/passwordurl.h \
@@ -42,4 +62,18 @@ HEADERS += \
     ../../src/password/passwordwebloginmatcher.h \
     ../../src/password/passwordfaviconservice.h \
     ../../src/password/passwordhealth.h \
-    ../../src/password/passwordhealthworker.h
+    ../../src/password/passwordhealthworker.h \
+    ../../src/password/passwordpwnedfilter.h \
+    ../../src/password/passwordpwnedofflinedb.h \
+    ../../src/password/passwordpwnedofflineimporter.h \
+    ../../src/password/passwordpwnedrangeblob.h \
+    ../../src/password/passwordpwnedrangefetcher.h \
+    ../../src/password/passwordhealthmodel.h \
+    ../../src/password/passwordentrymodel.h \
+    ../../src/password/passwordentrystore.h \
+    ../../src/password/passwordvaultsnapshot.h \
+    ../../src/password/passwordvaulteventbus.h \
+    ../../src/password/passwordfilterengine.h \
+    ../../src/password/passwordsearchindex.h \
+    ../../src/password/passwordpinyin.h \
+    ../../src/password/passwordgroupmodel.h
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+
+#include <functional>
+#include <utility>
+
+// In-process HTTP/1.1 stand-in for tests: one request per connection, answered by `handler` on the thread that
+// owns the server (the test's event loop, including nested loops such as QSignalSpy::wait).
+class LocalHttpServer final
+{
+public:
+    struct Request final
+    {
+        QByteArray method;
+        QByteArray path;
+        QHash<QByteArray, QByteArray> headers; // lower-cased names
+    };
+
+    struct Response final
+    {
+        int status = 200;
+        QByteArray body;
+        QList<QPair<QByteArray, QByteArray>> headers;
+    };
+
+    using Handler = std::function<Response(const Request &)>;
+
+    explicit LocalHttpServer(Handler handler) : handler_(std::move(handler))
+    {
+        QObject::connect(&server_, &QTcpServer::newConnection, &server_, [this]() {
+            while (auto *socket = server_.nextPendingConnection()) {
+                QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() { serve(socket); });
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, [this, socket]() {
+                    buffers_.remove(socket);
+                    socket->deleteLater();
+                });
+            }
+        });
+    }
+
+    bool listen() { return server_.listen(QHostAddress::LocalHost, 0); }
+
+    QUrl baseUrl() const { return QUrl(QString("http://127.0.0.1:%1/").arg(server_.serverPort())); }
+    // Host key as PasswordFaviconService reports it.
+    QString host() const { return QString("127.0.0.1:%1").arg(server_.serverPort()); }
+
+    const QList<Request> &requests() const { return requests_; }
+
+private:
+    static QByteArray reasonPhrase(int status)
+    {
+        switch (status) {
+        case 200:
+            return "OK";
+        case 304:
+            return "Not Modified";
+        case 404:
+            return "Not Found";
+        case 429:
+            return "Too Many Requests";
+        default:
+            return "Status";
+        }
+    }
+
+    void serve(QTcpSocket *socket)
+    {
+        auto &buffer = buffers_[socket];
+        buffer += socket->readAll();
+        const auto headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0)
+            return;
+
+        const auto lines = buffer.left(headerEnd).split('\n');
+        buffers_.remove(socket);
+
+        Request request;
+        const auto requestLine = lines.value(0).trimmed().split(' ');
+        request.method = requestLine.value(0);
+        request.path = requestLine.value(1);
+        for (int i = 1; i < lines.size(); ++i) {
+            const auto colon = lines.at(i).indexOf(':');
+            if (colon > 0)
+                request.headers.insert(lines.at(i).left(colon).trimmed().toLower(), lines.at(i).mid(colon + 1).trimmed());
+        }
+        requests_.push_back(request);
+
+        const auto response = handler_(request);
+        const auto body = response.status == 304 ? QByteArray() : response.body;
+
+        QByteArray out = "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasonPhrase(response.status) + "\r\n";
+        for (const auto &header : response.headers)
+            out += header.first + ": " + header.second + "\r\n";
+        out += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        out += "Connection: close\r\n\r\n";
+        out += body;
+
+        socket->write(out);
+        socket->disconnectFromHost();
+    }
+
+    Handler handler_;
+    QHash<QTcpSocket *, QByteArray> buffers_;
+    QList<Request> requests_;
+    QTcpServer server_; // last, so its sockets go away while the members above are still alive
+};
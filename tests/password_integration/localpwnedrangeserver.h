@@ -0,0 +1,79 @@
+#pragma once
+
+#include "localhttpserver.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QMap>
+#include <QUrl>
+
+// Stand-in for the Pwned Passwords range API on top of LocalHttpServer, for tests and offline throughput runs.
+// Any of the 16^5 prefixes answers with `padding` synthetic suffixes (count 0, as Add-Padding does) mixed with
+// the real suffixes of the passwords registered through addPassword(). failNext() injects transient errors.
+class LocalPwnedRangeServer final
+{
+public:
+    explicit LocalPwnedRangeServer(int padding = 800)
+        : padding_(padding), server_([this](const LocalHttpServer::Request &req) { return answer(req); })
+    {
+    }
+
+    bool listen() { return server_.listen(); }
+    QUrl rangeBaseUrl() const { return server_.baseUrl().resolved(QUrl("range/")); }
+    const QList<LocalHttpServer::Request> &requests() const { return server_.requests(); }
+
+    static QByteArray sha1Hex(const QByteArray &password)
+    {
+        return QCryptographicHash::hash(password, QCryptographicHash::Sha1).toHex().toUpper();
+    }
+
+    void addPassword(const QByteArray &password, qint64 count)
+    {
+        const auto hex = sha1Hex(password);
+        breached_[hex.left(5)].insert(hex.mid(5), count);
+    }
+
+    // The next `times` requests for `prefix` get `status` (and an empty body) instead of the range.
+    void failNext(const QByteArray &prefix, int times, int status = 503)
+    {
+        failures_.insert(prefix, qMakePair(times, status));
+    }
+
+private:
+    LocalHttpServer::Response answer(const LocalHttpServer::Request &req)
+    {
+        LocalHttpServer::Response res;
+        const QByteArray route = "/range/";
+        const auto prefix = req.path.startsWith(route) ? req.path.mid(route.size()).toUpper() : QByteArray();
+        if (prefix.size() != 5) {
+            res.status = 404;
+            return res;
+        }
+
+        auto failure = failures_.find(prefix);
+        if (failure != failures_.end() && failure->first > 0) {
+            --failure->first;
+            res.status = failure->second;
+            return res;
+        }
+
+        // Sorted by suffix, like the real service.
+        QMap<QByteArray, qint64> lines;
+        for (int i = 0; i < padding_; ++i)
+            lines.insert(sha1Hex(prefix + QByteArray::number(i)).mid(5), 0);
+        const auto breached = breached_.value(prefix);
+        for (auto it = breached.cbegin(); it != breached.cend(); ++it)
+            lines.insert(it.key(), it.value());
+
+        for (auto it = lines.cbegin(); it != lines.cend(); ++it)
+            res.body += it.key() + ':' + QByteArray::number(it.value()) + "\r\n";
+        res.headers = {{"Content-Type", "text/plain"}};
+        return res;
+    }
+
+    int padding_ = 0;
+    QHash<QByteArray, QHash<QByteArray, qint64>> breached_; // prefix -> suffix -> count
+    QHash<QByteArray, QPair<int, int>> failures_;           // prefix -> (remaining, status)
+    LocalHttpServer server_;
+};
@@ -1,27 +1,50 @@
 #include "core/apppaths.h"
+#include "core/progresschannel.h"
 #include "password/passwordcsv.h"
 #include "password/passwordcsvimportworker.h"
 #include "password/passworddatabase.h"
+#include "password/passwordentrymodel.h"
+#include "password/passwordentrystore.h"
 #include "password/passwordfaviconservice.h"
+#include "password/passwordfilterengine.h"
 #include "password/passwordgenerator.h"
 #include "password/passwordgraph.h"
+#include "password/passwordgroupmodel.h"
+#include "password/passwordhealthmodel.h"
 #include "password/passwordhealthworker.h"
+#include "password/passwordpinyin.h"
+#include "password/passwordpwnedfilter.h"
+#include "password/passwordpwnedofflinedb.h"
+#include "password/passwordpwnedofflineimporter.h"
+#include "password/passwordpwnedrangeblob.h"
 #include "password/passwordrepository.h"
+#include "password/passwordsearchindex.h"
+#include "password/passwordsimilarity.h"
 #include "password/passwordstrength.h"
 #include "password/passwordurl.h"
+#include "password/passwordvaulteventbus.h"
+#include "password/passwordvaultsnapshot.h"
 #include "password/passwordwebloginmatcher.h"
 #include "password/passwordvault.h"
 
+#include "localhttpserver.h"
+#include "localpwnedrangeserver.h"
+
+#include <QAbstractItemModelTester>
 #include <QBuffer>
 #include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
 #include <QImage>
+#include <QMap>
 #include <QSignalSpy>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QStandardPaths>
 #include <QTemporaryDir>
+#include <QThread>
 #include <QtTest>
 
 class PasswordIntegrationTests final : public QObject
@@ -78,6 +101,30 @@ private slots:
         QVERIFY(strong.score >= 60);
     }
 
+    void strength_patterns()
+    {
+        // Dictionary word with l33t substitutions, a capital and a recent year.
+        QVERIFY(evaluatePasswordStrength("P@ssw0rd2024").score < 40);
+        QVERIFY(evaluatePasswordStrength("qwertyuiop").score < 40);
+        QVERIFY(evaluatePasswordStrength("1qaz2wsx").score < 40);
+        QVERIFY(evaluatePasswordStrength("abcabcabc").score < 40);
+        QVERIFY(evaluatePasswordStrength("19880315").score < 40);
+        QVERIFY(evaluatePasswordStrength("woaini1314").score < 40);
+        QVERIFY(evaluatePasswordStrength("drowssap").score < 40);
+
+        QVERIFY(evaluatePasswordStrength("correcthorsebatterystaple").score >= 60);
+        QVERIFY(evaluatePasswordStrength("kX9#mQ2$vL7@pR4!").score >= 80);
+
+        // Runs on every keystroke in the entry dialog.
+        const QStringList samples = {"kX9#mQ2$vL7@pR4!aB3c", "aaaaaaaaaaaaaaaaaaaa", "password123password1",
+                                     "1qaz2wsx3edc4rfv5tgb"};
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < 1000; ++i)
+            evaluatePasswordStrength(samples.at(i % samples.size()));
+        QVERIFY2(timer.elapsed() < 1000, qPrintable(QString::number(timer.elapsed())));
+    }
+
     void url_host_match_basics()
     {
         QCOMPARE(PasswordUrl::hostFromUrl("https://example.com/login"), QString("example.com"));
@@ -576,6 +623,618 @@ private slots:
         QVERIFY(foundWebService);
     }
 
+    void entry_store_columns()
+    {
+        QVector<PasswordEntry> entries;
+        for (int i = 0; i < 100; ++i) {
+            PasswordEntry e;
+            e.id = i + 1;
+            e.groupId = 1 + i % 3;
+            e.type = i % 2 ? PasswordEntryType::WebLogin : PasswordEntryType::ServerSsh;
+            e.title = QString("站点 %1").arg(i);
+            e.username = i % 5 ? QString("user%1").arg(i) : QString();
+            e.url = QString("https://www.host%1.example.com/login").arg(i % 4);
+            e.category = i % 2 ? "工作" : "个人";
+            e.tags = QStringList{"常用", i % 2 ? "web" : "ssh"};
+            e.createdAt = QDateTime::fromSecsSinceEpoch(1700000000 + i);
+            e.updatedAt = QDateTime::fromSecsSinceEpoch(1700000500 + i);
+            entries.push_back(e);
+        }
+
+        const auto store = PasswordEntryStore::fromEntries(entries);
+        QCOMPARE(store.size(), entries.size());
+        // vocabularies hold each distinct value once (plus the empty id 0)
+        QCOMPARE(store.categoryCount(), 3);
+        QCOMPARE(store.tagCount(), 4);
+        QCOMPARE(store.hostCount(), 5);
+
+        for (int row = 0; row < store.size(); ++row) {
+            const auto &e = entries.at(row);
+            const auto view = store.row(row);
+            QCOMPARE(view.id(), e.id);
+            QCOMPARE(view.groupId(), e.groupId);
+            QCOMPARE(static_cast<int>(view.type()), static_cast<int>(e.type));
+            QCOMPARE(view.title().toString(), e.title);
+            QCOMPARE(view.username().toString(), e.username);
+            QCOMPARE(view.url().toString(), e.url);
+            QCOMPARE(view.category(), e.category);
+            QCOMPARE(view.tags(), e.tags);
+            QCOMPARE(view.host(), PasswordUrl::hostFromUrl(e.url));
+            QCOMPARE(view.updatedAtSecs(), e.updatedAt.toSecsSinceEpoch());
+
+            const auto back = store.entryAt(row);
+            QCOMPARE(back.title, e.title);
+            QCOMPARE(back.createdAt, e.createdAt);
+        }
+
+        // scans over the store agree with the entry-list versions
+        const auto match = PasswordWebLoginMatcher::match(store, "https://host1.example.com/", "user9");
+        const auto legacy = PasswordWebLoginMatcher::match(entries, "https://host1.example.com/", "user9");
+        QCOMPARE(match.hostEntries.size(), legacy.hostEntries.size());
+        QCOMPARE(match.userEntries.size(), 1);
+        QCOMPARE(match.userEntries.at(0).id, legacy.userEntries.at(0).id);
+
+        const auto graph = PasswordGraph::build(store);
+        QCOMPARE(graph.nodes.size(), PasswordGraph::build(entries).nodes.size());
+    }
+
+    void vault_snapshot_revision()
+    {
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+        PasswordRepository repo(&vault);
+
+        PasswordEntrySecrets s;
+        s.entry.title = "GitHub";
+        s.entry.url = "https://github.com/login";
+        s.password = "pw";
+        QVERIFY(repo.addEntry(s));
+
+        const auto first = repo.snapshot();
+        QCOMPARE(first->entries().size(), 1);
+        QCOMPARE(repo.snapshot().get(), first.get()); // unchanged vault: same instance, no query
+        QCOMPARE(first->rowsForHost("github.com"), QVector<int>{0});
+
+        s.entry.title = "GitLab";
+        s.entry.url = "https://gitlab.com";
+        QVERIFY(repo.addEntry(s));
+        const auto second = repo.snapshot();
+        QVERIFY(second.get() != first.get());
+        QVERIFY(second->revision() > first->revision());
+        QCOMPARE(second->entries().size(), 2);
+        QCOMPARE(first->entries().size(), 1); // holders of the old revision are untouched
+
+        // a commit from another connection moves PRAGMA data_version
+        const auto connectionName = QString("toolbox_password_snapshot_test");
+        {
+            auto other = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+            other.setDatabaseName(PasswordDatabase::db().databaseName());
+            QVERIFY(other.open());
+            QSqlQuery q(other);
+            QVERIFY(q.exec("UPDATE password_entries SET title = 'GitHub Enterprise' WHERE title = 'GitHub'"));
+            other.close();
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+
+        const auto third = repo.snapshot();
+        QVERIFY(third.get() != second.get());
+        const auto row = third->rowsForHost("github.com").value(0, -1);
+        QVERIFY(row >= 0);
+        QCOMPARE(third->entries().row(row).title().toString(), QString("GitHub Enterprise"));
+    }
+
+    void vault_event_bus_batches()
+    {
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+        PasswordRepository repo(&vault);
+
+        auto *bus = PasswordVaultEventBus::instance();
+        bus->flush(); // anything left over from earlier tests
+        QSignalSpy spy(bus, &PasswordVaultEventBus::changed);
+
+        PasswordEntrySecrets s;
+        s.entry.title = "keep";
+        s.entry.tags = QStringList{"t"};
+        s.password = "pw";
+        QVERIFY(repo.addEntry(s));
+        s.entry.title = "drop";
+        s.entry.tags.clear();
+        QVERIFY(repo.addEntry(s));
+        const auto group = repo.createGroup(1, "新分组");
+        QVERIFY(group.has_value());
+
+        qint64 keepId = 0;
+        qint64 dropId = 0;
+        for (const auto &e : repo.listEntries()) {
+            if (e.title == "keep")
+                keepId = e.id;
+            else
+                dropId = e.id;
+        }
+        QVERIFY(repo.deleteEntry(dropId));
+
+        QCOMPARE(spy.count(), 0); // delivered on the next event-loop iteration, as one batch
+        QTRY_COMPARE(spy.count(), 1);
+        const auto changes = qvariant_cast<PasswordVaultChangeSet>(spy.takeFirst().at(0));
+        QCOMPARE(changes.upsertedEntries, QSet<qint64>{keepId});
+        QCOMPARE(changes.removedEntries, QSet<qint64>{dropId});
+        QCOMPARE(changes.changedGroups, QSet<qint64>{group.value()});
+        QCOMPARE(changes.retaggedEntries, QSet<qint64>{keepId});
+        QVERIFY(!changes.entriesReset);
+
+        // saving an entry with the tags it already has is not a tag change
+        auto kept = repo.loadEntry(keepId);
+        QVERIFY(kept.has_value());
+        kept->entry.title = "kept";
+        QVERIFY(repo.updateEntry(kept.value()));
+        bus->flush();
+        QCOMPARE(spy.count(), 1);
+        QVERIFY(qvariant_cast<PasswordVaultChangeSet>(spy.takeFirst().at(0)).retaggedEntries.isEmpty());
+
+        bus->publishEntriesReset();
+        bus->flush();
+        QCOMPARE(spy.count(), 1);
+        QVERIFY(qvariant_cast<PasswordVaultChangeSet>(spy.takeFirst().at(0)).touchesEntries());
+    }
+
+    void filter_engine_mask()
+    {
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+
+        PasswordRepository repo(&vault);
+        PasswordEntrySecrets a;
+        a.entry.title = "GitHub";
+        a.entry.username = "alice";
+        a.entry.url = "https://github.com";
+        a.entry.tags = {"Work", "Dev"};
+        a.password = "pwd-a";
+        QVERIFY(repo.addEntry(a));
+
+        PasswordEntrySecrets b;
+        b.entry.title = "Bank";
+        b.entry.username = "bob";
+        b.entry.type = PasswordEntryType::DatabaseCredential;
+        b.entry.category = "Finance";
+        b.password = "pwd-b";
+        QVERIFY(repo.addEntry(b));
+
+        PasswordEntryModel model;
+        const auto rows = model.filterRows();
+        QCOMPARE(rows.size(), 2);
+
+        PasswordFilterCriteria criteria;
+        criteria.searchText = QString("GITHUB").toCaseFolded();
+        QCOMPARE(PasswordFilterEngine::evaluate(rows, criteria).acceptedRows.count(true), 1);
+
+        criteria = {};
+        criteria.requiredTags = {QString("work").toCaseFolded(), QString("DEV").toCaseFolded()};
+        QCOMPARE(PasswordFilterEngine::evaluate(rows, criteria).acceptedRows.count(true), 1);
+
+        criteria = {};
+        criteria.entryType = static_cast<int>(PasswordEntryType::DatabaseCredential);
+        criteria.category = "Finance";
+        QCOMPARE(PasswordFilterEngine::evaluate(rows, criteria).acceptedRows.count(true), 1);
+
+        // search text also matches the type label, the category and single tags
+        criteria = {};
+        criteria.searchText = QString("finance").toCaseFolded();
+        QCOMPARE(PasswordFilterEngine::evaluate(rows, criteria).acceptedRows.count(true), 1);
+        criteria.searchText = QString("dev").toCaseFolded();
+        QCOMPARE(PasswordFilterEngine::evaluate(rows, criteria).acceptedRows.count(true), 1);
+        criteria.searchText = passwordEntryTypeLabel(PasswordEntryType::DatabaseCredential).toCaseFolded();
+        QCOMPARE(PasswordFilterEngine::evaluate(rows, criteria).acceptedRows.count(true), 1);
+        criteria.category = "未分类";
+        QCOMPARE(PasswordFilterEngine::evaluate(rows, criteria).acceptedRows.count(true), 0);
+
+        // large snapshots go through the thread pool
+        QVector<PasswordEntry> entries;
+        for (int i = 0; i < 20000; ++i) {
+            PasswordEntry entry;
+            entry.id = i + 1;
+            entry.groupId = (i % 2 == 0) ? 1 : 2;
+            entry.title = QString("entry %1").arg(i);
+            entries.push_back(entry);
+        }
+        const auto many = PasswordEntryModel::FilterRows::fromStore(PasswordEntryStore::fromEntries(entries));
+
+        PasswordGroupModel groups;
+        groups.setGroups({{1, 0, "默认"}, {2, 0, "工作"}});
+
+        PasswordFilterEngine engine;
+        QSignalSpy spyMask(&engine, &PasswordFilterEngine::maskReady);
+        engine.setGroupSubtree(groups.subtree(2));
+        engine.setRows(many);
+        QVERIFY(spyMask.wait(5000));
+        const auto mask = spyMask.takeLast().at(0).toBitArray();
+        QCOMPARE(mask.size(), many.size());
+        QCOMPARE(mask.count(true), many.size() / 2);
+    }
+
+    void group_subtree_intervals()
+    {
+        // 1 ─┬─ 2 ─── 4
+        //    └─ 3
+        // 5
+        PasswordGroupModel model;
+        model.setGroups({{1, 0, "a"}, {2, 1, "b"}, {3, 1, "c"}, {4, 2, "d"}, {5, 0, "e"}});
+
+        QVERIFY(model.isInSubtree(4, 1));
+        QVERIFY(model.isInSubtree(4, 2));
+        QVERIFY(model.isInSubtree(2, 2));
+        QVERIFY(!model.isInSubtree(3, 2));
+        QVERIFY(!model.isInSubtree(5, 1));
+        QVERIFY(!model.isInSubtree(1, 4));
+
+        const auto subtree = model.subtree(1);
+        for (qint64 id : {1, 2, 3, 4})
+            QVERIFY(subtree.contains(id));
+        QVERIFY(!subtree.contains(5));
+        QVERIFY(!subtree.contains(42));
+        QVERIFY(PasswordGroupSubtree().contains(42));
+
+        // row numbers back parent()/indexForGroupId() without sibling scans
+        const auto idx = model.indexForGroupId(4);
+        QVERIFY(idx.isValid());
+        QCOMPARE(model.groupIdForIndex(idx.parent()), qint64(2));
+        QCOMPARE(model.groupIdForIndex(model.index(1, 0, model.indexForGroupId(1))), qint64(3));
+    }
+
+    void group_model_incremental()
+    {
+        PasswordGroupModel model;
+        QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+        model.setGroups({{1, 0, "a"}, {2, 1, "b"}, {3, 1, "d"}, {4, 2, "x"}});
+
+        const QPersistentModelIndex tracked(model.indexForGroupId(4));
+        const QPersistentModelIndex sibling(model.indexForGroupId(3));
+        QSignalSpy spyReset(&model, &QAbstractItemModel::modelReset);
+
+        QVERIFY(model.insertGroup({5, 1, "c"}));
+        QCOMPARE(model.indexForGroupId(5).row(), 1); // b, c, d
+        QCOMPARE(sibling.row(), 2);
+
+        QVERIFY(model.renameGroup(2, "z"));
+        QCOMPARE(model.indexForGroupId(2).row(), 2); // c, d, z
+        QVERIFY(tracked.isValid());
+        QCOMPARE(model.groupIdForIndex(tracked), qint64(4));
+        QCOMPARE(model.groupIdForIndex(tracked.parent()), qint64(2));
+
+        QVERIFY(!model.moveGroup(1, 4)); // into its own subtree
+        QVERIFY(model.moveGroup(4, 5));
+        QVERIFY(tracked.isValid());
+        QCOMPARE(model.groupIdForIndex(tracked.parent()), qint64(5));
+        QVERIFY(model.isInSubtree(4, 5));
+        QVERIFY(!model.isInSubtree(4, 2));
+
+        QVERIFY(model.removeGroup(5));
+        QVERIFY(!tracked.isValid());
+        QVERIFY(!model.indexForGroupId(4).isValid());
+        QVERIFY(!model.subtree(1).contains(4));
+        QCOMPARE(model.rowCount(model.indexForGroupId(1)), 2);
+
+        // a deep chain and a wide fan run out of free numbers and force partial relabels; answers stay exact,
+        // and a subtree handed out earlier keeps the numbering it was taken with
+        const auto before = model.subtree(2);
+        for (qint64 id = 100; id < 164; ++id)
+            QVERIFY(model.insertGroup({id, id == 100 ? 2 : id - 1, QString("n%1").arg(id)}));
+        for (qint64 id = 200; id < 264; ++id)
+            QVERIFY(model.insertGroup({id, 1, QString("f%1").arg(id)}));
+        QVERIFY(model.isInSubtree(163, 2));
+        QVERIFY(model.isInSubtree(163, 130));
+        QVERIFY(!model.isInSubtree(130, 163));
+        QVERIFY(!model.isInSubtree(263, 2));
+        QVERIFY(model.isInSubtree(263, 1));
+        QVERIFY(model.subtree(100).contains(163));
+        QVERIFY(!model.subtree(100).contains(200));
+        QVERIFY(!before.contains(163));
+        QVERIFY(before.contains(2));
+
+        QCOMPARE(spyReset.count(), 0);
+    }
+
+    void group_entry_counts()
+    {
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+        PasswordRepository repo(&vault);
+
+        const auto work = repo.createGroup(1, "工作");
+        QVERIFY(work.has_value());
+        const auto team = repo.createGroup(work.value(), "团队");
+        QVERIFY(team.has_value());
+
+        const auto addTo = [&repo](qint64 groupId, const QString &title) {
+            PasswordEntrySecrets s;
+            s.entry.groupId = groupId;
+            s.entry.title = title;
+            s.password = "pw";
+            return repo.addEntry(s);
+        };
+        QVERIFY(addTo(1, "root"));
+        QVERIFY(addTo(work.value(), "w"));
+
+        PasswordGroupModel model;
+        QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+        model.setGroups(repo.listGroups());
+        model.setEntryCounts(repo.entryCountsByGroup());
+        QCOMPARE(model.entryCount(1), 1);
+        QCOMPARE(model.subtreeEntryCount(1), 2);
+        QCOMPARE(model.subtreeEntryCount(team.value()), 0);
+
+        repo.setEntryCountListener([&model](qint64 groupId, int delta) { model.adjustEntryCount(groupId, delta); });
+        QSignalSpy spyChanged(&model, &QAbstractItemModel::dataChanged);
+
+        QVERIFY(addTo(team.value(), "t"));
+        QCOMPARE(model.entryCount(team.value()), 1);
+        QCOMPARE(model.subtreeEntryCount(work.value()), 2);
+        QCOMPARE(model.subtreeEntryCount(1), 3);
+        QCOMPARE(spyChanged.count(), 3); // team, work, 默认
+        QCOMPARE(model.indexForGroupId(work.value()).data(PasswordGroupModel::EntryCountBadgeRole).toString(),
+                 QString("1/2"));
+
+        const auto entries = repo.listEntries();
+        qint64 rootEntryId = 0;
+        qint64 teamEntryId = 0;
+        for (const auto &e : entries) {
+            if (e.title == "root")
+                rootEntryId = e.id;
+            else if (e.title == "t")
+                teamEntryId = e.id;
+        }
+        QVERIFY(rootEntryId > 0 && teamEntryId > 0);
+
+        QVERIFY(repo.moveEntryToGroup(rootEntryId, team.value()));
+        QCOMPARE(model.entryCount(1), 0);
+        QCOMPARE(model.entryCount(team.value()), 2);
+        QCOMPARE(model.subtreeEntryCount(1), 3);
+
+        QVERIFY(repo.deleteEntry(teamEntryId));
+        QCOMPARE(model.entryCount(team.value()), 1);
+        QCOMPARE(model.subtreeEntryCount(work.value()), 2);
+
+        // incremental state agrees with a fresh aggregate
+        PasswordGroupModel fresh;
+        fresh.setGroups(repo.listGroups());
+        fresh.setEntryCounts(repo.entryCountsByGroup());
+        for (qint64 id : {qint64(1), work.value(), team.value()}) {
+            QCOMPARE(model.entryCount(id), fresh.entryCount(id));
+            QCOMPARE(model.subtreeEntryCount(id), fresh.subtreeEntryCount(id));
+        }
+    }
+
+    void search_index_fuzzy()
+    {
+        auto makeEntry = [](qint64 id, const QString &title, const QString &username, const QString &url) {
+            PasswordEntry entry;
+            entry.id = id;
+            entry.title = title;
+            entry.username = username;
+            entry.url = url;
+            return entry;
+        };
+
+        PasswordSearchIndex index;
+        index.sync({makeEntry(1, "GitHub", "alice", "https://github.com"),
+                    makeEntry(2, "GitLab", "alice", "https://gitlab.com"),
+                    makeEntry(3, "Bank", "bob", "https://bank.example.com")});
+        QCOMPARE(index.size(), 3);
+
+        // transposed letters still find the entry, and it ranks first
+        auto hits = index.query("githbu", 10);
+        QVERIFY(!hits.isEmpty());
+        QCOMPARE(hits.first().entryId, qint64(1));
+
+        hits = index.query("bnak", 10);
+        QVERIFY(!hits.isEmpty());
+        QCOMPARE(hits.first().entryId, qint64(3));
+
+        index.upsert(makeEntry(3, "Savings", "bob", "https://savings.example.com"));
+        QVERIFY(index.query("bank", 10).isEmpty());
+        QCOMPARE(index.query("savings", 10).first().entryId, qint64(3));
+
+        index.remove(1);
+        QVERIFY(!index.contains(1));
+        hits = index.query("github", 10);
+        for (const auto &hit : hits)
+            QVERIFY(hit.entryId != 1);
+
+        // a freed slot is reused below live ones; its postings must still be found and removable
+        index.upsert(makeEntry(4, "GitHub Enterprise", "carol", "https://github.example.com"));
+        QCOMPARE(index.query("github", 10).first().entryId, qint64(4));
+        index.remove(4);
+        QVERIFY(index.query("enterprise", 10).isEmpty());
+        QCOMPARE(index.query("gitlab", 10).first().entryId, qint64(2));
+
+        // a predicate decides which entries compete for the limited places, instead of thinning out the result
+        index.upsert(makeEntry(5, "GitHub", "dave", "https://github.com"));
+        for (const auto wanted : {qint64(2), qint64(5)}) {
+            hits = index.query("git", 1, [wanted](qint64 entryId) { return entryId == wanted; });
+            QCOMPARE(hits.size(), 1);
+            QCOMPARE(hits.first().entryId, wanted);
+        }
+        index.remove(5);
+
+        // the engine accepts fuzzy hits that a plain substring scan would miss
+        const auto rows = PasswordEntryModel::FilterRows::fromStore(PasswordEntryStore::fromEntries(
+            {makeEntry(2, "GitLab", "alice", "https://gitlab.com"),
+             makeEntry(3, "Savings", "bob", "https://savings.example.com")}));
+        PasswordFilterCriteria criteria;
+        criteria.searchText = "gitlba";
+        const auto result = PasswordFilterEngine::evaluate(rows, criteria, &index);
+        QVERIFY(result.acceptedRows.testBit(0));
+        QVERIFY(!result.acceptedRows.testBit(1));
+        QVERIFY(result.relevance.at(0) < result.relevance.at(1));
+    }
+
+    void entry_model_sort_ranks()
+    {
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+
+        PasswordRepository repo(&vault);
+        const QStringList titles = {"banana", "Apple", "cherry"};
+        const QVector<qint64> updated = {1700000000, 1500000000, 1600000000};
+        for (int i = 0; i < titles.size(); ++i) {
+            PasswordEntrySecrets s;
+            s.entry.title = titles.at(i);
+            s.password = "pwd";
+            QVERIFY(repo.addEntryWithTimestamps(s, updated.at(i), updated.at(i)));
+        }
+
+        PasswordEntryModel model;
+        QCOMPARE(model.rowCount(), 3);
+
+        auto rowOf = [&](const QString &title) {
+            for (int row = 0; row < model.rowCount(); ++row) {
+                if (model.itemAt(row).title == title)
+                    return row;
+            }
+            return -1;
+        };
+
+        const auto &byTitle = model.sortRanks(0);
+        QCOMPARE(byTitle.size(), 3);
+        QCOMPARE(byTitle.at(rowOf("Apple")), 0);
+        QCOMPARE(byTitle.at(rowOf("banana")), 1);
+        QCOMPARE(byTitle.at(rowOf("cherry")), 2);
+
+        const auto &byUpdated = model.sortRanks(5);
+        QCOMPARE(byUpdated.at(rowOf("Apple")), 0);
+        QCOMPARE(byUpdated.at(rowOf("cherry")), 1);
+        QCOMPARE(byUpdated.at(rowOf("banana")), 2);
+    }
+
+    void entry_model_incremental_changes()
+    {
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+
+        PasswordRepository repo(&vault);
+        for (const auto &title : {QString("GitHub"), QString("Mail"), QString("Bank")}) {
+            PasswordEntrySecrets s;
+            s.entry.title = title;
+            s.entry.url = "https://" + title.toLower() + ".example.com";
+            s.entry.tags = QStringList{"work"};
+            s.password = "pwd";
+            QVERIFY(repo.addEntry(s));
+        }
+
+        PasswordEntryModel model;
+        QCOMPARE(model.rowCount(), 3);
+        auto idOf = [&](const QString &title) {
+            for (int row = 0; row < model.rowCount(); ++row) {
+                if (model.itemAt(row).title == title)
+                    return model.itemAt(row).id;
+            }
+            return qint64(-1);
+        };
+        const auto githubId = idOf("GitHub");
+        const auto mailId = idOf("Mail");
+        const auto bankId = idOf("Bank");
+        const auto bankRow = model.rowForId(bankId);
+
+        auto mail = repo.loadEntry(mailId);
+        QVERIFY(mail.has_value());
+        mail->entry.title = "支付宝";
+        mail->entry.tags = QStringList{"finance", "personal"};
+        QVERIFY(repo.updateEntry(mail.value()));
+        QVERIFY(repo.deleteEntry(githubId));
+        PasswordEntrySecrets added;
+        added.entry.title = "GitLab";
+        added.entry.category = "开发";
+        added.password = "pwd";
+        QVERIFY(repo.addEntry(added));
+        const auto snapshot = repo.snapshot();
+        const auto &entries = snapshot->entries();
+        qint64 gitlabId = -1;
+        for (int row = 0; row < entries.size(); ++row) {
+            if (entries.row(row).title() == QStringLiteral("GitLab"))
+                gitlabId = entries.row(row).id();
+        }
+        QVERIFY(gitlabId > 0);
+
+        QSignalSpy resets(&model, &QAbstractItemModel::modelReset);
+        QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+        QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+        QSignalSpy changed(&model, &QAbstractItemModel::dataChanged);
+        const auto loaded = repo.loadEntries({mailId, gitlabId});
+        QVERIFY(loaded.has_value());
+        QCOMPARE(loaded->size(), 2);
+        model.applyChanges(loaded.value(), {githubId});
+
+        QCOMPARE(resets.count(), 0);
+        QCOMPARE(inserted.count(), 1);
+        QCOMPARE(removed.count(), 1);
+        QCOMPARE(changed.count(), 1);
+        QCOMPARE(model.rowCount(), 3);
+        QCOMPARE(model.rowForId(githubId), -1);
+        QVERIFY(model.rowForId(bankId) <= bankRow);
+        QCOMPARE(model.itemAt(model.rowForId(bankId)).title, QString("Bank"));
+        QCOMPARE(model.itemAt(model.rowForId(mailId)).title, QString("支付宝"));
+        QCOMPARE(model.itemAt(model.rowForId(mailId)).tags, (QStringList{"finance", "personal"}));
+        QCOMPARE(model.itemAt(model.rowForId(gitlabId)).category, QString("开发"));
+
+        // The filter and the index see the edits as a fresh reload would.
+        const auto rows = model.filterRows();
+        QCOMPARE(rows.size(), 3);
+        PasswordFilterCriteria criteria;
+        for (const auto &text : {QString("zfb"), QString("finance"), QString("kf"), QString("bank")}) {
+            criteria.searchText = text;
+            QCOMPARE(PasswordFilterEngine::evaluate(rows, criteria).acceptedRows.count(true), 1);
+        }
+        QVERIFY(!model.searchIndex()->contains(githubId));
+        QCOMPARE(model.searchIndex()->size(), 3);
+        const auto hits = model.searchIndex()->query("gitlab", 10);
+        QVERIFY(!hits.isEmpty());
+        QCOMPARE(hits.first().entryId, gitlabId);
+    }
+
+    void pinyin_search()
+    {
+        const auto keys = PasswordPinyin::keysFor("支付宝 QQ邮箱");
+        QCOMPARE(keys.full, QString("zhifubao qqyouxiang"));
+        QCOMPARE(keys.initials, QString("zfb qqyx"));
+        QVERIFY(!PasswordPinyin::containsHan("GitHub"));
+
+        // heteronyms take the reading of the word they appear in
+        QCOMPARE(PasswordPinyin::keysFor("工商银行").initials, QString("gsyh"));
+        QCOMPARE(PasswordPinyin::keysFor("工商银行").full, QString("gongshangyinhang"));
+        QCOMPARE(PasswordPinyin::keysFor("重庆长沙").initials, QString("cqcs"));
+        QCOMPARE(PasswordPinyin::keysFor("行").full, QString("xing"));
+
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+
+        PasswordRepository repo(&vault);
+        PasswordEntrySecrets a;
+        a.entry.title = "支付宝";
+        a.entry.category = "金融";
+        a.password = "pwd-a";
+        QVERIFY(repo.addEntry(a));
+
+        PasswordEntrySecrets b;
+        b.entry.title = "GitHub";
+        b.password = "pwd-b";
+        QVERIFY(repo.addEntry(b));
+
+        PasswordEntryModel model;
+        const auto rows = model.filterRows();
+        QCOMPARE(rows.size(), 2);
+
+        PasswordFilterCriteria criteria;
+        for (const auto &text : {QString("zfb"), QString("zhifu"), QString("jr")}) {
+            criteria.searchText = text;
+            QCOMPARE(PasswordFilterEngine::evaluate(rows, criteria).acceptedRows.count(true), 1);
+        }
+
+        const auto alipayRow = model.itemAt(0).title == "支付宝" ? 0 : 1;
+        const auto hits = model.searchIndex()->query("zfb", 10);
+        QVERIFY(!hits.isEmpty());
+        QCOMPARE(hits.first().entryId, model.itemAt(alipayRow).id);
+    }
+
     void favicon_cache_roundtrip()
     {
         auto db = PasswordDatabase::db();
@@ -603,8 +1262,196 @@ private slots:
 
         PasswordFaviconService service;
         service.setNetworkEnabled(false);
+        QSignalSpy spyUpdated(&service, &PasswordFaviconService::iconUpdated);
+
+        // the first lookup only queues the decode and hands back a transparent placeholder
+        const auto placeholder = service.iconForUrl("https://example.com/login");
+        QVERIFY(!placeholder.isNull());
+        QCOMPARE(qAlpha(placeholder.pixmap(16, 16).toImage().pixel(8, 8)), 0);
+
+        QVERIFY(spyUpdated.wait(5000));
+        QCOMPARE(spyUpdated.takeFirst().at(0).toString(), QString("example.com"));
+
         const auto icon = service.iconForUrl("https://example.com/login");
         QVERIFY(!icon.isNull());
+        QCOMPARE(icon.pixmap(16, 16).toImage().pixel(8, 8), qRgba(200, 60, 60, 255));
+        QVERIFY(icon.availableSizes().contains(QSize(48, 48)));
+    }
+
+    void conditional_revalidation()
+    {
+        QImage img(16, 16, QImage::Format_ARGB32_Premultiplied);
+        img.fill(qRgba(60, 60, 200, 255));
+        QByteArray png;
+        {
+            QBuffer buf(&png);
+            QVERIFY(buf.open(QIODevice::WriteOnly));
+            QVERIFY(img.save(&buf, "PNG"));
+        }
+
+        LocalHttpServer server([&](const LocalHttpServer::Request &req) {
+            LocalHttpServer::Response res;
+            if (req.path == "/favicon.ico") {
+                if (req.headers.value("if-none-match") == "\"v1\"") {
+                    res.status = 304;
+                    return res;
+                }
+                res.headers = {{"Content-Type", "image/png"}, {"ETag", "\"v1\""}};
+                res.body = png;
+                return res;
+            }
+            if (req.path == "/range/5BAA6" && req.headers.value("if-none-match") == "\"p1\"") {
+                res.status = 304;
+                return res;
+            }
+            res.status = 404;
+            return res;
+        });
+        QVERIFY(server.listen());
+
+        auto fetchedAt = [](const QString &sql, const QString &key) {
+            QSqlQuery q(PasswordDatabase::db());
+            q.prepare(sql);
+            q.addBindValue(key);
+            if (!q.exec() || !q.next())
+                return qint64(-1);
+            return q.value(0).toLongLong();
+        };
+        const auto faviconSql = QString("SELECT fetched_at FROM favicon_cache WHERE host = ?");
+        const auto url = server.baseUrl().toString();
+
+        {
+            PasswordFaviconService service;
+            QSignalSpy spyUpdated(&service, &PasswordFaviconService::iconUpdated);
+            service.iconForUrl(url);
+            QVERIFY(spyUpdated.wait(5000));
+        }
+        QCOMPARE(server.requests().size(), 1);
+        QVERIFY(!server.requests().first().headers.contains("if-none-match"));
+
+        // expire the cached icon; the refresh must be conditional and answered without a body
+        QSqlQuery age(PasswordDatabase::db());
+        age.prepare("UPDATE favicon_cache SET fetched_at = 0 WHERE host = ?");
+        age.addBindValue(server.host());
+        QVERIFY(age.exec());
+        {
+            PasswordFaviconService service;
+            QSignalSpy spyUpdated(&service, &PasswordFaviconService::iconUpdated);
+            service.iconForUrl(url);
+            QVERIFY(spyUpdated.wait(5000));
+            service.iconForUrl(url);
+            QTRY_VERIFY_WITH_TIMEOUT(fetchedAt(faviconSql, server.host()) > 0, 5000);
+            QCOMPARE(spyUpdated.count(), 1);
+        }
+        QCOMPARE(server.requests().size(), 2);
+        QCOMPARE(server.requests().last().headers.value("if-none-match"), QByteArray("\"v1\""));
+
+        // an expired pwned range is revalidated the same way and its cached body reused
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+        PasswordRepository repo(&vault);
+        PasswordEntrySecrets e;
+        e.entry.title = "Example";
+        e.password = "password";
+        QVERIFY(repo.addEntry(e));
+
+        QSqlQuery q(PasswordDatabase::db());
+        q.prepare(R"sql(
+            INSERT OR REPLACE INTO pwned_prefix_cache(prefix, body, fetched_at, etag)
+            VALUES(?, ?, ?, ?)
+        )sql");
+        q.addBindValue("5BAA6");
+        q.addBindValue(QByteArray("1E4C9B93F3F0682250B6CF8331B7EE68FD8:3303003\r\n"));
+        q.addBindValue(0);
+        q.addBindValue("\"p1\"");
+        QVERIFY(q.exec());
+
+        const auto dbPath = QDir(AppPaths::appDataDir()).filePath("password.sqlite3");
+        PasswordHealthWorker health(dbPath, vault.masterKey(), true, true, nullptr);
+        health.setPwnedRangeBaseUrl(server.baseUrl().resolved(QUrl("range/")));
+        QSignalSpy spyFinished(&health, &PasswordHealthWorker::finished);
+        health.run();
+        QCOMPARE(spyFinished.count(), 1);
+        const auto items = qvariant_cast<QVector<PasswordHealthItem>>(spyFinished.takeFirst().at(0));
+        QCOMPARE(items.size(), 1);
+        QVERIFY(items.first().pwned);
+
+        QCOMPARE(server.requests().size(), 3);
+        QCOMPARE(server.requests().last().headers.value("if-none-match"), QByteArray("\"p1\""));
+        QVERIFY(fetchedAt("SELECT fetched_at FROM pwned_prefix_cache WHERE prefix = ?", "5BAA6") > 0);
+    }
+
+    void favicon_failure_backoff()
+    {
+        auto failureRow = []() {
+            QSqlQuery q(PasswordDatabase::db());
+            q.prepare("SELECT failures, retry_at FROM favicon_failures WHERE host = ?");
+            q.addBindValue("127.0.0.1");
+            if (!q.exec() || !q.next())
+                return qMakePair(0, qint64(0));
+            return qMakePair(q.value(0).toInt(), q.value(1).toLongLong());
+        };
+
+        // nothing listens on port 80 here, so the fetch fails and is recorded with a backoff
+        {
+            PasswordFaviconService service;
+            service.iconForUrl("http://127.0.0.1/");
+            QTRY_COMPARE_WITH_TIMEOUT(failureRow().first, 1, 10000);
+            QVERIFY(failureRow().second > QDateTime::currentSecsSinceEpoch());
+
+            service.iconForUrl("http://127.0.0.1/");
+            QTest::qWait(300);
+            QCOMPARE(failureRow().first, 1);
+        }
+
+        // the failure state is persisted, so a fresh service does not retry either
+        PasswordFaviconService service;
+        service.iconForUrl("http://127.0.0.1/");
+        QTest::qWait(300);
+        QCOMPARE(failureRow().first, 1);
+    }
+
+    void favicon_updates_exact_rows()
+    {
+        QCOMPARE(PasswordFaviconService::hostForUrl("Example.COM/path"), QString("example.com"));
+        QVERIFY(PasswordFaviconService::hostForUrl("ftp://example.com").isEmpty());
+
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+
+        PasswordRepository repo(&vault);
+        const QStringList urls = {"https://example.com/login", "https://other.org", "example.com/account"};
+        for (int i = 0; i < urls.size(); ++i) {
+            PasswordEntrySecrets s;
+            s.entry.title = QString("entry %1").arg(i);
+            s.entry.url = urls.at(i);
+            s.password = "pwd";
+            QVERIFY(repo.addEntryWithTimestamps(s, 1000 + i, 1000 + i));
+        }
+
+        PasswordFaviconService service;
+        service.setNetworkEnabled(false);
+        PasswordEntryModel model;
+        model.setFaviconService(&service);
+        QCOMPARE(model.rowCount(), 3);
+
+        QSignalSpy spyChanged(&model, &QAbstractItemModel::dataChanged);
+        emit service.iconUpdated("example.com");
+
+        QSet<int> changedRows;
+        for (const auto &args : spyChanged) {
+            const auto first = args.at(0).toModelIndex().row();
+            const auto last = args.at(1).toModelIndex().row();
+            for (int row = first; row <= last; ++row)
+                changedRows.insert(row);
+        }
+
+        QSet<int> expected;
+        for (int row = 0; row < model.rowCount(); ++row) {
+            if (model.itemAt(row).url.contains("example.com"))
+                expected.insert(row);
+        }
+        QCOMPARE(changedRows, expected);
     }
 
     void pwned_offline_cache()
@@ -660,6 +1507,542 @@ private slots:
         QVERIFY(found);
     }
 
+    void health_scan_parallel_batches()
+    {
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+
+        // More rows than one scan batch, with every password reused across batch boundaries.
+        constexpr int kEntries = 2100;
+        constexpr int kDistinct = 700;
+        PasswordRepository repo(&vault);
+        for (int i = 0; i < kEntries; ++i) {
+            PasswordEntrySecrets e;
+            e.entry.title = QString("Entry %1").arg(i);
+            e.password = QString("Shared-%1-xQ9!").arg(i % kDistinct);
+            QVERIFY(repo.addEntry(e));
+        }
+
+        const auto dbPath = QDir(AppPaths::appDataDir()).filePath("password.sqlite3");
+
+        PasswordHealthWorker health(dbPath, vault.masterKey(), false, false, nullptr);
+        QSignalSpy spyFinished(&health, &PasswordHealthWorker::finished);
+        health.run();
+        QCOMPARE(spyFinished.count(), 1);
+        QCOMPARE(health.progress()->maximum(), kEntries);
+        QCOMPARE(health.progress()->value(), kEntries);
+
+        const auto items = qvariant_cast<QVector<PasswordHealthItem>>(spyFinished.takeFirst().at(0));
+        QCOMPARE(items.size(), kEntries);
+        QSet<qint64> ids;
+        for (int i = 0; i < items.size(); ++i) {
+            const auto &it = items.at(i);
+            ids.insert(it.entryId);
+            QVERIFY(!it.corrupted);
+            QVERIFY(it.reused);
+            QCOMPARE(it.reuseCount, kEntries / kDistinct);
+            if (i > 0)
+                QVERIFY(items.at(i - 1).updatedAtSecs >= it.updatedAtSecs);
+        }
+        QCOMPARE(ids.size(), kEntries);
+    }
+
+    void health_scan_incremental_cache()
+    {
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+
+        PasswordRepository repo(&vault);
+        PasswordEntrySecrets e;
+        e.entry.title = "a";
+        e.password = "123456";
+        QVERIFY(repo.addEntry(e));
+        e.entry.title = "b";
+        QVERIFY(repo.addEntry(e));
+        e.entry.title = "c";
+        e.password = "Aq9!xZ3@pL8#";
+        QVERIFY(repo.addEntry(e));
+
+        const auto dbPath = QDir(AppPaths::appDataDir()).filePath("password.sqlite3");
+        const auto scan = [&dbPath, &vault]() {
+            PasswordHealthWorker health(dbPath, vault.masterKey(), false, false, nullptr);
+            QSignalSpy spyFinished(&health, &PasswordHealthWorker::finished);
+            health.run();
+            QHash<QString, PasswordHealthItem> byTitle;
+            if (spyFinished.count() != 1)
+                return byTitle;
+            for (const auto &it : qvariant_cast<QVector<PasswordHealthItem>>(spyFinished.takeFirst().at(0)))
+                byTitle.insert(it.title, it);
+            return byTitle;
+        };
+        const auto cacheRows = []() {
+            QSqlQuery q(PasswordDatabase::db());
+            if (!q.exec("SELECT COUNT(1) FROM health_analysis_cache") || !q.next())
+                return -1;
+            return q.value(0).toInt();
+        };
+
+        const auto first = scan();
+        QCOMPARE(first.size(), 3);
+        QCOMPARE(cacheRows(), 3);
+
+        // A second scan is served from the cache and must report the same thing.
+        const auto second = scan();
+        QCOMPARE(second.size(), 3);
+        for (const auto &title : {QString("a"), QString("b"), QString("c")}) {
+            QCOMPARE(second.value(title).strengthScore, first.value(title).strengthScore);
+            QCOMPARE(second.value(title).reused, first.value(title).reused);
+        }
+        QVERIFY(second.value("a").weak);
+        QCOMPARE(second.value("a").reuseCount, 2);
+
+        // Changing a password drops its cached analysis; reuse is recomputed from the stored fingerprints.
+        auto b = repo.loadEntry(second.value("b").entryId);
+        QVERIFY(b.has_value());
+        b->password = "Zz7$kq!Lm2@wR9";
+        QVERIFY(repo.updateEntry(b.value()));
+        QCOMPARE(cacheRows(), 2);
+
+        const auto third = scan();
+        QVERIFY(!third.value("b").weak);
+        QVERIFY(!third.value("a").reused);
+        QVERIFY(!third.value("b").reused);
+        QCOMPARE(cacheRows(), 3);
+
+        QVERIFY(repo.deleteEntry(third.value("c").entryId));
+        QCOMPARE(cacheRows(), 2);
+    }
+
+    void pwned_cached_range_keeps_fetch_time()
+    {
+        constexpr qint64 kPwnedCacheTtlSecs = 30 * 86400;
+        const QByteArray body("1E4C9B93F3F0682250B6CF8331B7EE68FD8:3303003\r\n");
+        LocalHttpServer server([&](const LocalHttpServer::Request &req) {
+            LocalHttpServer::Response res;
+            if (req.path == "/range/5BAA6") {
+                res.body = body;
+                return res;
+            }
+            res.status = 404;
+            return res;
+        });
+        QVERIFY(server.listen());
+
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+        PasswordRepository repo(&vault);
+        PasswordEntrySecrets e;
+        e.entry.title = "Example";
+        e.password = "password";
+        QVERIFY(repo.addEntry(e));
+
+        const auto dbPath = QDir(AppPaths::appDataDir()).filePath("password.sqlite3");
+        const auto scan = [&]() {
+            PasswordHealthWorker health(dbPath, vault.masterKey(), true, true, nullptr);
+            health.setPwnedRangeBaseUrl(server.baseUrl().resolved(QUrl("range/")));
+            QSignalSpy spyFinished(&health, &PasswordHealthWorker::finished);
+            health.run();
+            if (spyFinished.count() != 1)
+                return PasswordHealthItem();
+            const auto items = qvariant_cast<QVector<PasswordHealthItem>>(spyFinished.takeFirst().at(0));
+            return items.isEmpty() ? PasswordHealthItem() : items.first();
+        };
+
+        // A range fetched most of a TTL ago is still fresh and answers without the network...
+        QSqlQuery q(PasswordDatabase::db());
+        q.prepare(R"sql(
+            INSERT OR REPLACE INTO pwned_prefix_cache(prefix, body, fetched_at)
+            VALUES(?, ?, ?)
+        )sql");
+        q.addBindValue("5BAA6");
+        q.addBindValue(body);
+        q.addBindValue(QDateTime::currentDateTime().toSecsSinceEpoch() - kPwnedCacheTtlSecs + 2);
+        QVERIFY(q.exec());
+
+        auto item = scan();
+        QVERIFY(item.pwnedChecked);
+        QVERIFY(item.pwned);
+        QCOMPARE(server.requests().size(), 0);
+
+        // ...but the entry's result is only as old as that range: once the range expires, the entry is
+        // refetched instead of trusting a check stamped with the scan time.
+        QTest::qWait(3000);
+        item = scan();
+        QVERIFY(item.pwnedChecked);
+        QVERIFY(item.pwned);
+        QCOMPARE(server.requests().size(), 1);
+    }
+
+    void progress_sampler_throttles()
+    {
+        auto channel = std::make_shared<ProgressChannel>();
+        ProgressSampler sampler;
+        QSignalSpy spyRange(&sampler, &ProgressSampler::rangeChanged);
+        QSignalSpy spyValue(&sampler, &ProgressSampler::valueChanged);
+        sampler.start(channel);
+
+        // 100k steps from another thread turn into a handful of GUI-side updates.
+        constexpr int kSteps = 100000;
+        QThread producer;
+        QObject::connect(&producer, &QThread::started, &producer, [&channel]() {
+            channel->setRange(0, kSteps);
+            for (int i = 0; i < kSteps; ++i)
+                channel->advance();
+        }, Qt::DirectConnection);
+        producer.start();
+        QVERIFY(producer.wait(10000));
+
+        QTRY_VERIFY(!spyValue.isEmpty() && spyValue.last().at(0).toInt() == kSteps);
+        QCOMPARE(spyRange.count(), 1);
+        QCOMPARE(spyRange.first().at(1).toInt(), kSteps);
+        QVERIFY(spyValue.count() < 100);
+        QCOMPARE(sampler.remainingMs(), 0);
+
+        sampler.stop();
+        const auto updates = spyValue.count();
+        channel->advance();
+        QTest::qWait(100);
+        QCOMPARE(spyValue.count(), updates);
+    }
+
+    void health_scan_streams_rows()
+    {
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+
+        PasswordRepository repo(&vault);
+        PasswordEntrySecrets e;
+        for (const auto *title : {"a", "b", "c"}) {
+            e.entry.title = title;
+            e.password = QString::fromLatin1(title) == "c" ? "Aq9!xZ3@pL8#" : "shared-secret";
+            QVERIFY(repo.addEntry(e));
+        }
+
+        const auto dbPath = QDir(AppPaths::appDataDir()).filePath("password.sqlite3");
+        PasswordHealthWorker health(dbPath, vault.masterKey(), false, false, nullptr);
+        PasswordHealthModel model;
+        QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+
+        int readyRows = 0;
+        bool reusedBeforePatch = false;
+        connect(&health, &PasswordHealthWorker::itemsReady, &model, [&readyRows, &reusedBeforePatch, &model](const QVector<PasswordHealthItem> &items) {
+            readyRows += items.size();
+            for (const auto &it : items)
+                reusedBeforePatch = reusedBeforePatch || it.reused;
+            model.appendItems(items);
+        });
+        connect(&health, &PasswordHealthWorker::itemsUpdated, &model, &PasswordHealthModel::updateItems);
+        QSignalSpy spyUpdated(&health, &PasswordHealthWorker::itemsUpdated);
+        QSignalSpy spyFinished(&health, &PasswordHealthWorker::finished);
+        health.run();
+
+        QCOMPARE(spyFinished.count(), 1);
+        QCOMPARE(readyRows, 3);
+        QVERIFY(!reusedBeforePatch);
+        QCOMPARE(spyUpdated.count(), 1);
+        QCOMPARE(qvariant_cast<QVector<PasswordHealthItem>>(spyUpdated.first().at(0)).size(), 2);
+
+        // The streamed and patched model ends up exactly where the final result is.
+        const auto finalItems = qvariant_cast<QVector<PasswordHealthItem>>(spyFinished.first().at(0));
+        QCOMPARE(model.rowCount(), finalItems.size());
+        for (int row = 0; row < finalItems.size(); ++row) {
+            const auto &streamed = model.items().at(row);
+            QCOMPARE(streamed.entryId, finalItems.at(row).entryId);
+            QCOMPARE(streamed.reused, finalItems.at(row).reused);
+            QCOMPARE(streamed.reuseCount, finalItems.at(row).reuseCount);
+            QCOMPARE(streamed.strengthScore, finalItems.at(row).strengthScore);
+        }
+    }
+
+    void pwned_concurrent_fetch()
+    {
+        LocalPwnedRangeServer server(50);
+        server.addPassword("password", 3303003);
+        QVERIFY(server.listen());
+
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+        PasswordRepository repo(&vault);
+        QSet<QByteArray> prefixes;
+        for (int i = 0; i < 24; ++i) {
+            PasswordEntrySecrets e;
+            e.entry.title = QString("Entry %1").arg(i);
+            e.password = i == 0 ? QString("password") : QString("unique-%1-Qx7!").arg(i);
+            QVERIFY(repo.addEntry(e));
+            prefixes.insert(LocalPwnedRangeServer::sha1Hex(e.password.toUtf8()).left(5));
+        }
+        // One transient failure; the range must still come back through a retry.
+        server.failNext("5BAA6", 1, 503);
+
+        const auto dbPath = QDir(AppPaths::appDataDir()).filePath("password.sqlite3");
+        PasswordHealthWorker health(dbPath, vault.masterKey(), true, true, nullptr);
+        health.setPwnedRangeBaseUrl(server.rangeBaseUrl());
+        health.setPwnedMaxInFlight(4);
+        QSignalSpy spyFinished(&health, &PasswordHealthWorker::finished);
+        health.run();
+        QCOMPARE(spyFinished.count(), 1);
+
+        const auto items = qvariant_cast<QVector<PasswordHealthItem>>(spyFinished.takeFirst().at(0));
+        QCOMPARE(items.size(), 24);
+        for (const auto &it : items) {
+            QVERIFY(it.pwnedChecked);
+            QCOMPARE(it.pwned, it.title == "Entry 0");
+            if (it.pwned)
+                QCOMPARE(it.pwnedCount, qint64(3303003));
+        }
+        QCOMPARE(server.requests().size(), prefixes.size() + 1);
+
+        // Every range was persisted as it completed.
+        QSqlQuery q(PasswordDatabase::db());
+        QVERIFY(q.exec("SELECT COUNT(1) FROM pwned_prefix_cache"));
+        QVERIFY(q.next());
+        QCOMPARE(q.value(0).toInt(), prefixes.size());
+        QVERIFY(q.exec("SELECT body FROM pwned_prefix_cache WHERE prefix = '5BAA6'"));
+        QVERIFY(q.next());
+        const auto stored = q.value(0).toByteArray();
+        QVERIFY(PasswordPwnedRangeBlob::isEncoded(stored));
+        QCOMPARE(PasswordPwnedRangeBlob::count(stored, LocalPwnedRangeServer::sha1Hex("password").mid(5)), qint64(3303003));
+    }
+
+    void pwned_range_blob()
+    {
+        // A realistic range: ~800 listed suffixes with counts, plus count-0 padding, CRLF separated.
+        QMap<QByteArray, qint64> lines;
+        for (int i = 0; i < 800; ++i)
+            lines.insert(LocalPwnedRangeServer::sha1Hex("listed-" + QByteArray::number(i)).mid(5), (i * 7919) % 250000 + 1);
+        for (int i = 0; i < 200; ++i)
+            lines.insert(LocalPwnedRangeServer::sha1Hex("padding-" + QByteArray::number(i)).mid(5), 0);
+        QByteArray text;
+        for (auto it = lines.cbegin(); it != lines.cend(); ++it)
+            text += it.key() + ':' + QByteArray::number(it.value()) + "\r\n";
+
+        const auto blob = PasswordPwnedRangeBlob::encode(text);
+        QVERIFY(PasswordPwnedRangeBlob::isEncoded(blob));
+        QVERIFY(!PasswordPwnedRangeBlob::isEncoded(text));
+        QVERIFY2(blob.size() * 2 < text.size(), qPrintable(QString("%1 vs %2").arg(blob.size()).arg(text.size())));
+
+        for (auto it = lines.cbegin(); it != lines.cend(); ++it) {
+            QCOMPARE(PasswordPwnedRangeBlob::count(blob, it.key()), it.value());
+            QCOMPARE(PasswordPwnedRangeBlob::count(blob, it.key().toLower()), it.value());
+            // Rows cached as text before the binary format still answer.
+            QCOMPARE(PasswordPwnedRangeBlob::count(text, it.key()), it.value());
+        }
+        const auto absent = LocalPwnedRangeServer::sha1Hex("absent").mid(5);
+        QCOMPARE(PasswordPwnedRangeBlob::count(blob, absent), qint64(0));
+        QCOMPARE(PasswordPwnedRangeBlob::count(text, absent), qint64(0));
+        QCOMPARE(PasswordPwnedRangeBlob::count(blob, "XYZ"), qint64(0));
+
+        const auto empty = PasswordPwnedRangeBlob::encode(QByteArray());
+        QVERIFY(PasswordPwnedRangeBlob::isEncoded(empty));
+        QVERIFY(!empty.isEmpty());
+        QCOMPARE(PasswordPwnedRangeBlob::count(empty, absent), qint64(0));
+    }
+
+    void pwned_offline_corpus()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        // A miniature "ordered by hash" dump: sorted, CRLF-terminated HASH:COUNT lines.
+        QMap<QByteArray, qint64> corpus;
+        corpus.insert(LocalPwnedRangeServer::sha1Hex("password"), 3303003);
+        corpus.insert(LocalPwnedRangeServer::sha1Hex("123456"), 37359195);
+        for (int i = 0; i < 300; ++i)
+            corpus.insert(LocalPwnedRangeServer::sha1Hex("filler-" + QByteArray::number(i)), i + 1);
+        QByteArray dump;
+        for (auto it = corpus.cbegin(); it != corpus.cend(); ++it)
+            dump += it.key() + ':' + QByteArray::number(it.value()) + "\r\n";
+        const auto dumpPath = dir.filePath("pwned-passwords-sha1-ordered-by-hash.txt");
+        {
+            QFile f(dumpPath);
+            QVERIFY(f.open(QIODevice::WriteOnly));
+            QCOMPARE(f.write(dump), qint64(dump.size()));
+        }
+
+        const auto dbFile = dir.filePath("pwned-offline.bin");
+        {
+            PasswordPwnedOfflineImporter importer(dumpPath, dbFile);
+            QSignalSpy spyFinished(&importer, &PasswordPwnedOfflineImporter::finished);
+            QSignalSpy spyFailed(&importer, &PasswordPwnedOfflineImporter::failed);
+            importer.run();
+            QCOMPARE(spyFailed.count(), 0);
+            QCOMPARE(spyFinished.count(), 1);
+            QCOMPARE(spyFinished.takeFirst().at(0).toLongLong(), qint64(corpus.size()));
+        }
+
+        {
+            PasswordPwnedOfflineDb db;
+            QVERIFY2(db.open(dbFile), qPrintable(db.lastError()));
+            QCOMPARE(db.recordCount(), quint64(corpus.size()));
+            QCOMPARE(db.lookup(LocalPwnedRangeServer::sha1Hex("password")).value_or(-1), qint64(3303003));
+            QCOMPARE(db.lookup(LocalPwnedRangeServer::sha1Hex("123456")).value_or(-1), PasswordPwnedOfflineDb::kMaxCount);
+            QCOMPARE(db.lookup(LocalPwnedRangeServer::sha1Hex("filler-41")).value_or(-1), qint64(42));
+            QCOMPARE(db.lookup(LocalPwnedRangeServer::sha1Hex("not-in-the-dump")).value_or(-1), qint64(0));
+            QVERIFY(!db.lookup("xyz").has_value());
+        }
+
+        // An unsorted dump is rejected and leaves the existing corpus untouched.
+        const auto unsortedPath = dir.filePath("unsorted.txt");
+        {
+            QFile f(unsortedPath);
+            QVERIFY(f.open(QIODevice::WriteOnly));
+            f.write("FFFFF00000000000000000000000000000000000:1\r\n00000000000000000000000000000000000000AA:2\r\n");
+        }
+        {
+            PasswordPwnedOfflineImporter importer(unsortedPath, dbFile);
+            QSignalSpy spyFailed(&importer, &PasswordPwnedOfflineImporter::failed);
+            importer.run();
+            QCOMPARE(spyFailed.count(), 1);
+            PasswordPwnedOfflineDb db;
+            QVERIFY(db.open(dbFile));
+            QCOMPARE(db.recordCount(), quint64(corpus.size()));
+        }
+
+        // The scan answers from the corpus with the network disabled and a cold range cache.
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+        PasswordRepository repo(&vault);
+        for (int i = 0; i < 3; ++i) {
+            PasswordEntrySecrets e;
+            e.entry.title = QString("Entry %1").arg(i);
+            e.password = i == 0 ? QString("password") : QString("unique-%1-Qx7!").arg(i);
+            QVERIFY(repo.addEntry(e));
+        }
+
+        const auto dbPath = QDir(AppPaths::appDataDir()).filePath("password.sqlite3");
+        PasswordHealthWorker health(dbPath, vault.masterKey(), true, false, nullptr);
+        health.setPwnedOfflineDbPath(dbFile);
+        QSignalSpy spyFinished(&health, &PasswordHealthWorker::finished);
+        health.run();
+        QCOMPARE(spyFinished.count(), 1);
+
+        const auto items = qvariant_cast<QVector<PasswordHealthItem>>(spyFinished.takeFirst().at(0));
+        QCOMPARE(items.size(), 3);
+        for (const auto &it : items) {
+            QVERIFY(it.pwnedChecked);
+            QCOMPARE(it.pwned, it.title == "Entry 0");
+            if (it.pwned)
+                QCOMPARE(it.pwnedCount, qint64(3303003));
+        }
+    }
+
+    void pwned_offline_filter()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        constexpr int kKeys = 20000;
+        QMap<QByteArray, qint64> corpus;
+        for (int i = 0; i < kKeys; ++i)
+            corpus.insert(LocalPwnedRangeServer::sha1Hex("breached-" + QByteArray::number(i)), i + 1);
+        QByteArray dump;
+        for (auto it = corpus.cbegin(); it != corpus.cend(); ++it)
+            dump += it.key() + ':' + QByteArray::number(it.value()) + "\r\n";
+        const auto dumpPath = dir.filePath("dump.txt");
+        {
+            QFile f(dumpPath);
+            QVERIFY(f.open(QIODevice::WriteOnly));
+            QCOMPARE(f.write(dump), qint64(dump.size()));
+        }
+
+        const auto dbFile = dir.filePath("pwned-offline.bin");
+        PasswordPwnedOfflineImporter importer(dumpPath, dbFile);
+        QSignalSpy spyFinished(&importer, &PasswordPwnedOfflineImporter::finished);
+        importer.run();
+        QCOMPARE(spyFinished.count(), 1);
+        QVERIFY(QFile::exists(PasswordPwnedFilter::pathForCorpus(dbFile)));
+
+        PasswordPwnedFilter filter;
+        QVERIFY2(filter.open(PasswordPwnedFilter::pathForCorpus(dbFile)), qPrintable(filter.lastError()));
+        QCOMPARE(filter.keyCount(), quint64(kKeys));
+        QCOMPARE(filter.corpusRecords(), quint64(kKeys));
+        QVERIFY(QFileInfo(PasswordPwnedFilter::pathForCorpus(dbFile)).size() < kKeys * 10 / 8 + 4096);
+
+        // No false negatives; false positives near 1/256.
+        for (auto it = corpus.cbegin(); it != corpus.cend(); ++it)
+            QVERIFY(filter.mayContain(PasswordPwnedOfflineDb::hashKey(it.key()).value()));
+        int falsePositives = 0;
+        for (int i = 0; i < kKeys; ++i) {
+            const auto key = PasswordPwnedOfflineDb::hashKey(LocalPwnedRangeServer::sha1Hex("clean-" + QByteArray::number(i)));
+            falsePositives += filter.mayContain(key.value()) ? 1 : 0;
+        }
+        QVERIFY2(falsePositives < kKeys / 100, qPrintable(QString::number(falsePositives)));
+
+        // The corpus picks the filter up and stays exact.
+        PasswordPwnedOfflineDb db;
+        QVERIFY(db.open(dbFile));
+        QVERIFY(db.hasFilter());
+        QCOMPARE(db.lookup(LocalPwnedRangeServer::sha1Hex("breached-123")).value_or(-1), qint64(124));
+        for (int i = 0; i < 1000; ++i)
+            QCOMPARE(db.lookup(LocalPwnedRangeServer::sha1Hex("clean-" + QByteArray::number(i))).value_or(-1), qint64(0));
+    }
+
+    void health_scan_similar_passwords()
+    {
+        QCOMPARE(PasswordSimilarity::skeleton("P@ssw0rd2024!"), QString("password"));
+        QCOMPARE(PasswordSimilarity::skeleton("Summ3r2024!!"), QString("summer"));
+        QCOMPARE(PasswordSimilarity::skeleton("123456"), QString());
+
+        PasswordVault vault;
+        QVERIFY(vault.createVault("master"));
+        PasswordRepository repo(&vault);
+        const QList<QPair<QString, QString>> entries = {
+            {"s1", "Summer2023!"},
+            {"s2", "Summer2024!"},
+            {"s3", "Summ3r2024!!"},
+            {"s4", "Sumer2024"},     // one edit away from the others' skeleton
+            {"r1", "Autumn-Kq7#"},   // identical copies are reuse, not similarity
+            {"r2", "Autumn-Kq7#"},
+            {"u1", "Zz7$kq!Lm2@wR9"},
+            {"u2", "Aq9!xZ3@pL8#"},
+        };
+        for (const auto &entry : entries) {
+            PasswordEntrySecrets e;
+            e.entry.title = entry.first;
+            e.password = entry.second;
+            QVERIFY(repo.addEntry(e));
+        }
+
+        const auto dbPath = QDir(AppPaths::appDataDir()).filePath("password.sqlite3");
+        for (int pass = 0; pass < 2; ++pass) {
+            // The second pass restores every row from the analysis cache.
+            PasswordHealthWorker health(dbPath, vault.masterKey(), false, false, nullptr);
+            QSignalSpy spyFinished(&health, &PasswordHealthWorker::finished);
+            health.run();
+            QCOMPARE(spyFinished.count(), 1);
+            const auto items = qvariant_cast<QVector<PasswordHealthItem>>(spyFinished.takeFirst().at(0));
+            QCOMPARE(items.size(), entries.size());
+            for (const auto &it : items) {
+                const auto inSummerGroup = it.title.startsWith('s');
+                QCOMPARE(it.similar, inSummerGroup);
+                QCOMPARE(it.similarCount, inSummerGroup ? 4 : 0);
+                QCOMPARE(it.reused, it.title.startsWith('r'));
+                if (inSummerGroup)
+                    QVERIFY(it.issuesText().contains("相似(4)"));
+            }
+        }
+
+        // Neighbours of neighbours are not merged: bone is two edits from both love and dove.
+        const auto chain = PasswordSimilarity::cluster({"love", "dove", "done", "bone"});
+        QVERIFY(chain.at(0) >= 0);
+        QCOMPARE(chain.at(0), chain.at(1));
+        QVERIFY(chain.at(3) != chain.at(0));
+
+        // Linear in the number of skeletons: 80k unrelated ones plus one planted pair.
+        QVector<QString> skeletons;
+        for (int i = 0; i < 80000; ++i)
+            skeletons.push_back(QString::fromLatin1(LocalPwnedRangeServer::sha1Hex(QByteArray::number(i)).left(16).toLower()));
+        skeletons.push_back("correcthorse");
+        skeletons.push_back("correcthorze");
+        QElapsedTimer timer;
+        timer.start();
+        const auto clusters = PasswordSimilarity::cluster(skeletons);
+        QVERIFY2(timer.elapsed() < 5000, qPrintable(QString::number(timer.elapsed())));
+        QCOMPARE(clusters.at(80000), clusters.at(80001));
+        QVERIFY(clusters.at(80000) >= 0);
+        QCOMPARE(clusters.count(-1), 80000);
+    }
+
 private:
     static void resetDatabase()
     {
@@ -671,9 +2054,12 @@ private:
         QVERIFY(q.exec("DELETE FROM common_passwords"));
         QVERIFY(q.exec("DELETE FROM tags"));
         QVERIFY(q.exec("DELETE FROM favicon_cache"));
+        QVERIFY(q.exec("DELETE FROM favicon_failures"));
         QVERIFY(q.exec("DELETE FROM pwned_prefix_cache"));
+        QVERIFY(q.exec("DELETE FROM health_analysis_cache"));
         QVERIFY(q.exec("DELETE FROM groups WHERE id <> 1"));
         QVERIFY(q.exec("DELETE FROM vault_meta"));
+        PasswordVaultSnapshot::invalidate();
     }
 };
 
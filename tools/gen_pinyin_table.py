@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Generates src/password/passwordpinyintable.inc from ICU's Han-Latin transliterator.
+
+Requires `uconv` (ICU tools). Each CJK Unified Ideograph in U+4E00..U+9FA5 is mapped to its default
+toneless pinyin syllable; characters ICU cannot romanize map to index 0 (the empty syllable). Words whose
+characters read differently from that default (银行, 重庆) are listed in kPhraseReadings in passwordpinyin.cpp.
+
+    python3 tools/gen_pinyin_table.py > src/password/passwordpinyintable.inc
+"""
+
+import subprocess
+import sys
+
+FIRST = 0x4E00
+LAST = 0x9FA5
+PER_LINE = 24
+
+
+def romanize(chars):
+    text = "\n".join(chars) + "\n"
+    out = subprocess.run(
+        ["uconv", "-f", "utf-8", "-t", "utf-8", "-x", "Han-Latin; Latin-ASCII; Lower"],
+        input=text.encode("utf-8"),
+        stdout=subprocess.PIPE,
+        check=True,
+    ).stdout.decode("utf-8")
+    return out.split("\n")[: len(chars)]
+
+
+def main():
+    chars = [chr(cp) for cp in range(FIRST, LAST + 1)]
+    readings = romanize(chars)
+
+    syllables = [""]
+    index_of = {"": 0}
+    indexes = []
+    for reading in readings:
+        reading = reading.strip()
+        if not reading or not reading.isascii() or not reading.isalpha():
+            reading = ""
+        if reading not in index_of:
+            index_of[reading] = len(syllables)
+            syllables.append(reading)
+        indexes.append(index_of[reading])
+
+    width = max(len(s) for s in syllables) + 1
+    out = sys.stdout
+    out.write("// Generated by tools/gen_pinyin_table.py from ICU's Han-Latin transliterator. Do not edit.\n")
+    out.write("// clang-format off\n\n")
+    out.write("constexpr char16_t kPinyinFirstHan = 0x%04X;\n" % FIRST)
+    out.write("constexpr char16_t kPinyinLastHan = 0x%04X;\n\n" % LAST)
+    out.write("constexpr char kPinyinSyllables[][%d] = {\n" % width)
+    for i in range(0, len(syllables), 12):
+        out.write("    " + " ".join('"%s",' % s for s in syllables[i : i + 12]) + "\n")
+    out.write("};\n\n")
+    out.write("constexpr quint16 kPinyinSyllableIndex[%d] = {\n" % len(indexes))
+    for i in range(0, len(indexes), PER_LINE):
+        out.write("    " + " ".join("%d," % v for v in indexes[i : i + PER_LINE]) + "\n")
+    out.write("};\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Generates src/password/passwordstrengthtables.inc from tools/strength_wordlists/*.txt.
+
+Each word list holds one lower-case word per line, most frequent first; lines starting with '#' are comments.
+The lists are merged into one array sorted bytewise, and a word in several lists keeps its best rank. Words are
+stored back to back in a single character blob, with an offset table, so the estimator can binary search the
+array in place. The QWERTY and keypad adjacency graphs are laid out the same way as in zxcvbn and compiled into
+fixed neighbour tables.
+
+    python3 tools/gen_strength_tables.py > src/password/passwordstrengthtables.inc
+"""
+
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+LISTS = ["passwords", "english", "names", "pinyin"]
+MIN_WORD_LENGTH = 3
+PER_LINE = 16
+CHARS_PER_LINE = 96
+
+QWERTY = r"""
+`~ 1! 2@ 3# 4$ 5% 6^ 7& 8* 9( 0) -_ =+
+    qQ wW eE rR tT yY uU iI oO pP [{ ]} \|
+     aA sS dD fF gG hH jJ kK lL ;: '"
+      zZ xX cC vV bB nN mM ,< .> /?
+"""
+
+KEYPAD = r"""
+  / * -
+7 8 9 +
+4 5 6
+1 2 3
+  0 .
+"""
+
+# Neighbour directions, in the order the estimator counts turns.
+SLANTED = [(-1, 0), (0, -1), (1, -1), (1, 0), (0, 1), (-1, 1)]
+ALIGNED = [(-1, 0), (-1, -1), (0, -1), (1, -1), (1, 0), (1, 1), (0, 1), (-1, 1)]
+
+
+def read_list(name):
+    words = []
+    seen = set()
+    with open(os.path.join(HERE, "strength_wordlists", name + ".txt"), encoding="ascii") as f:
+        for line in f:
+            word = line.strip().lower()
+            if not word or word.startswith("#") or word in seen:
+                continue
+            if not all(33 <= ord(c) <= 126 for c in word):
+                sys.exit("%s.txt: non-ASCII word %r" % (name, word))
+            seen.add(word)
+            words.append(word)
+    return words
+
+
+def merged_words():
+    ranks = {}
+    for name in LISTS:
+        for rank, word in enumerate(read_list(name), 1):
+            if len(word) >= MIN_WORD_LENGTH:
+                ranks[word] = min(rank, ranks.get(word, rank))
+    return sorted(ranks.items(), key=lambda item: item[0].encode("ascii"))
+
+
+def build_graph(layout, slanted):
+    positions = {}
+    keys = []
+    for y, line in enumerate(layout.strip("\n").split("\n")):
+        slant = y - 1 if slanted else 0
+        xunit = len(line.split()[0]) + 1
+        for token in re.finditer(r"\S+", line):
+            x = (token.start() - slant) // xunit
+            positions[(x, y)] = len(keys)
+            keys.append(token.group())
+    directions = SLANTED if slanted else ALIGNED
+    neighbours = []
+    for (x, y), key in sorted(positions.items(), key=lambda item: item[1]):
+        neighbours.append([positions.get((x + dx, y + dy), -1) for dx, dy in directions])
+    return keys, neighbours
+
+
+def write_graph(out, prefix, keys, neighbours):
+    key_of = [-1] * 128
+    shifted = [0] * 128
+    for k, token in enumerate(keys):
+        for i, c in enumerate(token):
+            key_of[ord(c)] = k
+            shifted[ord(c)] = 1 if i > 0 else 0
+    # Averaged over characters, as every character of a key is its own starting position.
+    chars = sum(len(t) for t in keys)
+    degree = sum(len(t) * sum(1 for n in neighbours[k] if n >= 0) for k, t in enumerate(keys)) / chars
+
+    out.write("constexpr double k%sStartingPositions = %d;\n" % (prefix, chars))
+    out.write("constexpr double k%sAverageDegree = %.6f;\n\n" % (prefix, degree))
+    out.write("constexpr qint8 k%sKeyOf[128] = {\n" % prefix)
+    for i in range(0, 128, PER_LINE * 2):
+        out.write("    " + " ".join("%d," % v for v in key_of[i : i + PER_LINE * 2]) + "\n")
+    out.write("};\n\n")
+    if any(shifted):
+        out.write("constexpr bool k%sShifted[128] = {\n" % prefix)
+        for i in range(0, 128, PER_LINE * 2):
+            out.write("    " + " ".join("%d," % v for v in shifted[i : i + PER_LINE * 2]) + "\n")
+        out.write("};\n\n")
+    out.write("constexpr qint8 k%sNeighbours[%d][%d] = {\n" % (prefix, len(keys), len(neighbours[0])))
+    for k, row in enumerate(neighbours):
+        out.write("    {" + ", ".join("%d" % v for v in row) + "}, // %s\n" % keys[k].replace("\\", "backslash"))
+    out.write("};\n\n")
+
+
+def c_literal(text):
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"').replace("?", "\\?") + '"'
+
+
+def main():
+    words = merged_words()
+    blob = "".join(w for w, _ in words)
+    offsets = [0]
+    for w, _ in words:
+        offsets.append(offsets[-1] + len(w))
+    if offsets[-1] > 0xFFFF or len(words) > 0xFFFF:
+        sys.exit("word tables no longer fit 16-bit offsets")
+
+    out = sys.stdout
+    out.write("// Generated by tools/gen_strength_tables.py from tools/strength_wordlists. Do not edit.\n")
+    out.write("// clang-format off\n\n")
+    out.write("constexpr int kStrengthWordCount = %d;\n\n" % len(words))
+    out.write("constexpr char kStrengthWordChars[] =\n")
+    for i in range(0, len(blob), CHARS_PER_LINE):
+        out.write("    " + c_literal(blob[i : i + CHARS_PER_LINE]) + "\n")
+    out.write("    ;\n\n")
+    out.write("constexpr quint16 kStrengthWordOffsets[%d] = {\n" % len(offsets))
+    for i in range(0, len(offsets), PER_LINE):
+        out.write("    " + " ".join("%d," % v for v in offsets[i : i + PER_LINE]) + "\n")
+    out.write("};\n\n")
+    out.write("constexpr quint16 kStrengthWordRanks[%d] = {\n" % len(words))
+    for i in range(0, len(words), PER_LINE):
+        out.write("    " + " ".join("%d," % r for _, r in words[i : i + PER_LINE]) + "\n")
+    out.write("};\n\n")
+
+    write_graph(out, "Qwerty", *build_graph(QWERTY, True))
+    write_graph(out, "Keypad", *build_graph(KEYPAD, False))
+
+
+if __name__ == "__main__":
+    main()